@@ -34,6 +34,7 @@
 
 #include <QGuiApplication>
 #include <QQuickView>
+#include <QThreadPool>
 
 #include "../src/gagbookmanager.h"
 #include "../src/gagmodel.h"
@@ -46,6 +47,14 @@
 #include "../src/commentmodel.h"
 #include "../src/commentmediaobject.h"
 #include "../src/networkaccessmanagerfactory.h"
+#include "../src/imagesavejob.h"
+#include "../src/gagimageprovider.h"
+#include "../src/fileioworker.h"
+#include "../src/metricsregistry.h"
+#include "../src/jankmonitor.h"
+#include "../src/startupprofiler.h"
+#include "../src/tracing.h"
+#include "../src/allocprofiler.h"
 
 Q_DECL_EXPORT int main(int argc, char *argv[])
 {
@@ -60,6 +69,9 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
 
     //return SailfishApp::main(argc, argv);
 
+    // records the startup timeline, created first to measure the startup from main()
+    StartupProfiler startupProfiler;
+
     QScopedPointer<QGuiApplication> app(SailfishApp::application(argc, argv));
     app->setApplicationDisplayName("GagBook");
     app->setApplicationName("harbour-gagbook");
@@ -67,10 +79,20 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     app->setOrganizationDomain("harbour-gagbook");
     app->setApplicationVersion(APP_VERSION);
 
+    // collects the performance metrics, must outlive everything that records metrics
+    MetricsRegistry metricsRegistry;
+
+    // performs the file writes of the app in the background, must outlive the view
+    FileIoWorker fileIoWorker;
+
     QScopedPointer<QQuickView> view(SailfishApp::createView());
     view->rootContext()->setContextProperty("APP_VERSION", APP_VERSION);
     view->setTitle("GagBook");
 
+    // attributes the dropped frames to the C++ work on the GUI thread
+    JankMonitor jankMonitor(view.data());
+    view->rootContext()->setContextProperty("jankMonitor", &jankMonitor);
+
     QMLUtils qmlUtils;
     view->rootContext()->setContextProperty("QMLUtils", &qmlUtils);
 
@@ -88,13 +110,35 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     qmlRegisterType<CommentModel>("harbour.gagbook.Core", 1, 0, "CommentModel");
     qmlRegisterUncreatableType<CommentMediaObject>("harbour.gagbook.Core", 1, 0, "CommentMediaObject",
                                              "CommentMediaObject should not be created in QML!");   // to register the ENUMs
+    qmlRegisterUncreatableType<MetricsRegistry>("harbour.gagbook.Core", 1, 0, "MetricsRegistry",
+                                                "MetricsRegistry should not be created in QML!");
+    qRegisterMetaType<MetricsRegistry*>("MetricsRegistry*");
+    qmlRegisterUncreatableType<ImageSaveJob>("harbour.gagbook.Core", 1, 0, "ImageSaveJob",
+                                             "ImageSaveJob should be created by QMLUtils.saveImageAsync()!");
 
     // setup network cache for QML
     NetworkAccessManagerFactory factory;
     view->engine()->setNetworkAccessManagerFactory(&factory);
 
+    // the engine takes the ownership of the image provider
+    view->engine()->addImageProvider(QLatin1String("gagbook"), new GagImageProvider);
+
     view->setSource(SailfishApp::pathTo(QString("qml/main.qml")));
+    StartupProfiler::mark("QML engine ready");
+
+    startupProfiler.watchFirstFrame(view.data());
     view->showFullScreen();
 
-    return app->exec();
+    const int result = app->exec();
+
+    // let the running ImageSaveJobs finish their files before the singletons are destroyed
+    QThreadPool::globalInstance()->waitForDone();
+
+    // only written if the app has been built with CONFIG+=tracing
+    GAGBOOK_TRACE_SAVE();
+
+    // only logged if the app has been built with CONFIG+=allocprofile
+    GAGBOOK_ALLOC_REPORT();
+
+    return result;
 }
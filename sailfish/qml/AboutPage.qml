@@ -37,6 +37,13 @@ Page {
         anchors.fill: parent
         contentHeight: column.height
 
+        PullDownMenu {
+            MenuItem {
+                text: "Diagnostics"
+                onClicked: pageStack.push(Qt.resolvedUrl("DiagnosticsPage.qml"));
+            }
+        }
+
         Column {
             PageHeader {
                 title: "About"
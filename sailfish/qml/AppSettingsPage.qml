@@ -69,6 +69,30 @@ Page {
                 onCheckedChanged: appSettings.scrollWithVolumeKeys = checked;
             }
 
+            TextSwitch {
+                anchors { left: parent.left; right: parent.right }
+                text: "Prefetch comments"
+                description: "Load the first comments of the visible posts in the background while connected to a WLAN"
+                checked: appSettings.prefetchComments
+                onCheckedChanged: appSettings.prefetchComments = checked;
+            }
+
+            TextSwitch {
+                anchors { left: parent.left; right: parent.right }
+                text: "Use video frames as previews"
+                description: "Download only the videos of animated posts and show their first frames instead of separate preview images"
+                checked: appSettings.extractVideoPosters
+                onCheckedChanged: appSettings.extractVideoPosters = checked;
+            }
+
+            TextSwitch {
+                anchors { left: parent.left; right: parent.right }
+                text: "Data saver"
+                description: "Load smaller images and only download the images of the visible posts"
+                checked: appSettings.dataSaver
+                onCheckedChanged: appSettings.dataSaver = checked;
+            }
+
             Button {
                 anchors.horizontalCenter: parent.horizontalCenter
                 enabled: !gagbookManager.busy
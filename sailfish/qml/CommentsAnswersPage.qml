@@ -52,6 +52,9 @@ Page {
         model: visualModel
         spacing: Theme.paddingMedium
 
+        // the frames are measured while the list is scrolled
+        Component.onCompleted: jankMonitor.watchView(commentsListView)
+
         header: PageHeader {
             id: header
             title: qsTr("Answers")
@@ -63,6 +63,9 @@ Page {
         spacing: Theme.paddingMedium
         //clip: false  // http://doc.qt.io/qt-5/qtquick-performance.html#clipping
 
+        // the frames are measured while the list is scrolled
+        Component.onCompleted: jankMonitor.watchView(commentsListView)
+
         header: PageHeader {
             id: pageHeader
             title: qsTr("Comments")
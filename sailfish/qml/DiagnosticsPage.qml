@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+import QtQuick 2.2
+import Sailfish.Silica 1.0
+
+Page {
+    id: diagnosticsPage
+
+    property var metrics: []
+
+    function refresh() {
+        metrics = gagbookManager.metrics.snapshot();
+    }
+
+    function formatValue(metric) {
+        if (metric.type === "histogram") {
+            return "n " + metric.count + ", mean " + metric.mean.toFixed(1) + ", p50 " +
+                   metric.p50.toFixed(1) + ", p95 " + metric.p95.toFixed(1) + ", max " + metric.max.toFixed(1);
+        }
+
+        return Math.round(metric.value).toString();
+    }
+
+    // the metrics are only updated while the page is shown
+    Timer {
+        interval: 1000
+        repeat: true
+        triggeredOnStart: true
+        running: diagnosticsPage.status === PageStatus.Active && Qt.application.active
+        onTriggered: refresh()
+    }
+
+    SilicaFlickable {
+        anchors.fill: parent
+        contentHeight: column.height
+
+        PullDownMenu {
+            MenuItem {
+                text: "Reset"
+                onClicked: {
+                    gagbookManager.metrics.reset();
+                    refresh();
+                }
+            }
+            MenuItem {
+                text: "Copy to clipboard"
+                onClicked: {
+                    Clipboard.text = gagbookManager.metrics.report();
+                    infoBanner.alert("Diagnostics copied to clipboard");
+                }
+            }
+        }
+
+        Column {
+            id: column
+            anchors { left: parent.left; right: parent.right }
+            height: childrenRect.height
+
+            PageHeader {
+                title: "Diagnostics"
+            }
+
+            Repeater {
+                model: diagnosticsPage.metrics
+
+                Item {
+                    anchors { left: parent.left; right: parent.right }
+                    height: nameText.height + valueText.height + 2 * constant.paddingSmall
+
+                    Text {
+                        id: nameText
+                        anchors {
+                            top: parent.top; topMargin: constant.paddingSmall
+                            left: parent.left; right: parent.right
+                            leftMargin: constant.paddingMedium; rightMargin: constant.paddingMedium
+                        }
+                        font.pixelSize: Theme.fontSizeExtraSmall
+                        color: Theme.secondaryHighlightColor
+                        text: modelData.name + " (" + modelData.type + ")"
+                    }
+
+                    Text {
+                        id: valueText
+                        anchors {
+                            top: nameText.bottom
+                            left: parent.left; right: parent.right
+                            leftMargin: constant.paddingMedium; rightMargin: constant.paddingMedium
+                        }
+                        wrapMode: Text.Wrap
+                        font.pixelSize: Theme.fontSizeSmall
+                        color: Theme.highlightColor
+                        text: diagnosticsPage.formatValue(modelData)
+                    }
+                }
+            }
+        }
+
+        ViewPlaceholder {
+            enabled: diagnosticsPage.metrics.length === 0
+            text: "No metrics recorded yet"
+        }
+
+        VerticalScrollDecorator {}
+    }
+}
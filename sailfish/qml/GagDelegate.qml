@@ -85,7 +85,10 @@ Item {
                     smooth: !gagDelegate.ListView.view.moving
                     cache: false
                     fillMode: Image.PreserveAspectFit
-                    source: model.imageUrl
+                    sourceSize.width: gagDelegate.width
+                    // the original image is just shown in ImagePage, the decoded images are cached by
+                    // the image provider (see GagModel::decodeAhead())
+                    source: model.thumbnailUrl
                 }
             }
 
@@ -359,9 +362,26 @@ Item {
                 onClicked: QMLUtils.shareLink(model.url, model.title)
             }*/
             IconButton {
+                id: saveButton
                 property string _savedFilePath: ""
+                property ImageSaveJob _saveJob: null
+
+                function _alertSavedFile() {
+                    _savedFilePath = model.savedFileUrl;
+
+                    if (_savedFilePath.indexOf("file://") == 0) {
+                        var displayPath = _savedFilePath;
+                        if (_savedFilePath)
+                            displayPath = displayPath.substring(7);
+                        infoBanner.alert("File saved to " + displayPath);
+                    } else {
+                        infoBanner.alert("Unable to save file");
+                    }
+                }
+
                 icon.height: Theme.iconSizeMedium; icon.width: Theme.iconSizeMedium
                 icon.source: "image://theme/icon-m-" + (model.savedFileUrl.toString() ? "image" : "download")
+                enabled: _saveJob === null
                 onClicked: {
                     if (!model.savedFileUrl.toString()) {
                         // check if the URL points to a local file (see GagModel::data())
@@ -372,27 +392,20 @@ Item {
                             return;
                         }
 
+                        // the files are saved in the background, see onFinished below
                         if (model.isVideo) {
-                            model.savedFileUrl = QMLUtils.saveImage(model.videoUrl);
+                            _saveJob = QMLUtils.saveImageAsync(model.videoUrl, false);
                         } else if (model.isGIF) {
-                            model.savedFileUrl = QMLUtils.saveImage(model.gifImageUrl);
+                            _saveJob = QMLUtils.saveImageAsync(model.gifImageUrl, false);
                         } else if (model.isPartialImage) {
-                            // download downscaled long image
-                            model.savedFileUrl = QMLUtils.saveImage(model.fullImageUrl, true);
+                            // download downscaled long image, scaling it down may take a while
+                            _saveJob = QMLUtils.saveImageAsync(model.fullImageUrl, true);
                         } else {
-                            model.savedFileUrl = QMLUtils.saveImage(model.imageUrl);
+                            _saveJob = QMLUtils.saveImageAsync(model.imageUrl, false);
                         }
 
-                        _savedFilePath = model.savedFileUrl;
-
-                        if (_savedFilePath.indexOf("file://") == 0) {
-                            var displayPath = _savedFilePath;
-                            if (_savedFilePath)
-                                displayPath = displayPath.substring(7);
-                            infoBanner.alert("File saved to " + displayPath);
-                        } else {
-                            infoBanner.alert("Unable to save file");
-                        }
+                        if (_saveJob === null)
+                            _alertSavedFile();
                     }
                     else {
                         if (!QMLUtils.fileExists(model.savedFileUrl)) {
@@ -403,6 +416,22 @@ Item {
                         }
                     }
                 }
+
+                Connections {
+                    target: saveButton._saveJob
+                    onFinished: {
+                        saveButton._saveJob = null;
+                        model.savedFileUrl = savedFileUrl;
+                        saveButton._alertSavedFile();
+                    }
+                }
+
+                ProgressCircle {
+                    anchors.centerIn: parent
+                    width: Theme.iconSizeMedium; height: Theme.iconSizeMedium
+                    visible: saveButton._saveJob !== null
+                    value: saveButton._saveJob ? saveButton._saveJob.progress : 0
+                }
             }
         }
     }
@@ -414,4 +443,15 @@ Item {
     }
 
     ListView.onAdd: AddAnimation { target: gagDelegate }
+
+    Component.onCompleted: {
+        // with the data saver, the images are only downloaded for the created delegates
+        gagModel.requestMedia(index)
+        gagModel.decodeAhead(index, Qt.size(gagDelegate.width, 0))
+
+        if (model.commentsCount > 0)
+            gagbookManager.prefetchComments(model.url)
+    }
+
+    Component.onDestruction: gagModel.cancelMedia(index)
 }
@@ -77,6 +77,9 @@ Page {
         orientation: ListView.Vertical
         spacing: constant.paddingMedium
 
+        // the frames are measured while the list is scrolled
+        Component.onCompleted: jankMonitor.watchView(gagListView)
+
         PullDownMenu {
             MenuItem {
                 text: "About GagBook"
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "allocprofiler.h"
+
+#ifdef GAGBOOK_ALLOC_PROFILE
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QDebug>
+
+#include "metricsregistry.h"
+
+namespace {
+
+struct Totals {
+    Totals() : calls(0), count(0), bytes(0) {}
+
+    qint64 calls;
+    qint64 count;
+    qint64 bytes;
+};
+
+// the innermost scope of the thread, a plain pointer so that it is usable inside malloc()
+thread_local AllocScope *t_currentScope = 0;
+
+QMutex *totalsMutex()
+{
+    static QMutex mutex;
+    return &mutex;
+}
+
+QMap<QByteArray, Totals> *totalsByScope()
+{
+    static QMap<QByteArray, Totals> totals;
+    return &totals;
+}
+
+} // namespace
+
+#ifdef __GLIBC__
+// The allocation functions of the executable replace the ones of glibc for the whole process,
+// including the allocations of Qt
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    AllocScope::countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    AllocScope::countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    AllocScope::countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+#warning "Allocation profiling requires glibc, no allocations will be counted"
+#endif
+
+AllocScope::AllocScope(const char *name)
+    : m_name(name), m_parent(t_currentScope), m_count(0), m_bytes(0)
+{
+    t_currentScope = this;
+}
+
+AllocScope::~AllocScope()
+{
+    // the allocations of the bookkeeping are not counted
+    t_currentScope = 0;
+
+    if (m_parent != 0) {
+        m_parent->m_count += m_count;
+        m_parent->m_bytes += m_bytes;
+    }
+
+    {
+        QMutexLocker locker(totalsMutex());
+        Totals &totals = (*totalsByScope())[m_name];
+        ++totals.calls;
+        totals.count += m_count;
+        totals.bytes += m_bytes;
+    }
+
+    const QString prefix = QString("alloc.%1.").arg(m_name);
+    MetricsRegistry *metrics = MetricsRegistry::instance();
+    metrics->increment(prefix + "calls");
+    metrics->increment(prefix + "count", m_count);
+    metrics->increment(prefix + "bytes", m_bytes);
+
+    t_currentScope = m_parent;
+}
+
+void AllocScope::countAllocation(size_t size)
+{
+    AllocScope *scope = t_currentScope;
+
+    if (scope != 0) {
+        ++scope->m_count;
+        scope->m_bytes += size;
+    }
+}
+
+void AllocScope::report()
+{
+    AllocScope *scope = t_currentScope;
+    t_currentScope = 0;
+
+    QMutexLocker locker(totalsMutex());
+
+    qDebug("AllocScope: Allocations per scope (calls, allocations, bytes, allocations per call, bytes per call):");
+
+    QMap<QByteArray, Totals>::const_iterator i = totalsByScope()->constBegin();
+    for (; i != totalsByScope()->constEnd(); ++i) {
+        const Totals &totals = i.value();
+        qDebug("%-40s %8lld %10lld %12lld %10lld %12lld", i.key().constData(), totals.calls, totals.count,
+               totals.bytes, totals.count / totals.calls, totals.bytes / totals.calls);
+    }
+
+    t_currentScope = scope;
+}
+
+#endif // GAGBOOK_ALLOC_PROFILE
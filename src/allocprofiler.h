@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ALLOCPROFILER_H
+#define ALLOCPROFILER_H
+
+/*! Allocation counting of named scopes
+
+    GAGBOOK_ALLOC_SCOPE(name) counts the heap allocations (number and requested bytes)
+    of the current thread until the end of the enclosing scope, including the allocations
+    of nested scopes and of Qt (e.g. the data of QString, QByteArray and QList). The
+    totals per scope are added to the counters "alloc.<name>.calls", "alloc.<name>.count"
+    and "alloc.<name>.bytes" of the MetricsRegistry and GAGBOOK_ALLOC_REPORT() logs them.
+    The \p name must be a string literal.
+
+    The macros are compiled out unless the app is built with CONFIG+=allocprofile, which
+    defines GAGBOOK_ALLOC_PROFILE and replaces malloc(), calloc() and realloc() of the
+    process with counting versions (glibc only).
+ */
+
+#ifdef GAGBOOK_ALLOC_PROFILE
+
+#include <QtCore/QtGlobal>
+
+class AllocScope
+{
+public:
+    explicit AllocScope(const char *name);
+    ~AllocScope();
+
+    /*! Count an allocation of \p size bytes in the current scope of the thread. */
+    static void countAllocation(size_t size);
+
+    /*! Log the totals of all scopes. */
+    static void report();
+
+private:
+    Q_DISABLE_COPY(AllocScope)
+
+    const char *m_name;
+    AllocScope *m_parent;
+    qint64 m_count;
+    qint64 m_bytes;
+};
+
+#define GAGBOOK_ALLOC_CONCAT_IMPL(a, b) a##b
+#define GAGBOOK_ALLOC_CONCAT(a, b) GAGBOOK_ALLOC_CONCAT_IMPL(a, b)
+#define GAGBOOK_ALLOC_SCOPE(name) AllocScope GAGBOOK_ALLOC_CONCAT(allocScope_, __LINE__)(name)
+#define GAGBOOK_ALLOC_REPORT() AllocScope::report()
+
+#else
+
+#define GAGBOOK_ALLOC_SCOPE(name) do {} while (0)
+#define GAGBOOK_ALLOC_REPORT() do {} while (0)
+
+#endif // GAGBOOK_ALLOC_PROFILE
+
+#endif // ALLOCPROFILER_H
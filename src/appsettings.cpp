@@ -30,6 +30,8 @@
 
 #include <QtCore/QSettings>
 
+#include "fileioworker.h"
+
 AppSettings::AppSettings(QObject *parent) :
     QObject(parent), m_settings(new QSettings(this)), m_sections(new SectionModel(this))
 {
@@ -50,6 +52,9 @@ void AppSettings::readSettings()
     m_whiteTheme = m_settings->value("whiteTheme", false).toBool();
     m_source = static_cast<Source>(m_settings->value("source", 0).toInt());
     m_scrollWithVolumeKeys = m_settings->value("scrollWithVolumeKeys", false).toBool();
+    m_prefetchComments = m_settings->value("prefetchComments", false).toBool();
+    m_extractVideoPosters = m_settings->value("extractVideoPosters", false).toBool();
+    m_dataSaver = m_settings->value("dataSaver", false).toBool();
     m_sections->restore(m_settings, "sections");
 
     if (m_sections->isEmpty())
@@ -73,6 +78,15 @@ void AppSettings::setDefaultSettings()
     m_scrollWithVolumeKeys = false;
     m_settings->setValue("scrollWithVolumeKeys", m_scrollWithVolumeKeys);
 
+    m_prefetchComments = false;
+    m_settings->setValue("prefetchComments", m_prefetchComments);
+
+    m_extractVideoPosters = false;
+    m_settings->setValue("extractVideoPosters", m_extractVideoPosters);
+
+    m_dataSaver = false;
+    m_settings->setValue("dataSaver", m_dataSaver);
+
     m_sections->setDefaultSections();
     m_sections->save(m_settings, "sections");
 
@@ -88,7 +102,7 @@ void AppSettings::setLoggedIn(bool isLoggedIn)
 {
     if (m_loggedIn != isLoggedIn) {
         m_loggedIn = isLoggedIn;
-        m_settings->setValue("loggedIn", m_loggedIn);
+        FileIoWorker::instance()->setSettingsValue("loggedIn", m_loggedIn);
         emit loggedInChanged();
     }
 }
@@ -102,7 +116,7 @@ void AppSettings::setWhiteTheme(bool whiteTheme)
 {
     if (m_whiteTheme != whiteTheme) {
         m_whiteTheme = whiteTheme;
-        m_settings->setValue("whiteTheme", m_whiteTheme);
+        FileIoWorker::instance()->setSettingsValue("whiteTheme", m_whiteTheme);
         emit whiteThemeChanged();
     }
 }
@@ -116,7 +130,7 @@ void AppSettings::setSource(Source source)
 {
     if (m_source != source) {
         m_source = source;
-        m_settings->setValue("source", static_cast<int>(m_source));
+        FileIoWorker::instance()->setSettingsValue("source", static_cast<int>(m_source));
         emit sourceChanged();
     }
 }
@@ -130,11 +144,53 @@ void AppSettings::setScrollWithVolumeKeys(bool scrollWithVolumeKeys)
 {
     if (m_scrollWithVolumeKeys != scrollWithVolumeKeys) {
         m_scrollWithVolumeKeys = scrollWithVolumeKeys;
-        m_settings->setValue("scrollWithVolumeKeys", m_scrollWithVolumeKeys);
+        FileIoWorker::instance()->setSettingsValue("scrollWithVolumeKeys", m_scrollWithVolumeKeys);
         emit scrollWithVolumeKeysChanged();
     }
 }
 
+bool AppSettings::prefetchComments() const
+{
+    return m_prefetchComments;
+}
+
+void AppSettings::setPrefetchComments(bool prefetchComments)
+{
+    if (m_prefetchComments != prefetchComments) {
+        m_prefetchComments = prefetchComments;
+        FileIoWorker::instance()->setSettingsValue("prefetchComments", m_prefetchComments);
+        emit prefetchCommentsChanged();
+    }
+}
+
+bool AppSettings::extractVideoPosters() const
+{
+    return m_extractVideoPosters;
+}
+
+void AppSettings::setExtractVideoPosters(bool extractVideoPosters)
+{
+    if (m_extractVideoPosters != extractVideoPosters) {
+        m_extractVideoPosters = extractVideoPosters;
+        FileIoWorker::instance()->setSettingsValue("extractVideoPosters", m_extractVideoPosters);
+        emit extractVideoPostersChanged();
+    }
+}
+
+bool AppSettings::dataSaver() const
+{
+    return m_dataSaver;
+}
+
+void AppSettings::setDataSaver(bool dataSaver)
+{
+    if (m_dataSaver != dataSaver) {
+        m_dataSaver = dataSaver;
+        FileIoWorker::instance()->setSettingsValue("dataSaver", m_dataSaver);
+        emit dataSaverChanged();
+    }
+}
+
 SectionModel *AppSettings::sections() const
 {
     return m_sections;
@@ -61,6 +61,21 @@ class AppSettings : public QObject
     Q_PROPERTY(bool scrollWithVolumeKeys READ scrollWithVolumeKeys WRITE setScrollWithVolumeKeys
                NOTIFY scrollWithVolumeKeysChanged)
 
+    /*! True if the first comments of the visible posts should be prefetched while connected
+        to a WLAN. Default is false. */
+    Q_PROPERTY(bool prefetchComments READ prefetchComments WRITE setPrefetchComments
+               NOTIFY prefetchCommentsChanged)
+
+    /*! True if only the videos of animated posts should be downloaded and their first frames
+        be used as preview images. Default is false. */
+    Q_PROPERTY(bool extractVideoPosters READ extractVideoPosters WRITE setExtractVideoPosters
+               NOTIFY extractVideoPostersChanged)
+
+    /*! True if less mobile data should be used by loading smaller images, which are only
+        downloaded when the posts become visible. Default is false. */
+    Q_PROPERTY(bool dataSaver READ dataSaver WRITE setDataSaver
+               NOTIFY dataSaverChanged)
+
     /*! List of 9GAG sections. This allow user to add/remove 9GAG sections manually and does not
         require an app update to view a newly added 9GAG sections. Currently there is no UI to
         modify this, that means user has to edit the config file manually. */
@@ -88,6 +103,15 @@ public:
     bool scrollWithVolumeKeys() const;
     void setScrollWithVolumeKeys(bool scrollWithVolumeKeys);
 
+    bool prefetchComments() const;
+    void setPrefetchComments(bool prefetchComments);
+
+    bool extractVideoPosters() const;
+    void setExtractVideoPosters(bool extractVideoPosters);
+
+    bool dataSaver() const;
+    void setDataSaver(bool dataSaver);
+
     SectionModel *sections() const;
     void setSections(const SectionModel *sections);
 
@@ -96,6 +120,9 @@ signals:
     void whiteThemeChanged();
     void sourceChanged();
     void scrollWithVolumeKeysChanged();
+    void prefetchCommentsChanged();
+    void extractVideoPostersChanged();
+    void dataSaverChanged();
     void sectionsChanged();
 
 private:
@@ -106,6 +133,9 @@ private:
     bool m_whiteTheme;
     Source m_source;
     bool m_scrollWithVolumeKeys;
+    bool m_prefetchComments;
+    bool m_extractVideoPosters;
+    bool m_dataSaver;
     SectionModel *m_sections;
 
     void readSettings();
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "commentcache.h"
+
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+#include "fileioworker.h"
+
+static const QString COMMENT_CACHE_PATH = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + "/harbour-gagbook/comments";
+
+static const quint32 CACHE_FILE_MAGIC = 0x47424343;    // "GBCC"
+static const quint32 CACHE_FILE_VERSION = 1;
+static const int MAX_MEMORY_COST = 4 * 1024 * 1024;     // in bytes
+static const int MAX_CHILD_COUNT = 100000;
+
+static void writeComment(QDataStream &stream, CommentObject *comment)
+{
+    CommentMediaObject media = comment->media();
+    const UserObject user = comment->user();
+
+    stream << comment->id() << comment->timestamp() << comment->permalink() << comment->text()
+           << qint32(comment->textType());
+
+    stream << qint32(media.mediaType()) << media.imageUrl() << media.imageSize() << media.gifUrl()
+           << media.gifSize() << media.videoUrl() << media.videoSize();
+
+    stream << comment->orderKey();
+
+    stream << user.name() << user.userId() << user.emojiStatus() << user.avatarUrl()
+           << user.isProUser() << user.isStaffUser();
+
+    stream << qint32(comment->upvotes()) << qint32(comment->totalChildCount())
+           << qint32(comment->currentChildCount());
+
+    for (int i = 0; i < comment->currentChildCount(); ++i)
+        writeComment(stream, comment->child(i));
+}
+
+static CommentObject *readComment(QDataStream &stream, CommentObject *parent, CommentArena *arena)
+{
+    QString id, text, orderKey, userName, userId, emojiStatus;
+    QDateTime timestamp;
+    QUrl permalink, imageUrl, gifUrl, videoUrl, avatarUrl;
+    QSize imageSize, gifSize, videoSize;
+    qint32 textType, mediaType, upvotes, totalChildCount, childCount;
+    bool isProUser, isStaffUser;
+
+    stream >> id >> timestamp >> permalink >> text >> textType;
+    stream >> mediaType >> imageUrl >> imageSize >> gifUrl >> gifSize >> videoUrl >> videoSize;
+    stream >> orderKey;
+    stream >> userName >> userId >> emojiStatus >> avatarUrl >> isProUser >> isStaffUser;
+    stream >> upvotes >> totalChildCount >> childCount;
+
+    if ((stream.status() != QDataStream::Ok) || (childCount < 0) || (childCount > MAX_CHILD_COUNT))
+        return 0;
+
+    CommentObject *comment = arena ? arena->create(parent) : new CommentObject(parent);
+    comment->setId(id);
+    comment->setTimestamp(timestamp);
+    comment->setPermalink(permalink);
+    comment->setText(text);
+    comment->setTextType(static_cast<ContentType>(textType));
+
+    if (comment->textType() != ContentType::Text) {
+        CommentMediaObject media;
+        media.setMediaType(static_cast<CommentMediaObject::CommentMediaType>(mediaType));
+        media.setImageUrl(imageUrl);
+        media.setImageSize(imageSize);
+        media.setGifUrl(gifUrl);
+        media.setGifSize(gifSize);
+        media.setVideoUrl(videoUrl);
+        media.setVideoSize(videoSize);
+        comment->setMedia(media);
+    }
+
+    comment->setOrderKey(orderKey);
+
+    UserObject user;
+    user.setName(userName);
+    user.setUserId(userId);
+    user.setEmojiStatus(emojiStatus);
+    user.setAvatarUrl(avatarUrl);
+    user.setIsProUser(isProUser);
+    user.setIsStaffUser(isStaffUser);
+    comment->setUser(user);
+
+    comment->setUpvotes(upvotes);
+    comment->setTotalChildCount(totalChildCount);
+
+    for (int i = 0; i < childCount; ++i) {
+        CommentObject *child = readComment(stream, comment, arena);
+
+        if (child == 0) {
+            if (arena == 0)
+                delete comment;
+
+            return 0;
+        }
+
+        comment->appendChild(child);
+    }
+
+    return comment;
+}
+
+/*!
+    \class CommentCache
+    \since 1.5.0
+    \brief The CommentCache class caches the comment threads of the posts.
+
+    CommentCache stores the CommentObject tree of a post (keyed by the URL of the post and the
+    sorting of the comments) in a compact binary form, in memory and on disk. This allows to
+    restore a recently viewed comment thread without performing any network request or
+    parsing the API response again. Entries expire after timeToLive() seconds.
+
+    Only the entries in memory can be restored. Entries which are only on disk have to be
+    loaded with load() first, which reads the file in the FileIoWorker thread. Entries that
+    exceed the memory budget are kept after loading until they have been restored.
+
+    \sa CommentModel
+*/
+
+/*!
+ * \brief CommentCache::CommentCache Constructs a CommentCache and removes expired cache files.
+ * \param parent Pointer to the parent object.
+ */
+CommentCache::CommentCache(QObject *parent)
+    : QObject(parent), m_entries(MAX_MEMORY_COST), m_timeToLive(10 * 60)
+{
+    QDir cacheDir(COMMENT_CACHE_PATH);
+    if (!cacheDir.exists())
+        cacheDir.mkpath(".");
+
+    indexFiles();
+
+    // the data is read in the worker thread and passed with a queued connection
+    connect(FileIoWorker::instance(), &FileIoWorker::fileRead, this, &CommentCache::onFileRead);
+}
+
+/*!
+ * \brief CommentCache::timeToLive Returns the time in seconds after which an entry expires.
+ */
+int CommentCache::timeToLive() const
+{
+    return m_timeToLive;
+}
+
+void CommentCache::setTimeToLive(int seconds)
+{
+    m_timeToLive = qMax(0, seconds);
+}
+
+/*!
+ * \brief CommentCache::contains Checks if there is a valid cache entry, in memory or on disk.
+ *  The disk is not accessed.
+ * \param gagUrl The URL of the post.
+ * \param sorting The sorting of the comments (see CommentModel::Sorting).
+ * \return Returns true if there is a cached comment thread that has not expired yet.
+ */
+bool CommentCache::contains(const QUrl &gagUrl, int sorting)
+{
+    const QString key = cacheKey(gagUrl, sorting);
+
+    if (entry(key) != 0)
+        return true;
+
+    const QString path = filePath(key);
+    const QDateTime timestamp = m_fileIndex.value(path);
+
+    if (!timestamp.isValid())
+        return false;
+
+    if (!isExpired(timestamp))
+        return true;
+
+    m_fileIndex.remove(path);
+    FileIoWorker::instance()->remove(path);
+    return false;
+}
+
+/*!
+ * \brief CommentCache::isLoaded Checks if there is a valid cache entry in memory, which can be
+ *  restored immediately.
+ * \param gagUrl The URL of the post.
+ * \param sorting The sorting of the comments (see CommentModel::Sorting).
+ */
+bool CommentCache::isLoaded(const QUrl &gagUrl, int sorting)
+{
+    return entry(cacheKey(gagUrl, sorting)) != 0;
+}
+
+/*!
+ * \brief CommentCache::load Loads the cache entry from disk in the background. The loaded()
+ *  signal is emitted when the entry can be restored or if there is no valid entry.
+ * \param gagUrl The URL of the post.
+ * \param sorting The sorting of the comments (see CommentModel::Sorting).
+ */
+void CommentCache::load(const QUrl &gagUrl, int sorting)
+{
+    LoadJob job;
+    job.gagUrl = gagUrl;
+    job.sorting = sorting;
+
+    m_loadJobs.insert(FileIoWorker::instance()->read(filePath(cacheKey(gagUrl, sorting))), job);
+}
+
+/*!
+ * \brief CommentCache::restore Restores a cached comment thread from memory.
+ * \param gagUrl The URL of the post.
+ * \param sorting The sorting of the comments (see CommentModel::Sorting).
+ * \param rootComment The root comment of the thread, which receives the total comment count,
+ *  the pagination state and the user of the original poster.
+ * \param arena The CommentArena in which the comments are allocated (can be 0).
+ * \return Returns the list of the restored top-level comments. The list is empty if there is
+ *  no valid cache entry in memory. Note that the comments are not appended to \a rootComment.
+ */
+QList<CommentObject *> CommentCache::restore(const QUrl &gagUrl, int sorting, CommentObject *rootComment,
+                                             CommentArena *arena)
+{
+    QList<CommentObject *> commentList;
+    const QString key = cacheKey(gagUrl, sorting);
+    Entry *cacheEntry = entry(key);
+
+    if (cacheEntry == 0)
+        return commentList;
+
+    QDataStream stream(cacheEntry->data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    qint32 totalChildCount, childCount;
+    bool hasMoreTopLvlComments;
+    QString opUserId;
+
+    stream >> totalChildCount >> hasMoreTopLvlComments >> opUserId >> childCount;
+
+    if ((stream.status() != QDataStream::Ok) || (childCount < 0) || (childCount > MAX_CHILD_COUNT)) {
+        qWarning() << "CommentCache::restore(): Invalid cache entry for" << gagUrl;
+        remove(gagUrl, sorting);
+        return commentList;
+    }
+
+    for (int i = 0; i < childCount; ++i) {
+        CommentObject *comment = readComment(stream, rootComment, arena);
+
+        if (comment == 0) {
+            qWarning() << "CommentCache::restore(): Invalid cache entry for" << gagUrl;
+
+            if (arena == 0)
+                qDeleteAll(commentList);
+
+            remove(gagUrl, sorting);
+            return QList<CommentObject *>();
+        }
+
+        commentList.append(comment);
+    }
+
+    // an entry that exceeds the memory budget is loaded again from disk the next time
+    m_oversizedEntries.remove(key);
+
+    rootComment->setTotalChildCount(totalChildCount);
+    rootComment->setHasMoreTopLvlComments(hasMoreTopLvlComments);
+    rootComment->setUser(UserObject(opUserId));
+
+    return commentList;
+}
+
+/*!
+ * \brief CommentCache::store Stores the comment thread of the given root comment.
+ * \param gagUrl The URL of the post.
+ * \param sorting The sorting of the comments (see CommentModel::Sorting).
+ * \param rootComment The root comment of the thread.
+ */
+void CommentCache::store(const QUrl &gagUrl, int sorting, CommentObject *rootComment)
+{
+    if (rootComment->currentChildCount() == 0)
+        return;
+
+    const QDateTime timestamp = QDateTime::currentDateTimeUtc();
+    QByteArray data;
+
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << qint32(rootComment->totalChildCount()) << rootComment->hasMoreTopLvlComments()
+           << rootComment->user().userId() << qint32(rootComment->currentChildCount());
+
+    for (int i = 0; i < rootComment->currentChildCount(); ++i)
+        writeComment(stream, rootComment->child(i));
+
+    const QString key = cacheKey(gagUrl, sorting);
+    const QString path = filePath(key);
+
+    // the file is written by the I/O worker, a following load() reads it after the write
+    QByteArray fileData;
+    QDataStream fileStream(&fileData, QIODevice::WriteOnly);
+    fileStream.setVersion(QDataStream::Qt_5_0);
+    fileStream << CACHE_FILE_MAGIC << CACHE_FILE_VERSION << timestamp << data;
+    FileIoWorker::instance()->write(path, fileData);
+    m_fileIndex.insert(path, timestamp);
+
+    // entries that exceed the memory budget are only kept on disk
+    m_oversizedEntries.remove(key);
+    if (data.size() <= m_entries.maxCost())
+        insertEntry(key, timestamp, data);
+    else
+        m_entries.remove(key);
+}
+
+/*!
+ * \brief CommentCache::remove Removes the cache entry from memory and disk.
+ * \param gagUrl The URL of the post.
+ * \param sorting The sorting of the comments (see CommentModel::Sorting).
+ */
+void CommentCache::remove(const QUrl &gagUrl, int sorting)
+{
+    const QString key = cacheKey(gagUrl, sorting);
+    const QString path = filePath(key);
+
+    m_entries.remove(key);
+    m_oversizedEntries.remove(key);
+    m_fileIndex.remove(path);
+    FileIoWorker::instance()->remove(path);
+}
+
+void CommentCache::onFileRead(int jobId, const QByteArray &fileData)
+{
+    if (!m_loadJobs.contains(jobId))
+        return;
+
+    const LoadJob job = m_loadJobs.take(jobId);
+    const QString key = cacheKey(job.gagUrl, job.sorting);
+
+    QDataStream stream(fileData);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    QDateTime timestamp;
+    QByteArray data;
+
+    stream >> magic >> version;
+    bool valid = (stream.status() == QDataStream::Ok) && (magic == CACHE_FILE_MAGIC)
+                 && (version == CACHE_FILE_VERSION);
+
+    if (valid) {
+        stream >> timestamp >> data;
+        valid = (stream.status() == QDataStream::Ok) && !isExpired(timestamp);
+    }
+
+    // invalid and expired files are removed by indexFiles() on the next start
+    if (!valid) {
+        if (entry(key) == 0)
+            m_fileIndex.remove(filePath(key));
+
+        emit loaded(job.gagUrl, job.sorting, entry(key) != 0);
+        return;
+    }
+
+    insertEntry(key, timestamp, data);
+    emit loaded(job.gagUrl, job.sorting, true);
+}
+
+QString CommentCache::cacheKey(const QUrl &gagUrl, int sorting) const
+{
+    return gagUrl.toString(QUrl::NormalizePathSegments) + QChar('#') + QString::number(sorting);
+}
+
+QString CommentCache::filePath(const QString &key) const
+{
+    return COMMENT_CACHE_PATH + "/" + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+// Returns the valid entry for the key from memory or 0 (removes the entry if it has expired)
+CommentCache::Entry *CommentCache::entry(const QString &key)
+{
+    Entry *cacheEntry = m_entries.object(key);
+
+    if ((cacheEntry == 0) && m_oversizedEntries.contains(key))
+        cacheEntry = &m_oversizedEntries[key];
+
+    if (cacheEntry == 0)
+        return 0;
+
+    if (!isExpired(cacheEntry->timestamp))
+        return cacheEntry;
+
+    const QString path = filePath(key);
+    m_entries.remove(key);
+    m_oversizedEntries.remove(key);
+    m_fileIndex.remove(path);
+    FileIoWorker::instance()->remove(path);
+    return 0;
+}
+
+// Keeps the entry in memory, entries that exceed the memory budget are kept until they are restored
+void CommentCache::insertEntry(const QString &key, const QDateTime &timestamp, const QByteArray &data)
+{
+    Entry cacheEntry;
+    cacheEntry.timestamp = timestamp;
+    cacheEntry.data = data;
+
+    if (data.size() > m_entries.maxCost()) {
+        m_entries.remove(key);
+        m_oversizedEntries.insert(key, cacheEntry);
+    }
+    else {
+        m_oversizedEntries.remove(key);
+        m_entries.insert(key, new Entry(cacheEntry), qMax(1, data.size()));
+    }
+}
+
+bool CommentCache::isExpired(const QDateTime &timestamp) const
+{
+    return timestamp.secsTo(QDateTime::currentDateTimeUtc()) > m_timeToLive;
+}
+
+// Removes the expired cache files and indexes the others
+void CommentCache::indexFiles()
+{
+    QDir cacheDir(COMMENT_CACHE_PATH);
+
+    foreach (const QFileInfo &fileInfo, cacheDir.entryInfoList(QDir::Files)) {
+        const QDateTime timestamp = fileInfo.lastModified().toUTC();
+
+        if (isExpired(timestamp))
+            FileIoWorker::instance()->remove(fileInfo.absoluteFilePath());
+        else
+            m_fileIndex.insert(COMMENT_CACHE_PATH + "/" + fileInfo.fileName(), timestamp);
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMMENTCACHE_H
+#define COMMENTCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QDateTime>
+#include <QByteArray>
+#include <QHash>
+
+#include "commentobject.h"
+
+class CommentCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CommentCache(QObject *parent = 0);
+
+    int timeToLive() const;
+    void setTimeToLive(int seconds);
+
+    bool contains(const QUrl &gagUrl, int sorting);
+    bool isLoaded(const QUrl &gagUrl, int sorting);
+    void load(const QUrl &gagUrl, int sorting);
+    QList<CommentObject *> restore(const QUrl &gagUrl, int sorting, CommentObject *rootComment,
+                                   CommentArena *arena);
+    void store(const QUrl &gagUrl, int sorting, CommentObject *rootComment);
+    void remove(const QUrl &gagUrl, int sorting);
+
+signals:
+    void loaded(const QUrl &gagUrl, int sorting, bool success);
+
+private slots:
+    void onFileRead(int jobId, const QByteArray &fileData);
+
+private:
+    struct Entry {
+        QDateTime timestamp;
+        QByteArray data;
+    };
+
+    struct LoadJob {
+        QUrl gagUrl;
+        int sorting;
+    };
+
+    QString cacheKey(const QUrl &gagUrl, int sorting) const;
+    QString filePath(const QString &key) const;
+    Entry *entry(const QString &key);
+    void insertEntry(const QString &key, const QDateTime &timestamp, const QByteArray &data);
+    bool isExpired(const QDateTime &timestamp) const;
+    void indexFiles();
+
+    QCache<QString, Entry> m_entries;
+    // the loaded entries that exceed the memory budget, kept until they have been restored
+    QHash<QString, Entry> m_oversizedEntries;
+    // the modification time of the cache files by path, so that contains() needs no disk access
+    QHash<QString, QDateTime> m_fileIndex;
+    QHash<int, LoadJob> m_loadJobs;
+    int m_timeToLive;
+};
+
+#endif // COMMENTCACHE_H
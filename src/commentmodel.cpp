@@ -28,6 +28,9 @@
 #include "commentmodel.h"
 #include "gagrequest.h"
 #include "gagimagedownloader.h"
+#include "commentcache.h"
+#include "allocprofiler.h"
+#include "jankmonitor.h"
 
 /*!
     \class CommentModel
@@ -43,6 +46,14 @@
     CommentObject objects. All the top-level comments are children of an empty CommentObject
     (the rootComment) and each top-level comment may have children comments which correspond to the
     answers of a specific comment (second-level comments).
+    The fetched CommentObjects are allocated in a CommentArena owned by the model, which frees all
+    of them at once on a refresh() of the whole model or on destruction of the model.
+
+    On the initial population the model restores the comment thread from the CommentCache of the
+    GagBookManager if available (an entry which is only on disk is loaded in the background first)
+    and refreshes it in the background: the upvotes and reply counts of
+    the known comments are updated and new top-level comments are inserted. The comment thread is
+    stored in the cache on destruction of the model or when the sorting changes.
 
     Note: Currently CommentModel is just compatible with NineGagApiRequest and needs to be adapted if
     it should be used also with another GagRequest instance/type ((can)FetchMore() methods...).
@@ -56,9 +67,10 @@
  * use the CommentModel!
  */
 CommentModel::CommentModel(QObject *parent)
-    : QAbstractItemModel(parent), m_rootComment(new CommentObject()), m_isEmpty(true),
+    : QAbstractItemModel(parent), m_commentArena(), m_rootComment(new CommentObject()), m_isEmpty(true),
       m_gagUrl(QUrl()), m_fetchAmount(10), m_loadingStatus(LoadingStatus::Idle),
-      m_sorting(Sorting::Hot), m_manager(0)
+      m_sorting(Sorting::Hot), m_fetchMoreFailed(false), m_mergeRequestId(0), m_mergeRoot(), m_mergeArena(), m_cacheLoadPending(false),
+      m_manager(0)
 {
     m_roleNames[IdRole] = "id";
     m_roleNames[TimestampRole] = "timestamp";
@@ -77,7 +89,8 @@ CommentModel::CommentModel(QObject *parent)
  */
 CommentModel::~CommentModel()
 {
-    m_manager->gagRequest()->abortCommentsRequest();
+    abortPendingRequests();
+    storeToCache();
     delete m_rootComment;
 }
 
@@ -314,6 +327,9 @@ void CommentModel::setSorting(const CommentModel::Sorting &sorting)
     if (m_sorting == sorting)
         return;
 
+    // keep the comments of the previous sorting for switching back
+    storeToCache();
+
     m_sorting = sorting;
     emit sortingChanged(m_sorting);
 }
@@ -335,20 +351,11 @@ void CommentModel::refresh(const QModelIndex &parent)
         return;
     }
 
-    switch (m_loadingStatus) {
-        case LoadingStatus::RefreshRequested:
-            return;
-        case LoadingStatus::Refreshing:
-            // abort current requests
-            m_manager->gagRequest()->abortCommentsRequest();
-            break;
-        case LoadingStatus::FetchMoreProcessing:
-            // abort current requests
-            m_manager->gagRequest()->abortCommentsRequest();
-            break;
-        default:
-            break;
-    }
+    if (m_loadingStatus == LoadingStatus::RefreshRequested)
+        return;
+
+    // abort current requests, their parent comments are going to be removed
+    abortPendingRequests();
 
     setLoadingStatus(LoadingStatus::RefreshRequested);
 
@@ -366,6 +373,8 @@ bool CommentModel::canFetchMore(const QModelIndex &parent) const
     switch (m_loadingStatus) {
     case LoadingStatus::Idle:
         break;
+    case LoadingStatus::FetchMoreProcessing:
+        break;
     case LoadingStatus::FetchMoreFailure:
         break;
     default:
@@ -374,6 +383,11 @@ bool CommentModel::canFetchMore(const QModelIndex &parent) const
     }
 
     CommentObject *parentComment = commentForIndex(parent);
+
+    // just a single request per parent comment may be active at a time
+    if (m_pendingRequests.key(parentComment, 0) != 0)
+        return false;
+
     int fetchedChildren = parentComment->currentChildCount();
     int availableChildren = parentComment->totalChildCount();
 
@@ -393,6 +407,8 @@ bool CommentModel::canFetchMore(const QModelIndex &parent) const
 
 void CommentModel::fetchMore(const QModelIndex &parent)
 {
+    GAGBOOK_ALLOC_SCOPE("CommentModel::fetchMore");
+
     if (m_manager == 0) {
         qWarning() << "CommentModel::fetchMore(): Error! GagBookManager has not been set yet!";
         return;
@@ -409,6 +425,10 @@ void CommentModel::fetchMore(const QModelIndex &parent)
             resetChildren(parent);
             break;
         case LoadingStatus::Idle:
+            if ((m_rootComment->currentChildCount() == 0) && (parent == QModelIndex())
+                    && (restoreFromCache() || loadFromCache()))
+                return;
+
             if (m_rootComment->currentChildCount() == 0)
                 setLoadingStatus(LoadingStatus::Refreshing);
             else
@@ -416,12 +436,15 @@ void CommentModel::fetchMore(const QModelIndex &parent)
 
             break;
         case LoadingStatus::FetchMoreFailure:
+            // fall through
+        case LoadingStatus::FetchMoreProcessing:
+            if (m_pendingRequests.key(commentForIndex(parent), 0) != 0)
+                return;
+
             setLoadingStatus(LoadingStatus::FetchMoreProcessing);
             break;
         case LoadingStatus::Refreshing:
             return;
-        case LoadingStatus::FetchMoreProcessing:
-            return;
         default:
             return;
     }
@@ -465,15 +488,13 @@ void CommentModel::fetchMore(const QModelIndex &parent)
         QString()               // auth - TODO
     };
 
-    // To keep the variable valid it has to be assured that only one network request is performed at a time!
-    m_currentParentIndex = parent;
-
     connect(m_manager->gagRequest(), &GagRequest::fetchCommentsSuccess, this, &CommentModel::onFetchMoreFinished,
             Qt::UniqueConnection);
     connect(m_manager->gagRequest(), &GagRequest::fetchCommentsFailure, this, &CommentModel::onFetchMoreFailure,
             Qt::UniqueConnection);
 
-    m_manager->gagRequest()->fetchComments(params, parentComment);
+    const int requestId = m_manager->gagRequest()->fetchComments(params, parentComment, &m_commentArena);
+    m_pendingRequests.insert(requestId, parentComment);
 }
 
 QModelIndex CommentModel::indexForComment(CommentObject *commentObj) const
@@ -570,6 +591,18 @@ bool CommentModel::removeComment(const QModelIndex &index)
     CommentObject *parentComment = commentForIndex(parent);
     int pos = index.row();
 
+    // an active request must not deliver its result to the removed comment
+    const int requestId = m_pendingRequests.key(commentForIndex(index), 0);
+    if ((requestId != 0) && (m_manager != 0)) {
+        m_manager->gagRequest()->abortCommentsRequest(requestId);
+        m_pendingRequests.remove(requestId);
+
+        if (m_pendingRequests.isEmpty() && (m_loadingStatus == LoadingStatus::FetchMoreProcessing)) {
+            setLoadingStatus(m_fetchMoreFailed ? LoadingStatus::FetchMoreFailure : LoadingStatus::Idle);
+            m_fetchMoreFailed = false;
+        }
+    }
+
     beginRemoveRows(parent, pos, pos);
     parentComment->removeChild(pos);
     endRemoveRows();
@@ -587,12 +620,17 @@ void CommentModel::resetChildren(const QModelIndex &parent)
         if (m_rootComment->currentChildCount() != 0) {
             beginResetModel();
             m_rootComment->removeAllChildren();
+            m_commentArena.clear();
             endResetModel();
 
             updateIsEmpty();
         }
+        else {
+            m_commentArena.clear();
+        }
     }
     else {
+        // the removed children stay allocated in the CommentArena until the whole model is reset
         int childCount = parentComment->currentChildCount();
 
         if (childCount != 0) {
@@ -603,6 +641,164 @@ void CommentModel::resetChildren(const QModelIndex &parent)
     }
 }
 
+// Aborts all active requests of this model, so that no results are delivered for removed parents
+void CommentModel::abortPendingRequests()
+{
+    if (m_manager != 0) {
+        foreach (int requestId, m_pendingRequests.keys())
+            m_manager->gagRequest()->abortCommentsRequest(requestId);
+
+        if (m_mergeRequestId != 0)
+            m_manager->gagRequest()->abortCommentsRequest(m_mergeRequestId);
+    }
+
+    m_pendingRequests.clear();
+    m_fetchMoreFailed = false;
+    m_mergeRequestId = 0;
+    m_mergeArena.clear();
+    m_cacheLoadPending = false;
+}
+
+// Populates the empty model with the cached comments, returns false if there are none
+bool CommentModel::restoreFromCache()
+{
+    QList<CommentObject *> commentList = m_manager->commentCache()->restore(m_gagUrl, m_sorting, m_rootComment,
+                                                                             &m_commentArena);
+    if (commentList.isEmpty())
+        return false;
+
+    appendComments(QModelIndex(), commentList);
+    updateIsEmpty();
+    setLoadingStatus(LoadingStatus::Idle);
+
+    requestMerge();
+    return true;
+}
+
+// Loads the comments which are only cached on disk in the background, returns false if there are none
+bool CommentModel::loadFromCache()
+{
+    CommentCache *cache = m_manager->commentCache();
+
+    if (!cache->contains(m_gagUrl, m_sorting))
+        return false;
+
+    connect(cache, &CommentCache::loaded, this, &CommentModel::onCacheLoaded, Qt::UniqueConnection);
+
+    m_cacheLoadPending = true;
+    setLoadingStatus(LoadingStatus::Refreshing);
+    cache->load(m_gagUrl, m_sorting);
+    return true;
+}
+
+void CommentModel::storeToCache()
+{
+    if ((m_manager == 0) || m_gagUrl.isEmpty() || (m_rootComment->currentChildCount() == 0))
+        return;
+
+    m_manager->commentCache()->store(m_gagUrl, m_sorting, m_rootComment);
+}
+
+// Fetches the first page of the top-level comments to refresh the restored comments in the background
+void CommentModel::requestMerge()
+{
+    QVariantList params = {
+        m_gagUrl,               // gagUrl
+        m_fetchAmount,          // count
+        2,                      // level
+        QString(),              // refComment
+        m_sorting,              // Sorting
+        QString()               // auth - TODO
+    };
+
+    connect(m_manager->gagRequest(), &GagRequest::fetchCommentsSuccess, this, &CommentModel::onFetchMoreFinished,
+            Qt::UniqueConnection);
+    connect(m_manager->gagRequest(), &GagRequest::fetchCommentsFailure, this, &CommentModel::onFetchMoreFailure,
+            Qt::UniqueConnection);
+
+    // the root comment keeps its counts until the result has been merged
+    m_mergeArena.clear();
+    m_mergeRequestId = m_manager->gagRequest()->fetchComments(params, &m_mergeRoot, &m_mergeArena);
+}
+
+void CommentModel::onCacheLoaded(const QUrl &gagUrl, int sorting, bool success)
+{
+    if (!m_cacheLoadPending || (gagUrl != m_gagUrl) || (sorting != m_sorting))
+        return;
+
+    m_cacheLoadPending = false;
+
+    if (success && restoreFromCache())
+        return;
+
+    // the cache entry was not valid, fetch the comments instead
+    setLoadingStatus(LoadingStatus::Idle);
+    fetchMore(QModelIndex());
+}
+
+/*
+ * Merges freshly fetched comments into the children of parentComment: the upvotes and reply counts of
+ * known comments are updated, unknown top-level comments are copied into the CommentArena of the model
+ * and inserted at their fetched position. New replies are not merged, they get fetched on demand as
+ * the reply count has been updated. The fetched comments are owned by the caller.
+ */
+void CommentModel::mergeComments(CommentObject *parentComment, const QList<CommentObject *> &commentList)
+{
+    const QVector<int> changedRoles = {UpvotesRole, ChildCommentCountRole};
+    QHash<QString, CommentObject *> knownComments;
+
+    for (int i = 0; i < parentComment->currentChildCount(); ++i) {
+        CommentObject *child = parentComment->child(i);
+        knownComments.insert(child->id(), child);
+    }
+
+    for (int i = 0; i < commentList.count(); ++i) {
+        CommentObject *fetched = commentList.at(i);
+        CommentObject *known = knownComments.value(fetched->id(), 0);
+
+        if (known == 0) {
+            if (parentComment == m_rootComment) {
+                insertComment(qMin(i, parentComment->currentChildCount()), QModelIndex(),
+                              adoptComment(fetched, m_rootComment));
+            }
+
+            continue;
+        }
+
+        if ((known->upvotes() != fetched->upvotes()) || (known->totalChildCount() != fetched->totalChildCount())) {
+            known->setUpvotes(fetched->upvotes());
+            known->setTotalChildCount(fetched->totalChildCount());
+
+            const QModelIndex index = createIndex(known->row(), 0, known);
+            emit dataChanged(index, index, changedRoles);
+        }
+
+        if (parentComment == m_rootComment) {
+            QList<CommentObject *> fetchedReplies;
+            for (int j = 0; j < fetched->currentChildCount(); ++j)
+                fetchedReplies.append(fetched->child(j));
+
+            mergeComments(known, fetchedReplies);
+        }
+    }
+
+    updateIsEmpty();
+}
+
+// Copies comment and its replies into the CommentArena of the model
+CommentObject *CommentModel::adoptComment(CommentObject *comment, CommentObject *parentComment)
+{
+    CommentObject *copy = m_commentArena.create(parentComment);
+    *copy = *comment;
+
+    QList<CommentObject *> replies;
+    for (int i = 0; i < comment->currentChildCount(); ++i)
+        replies.append(adoptComment(comment->child(i), copy));
+
+    copy->appendChildren(replies);
+    return copy;
+}
+
 void CommentModel::updateIsEmpty()
 {
     bool value = m_rootComment->currentChildCount() == 0;
@@ -623,36 +819,82 @@ void CommentModel::setLoadingStatus(CommentModel::LoadingStatus status)
     emit loadingStatusChanged(m_loadingStatus);
 }
 
-void CommentModel::onFetchMoreFinished(const QList<CommentObject *> &commentList/*, const QModelIndex &parentIndex*/)
+void CommentModel::onFetchMoreFinished(int requestId, const QList<CommentObject *> &commentList)
 {
+    JankMonitor::Task guiTask("CommentModel::onFetchMoreFinished");
+    GAGBOOK_ALLOC_SCOPE("CommentModel::onFetchMoreFinished");
+
+    if ((requestId != 0) && (requestId == m_mergeRequestId)) {
+        m_mergeRequestId = 0;
+        mergeComments(m_rootComment, commentList);
+
+        // the first page does not tell anything about the pagination of the restored comments
+        m_rootComment->setTotalChildCount(m_mergeRoot.totalChildCount());
+        m_rootComment->setUser(m_mergeRoot.user());
+        m_mergeArena.clear();
+        return;
+    }
+
+    // discard results of requests from other models or of aborted requests
+    if (!m_pendingRequests.contains(requestId))
+        return;
+
+    CommentObject *parentComment = m_pendingRequests.take(requestId);
+    LoadingStatus nextStatus = LoadingStatus::FetchMoreProcessing;
+
+    // a failure of another request is reported when the last active request has finished
+    if (m_pendingRequests.isEmpty()) {
+        nextStatus = m_fetchMoreFailed ? LoadingStatus::FetchMoreFailure : LoadingStatus::Idle;
+        m_fetchMoreFailed = false;
+    }
+
     // TODO the response can also be empty if there were parse errors! -> Improve the error handling
     // no comments available
     if (commentList.isEmpty()) {
         updateIsEmpty();
-        setLoadingStatus(LoadingStatus::Idle);
+        setLoadingStatus(nextStatus);
         return;
     }
 
-    CommentObject *parentComment = commentForIndex(m_currentParentIndex);
+    const QModelIndex parentIndex = indexForComment(parentComment);
 
     int begin = parentComment->currentChildCount();
     int end = begin + commentList.count() - 1;
 
-    beginInsertRows(m_currentParentIndex, begin, end);
+    beginInsertRows(parentIndex, begin, end);
     parentComment->appendChildren(commentList);
     endInsertRows();
 
     if (parentComment == m_rootComment)
         updateIsEmpty();
 
-    setLoadingStatus(LoadingStatus::Idle);
+    setLoadingStatus(nextStatus);
 }
 
-void CommentModel::onFetchMoreFailure(const QString &errorString)
+void CommentModel::onFetchMoreFailure(int requestId, const QString &errorString)
 {
+    // the restored comments are still valid, so a failed background refresh is not reported
+    if ((requestId != 0) && (requestId == m_mergeRequestId)) {
+        m_mergeRequestId = 0;
+        m_mergeArena.clear();
+        return;
+    }
+
+    if (!m_pendingRequests.contains(requestId))
+        return;
+
+    m_pendingRequests.remove(requestId);
+
     switch (m_loadingStatus) {
         case LoadingStatus::FetchMoreProcessing:
-            setLoadingStatus(LoadingStatus::FetchMoreFailure);
+            // the requests for other parents are still active, their results would overwrite the failure
+            if (m_pendingRequests.isEmpty()) {
+                m_fetchMoreFailed = false;
+                setLoadingStatus(LoadingStatus::FetchMoreFailure);
+            }
+            else {
+                m_fetchMoreFailed = true;
+            }
             break;
         case LoadingStatus::Refreshing:
             setLoadingStatus(LoadingStatus::RefreshFailure);
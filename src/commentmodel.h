@@ -147,13 +147,23 @@ protected:
     void resetChildren(const QModelIndex &parent);
 
     void updateIsEmpty();
+    void abortPendingRequests();
+
+    bool restoreFromCache();
+    bool loadFromCache();
+    void storeToCache();
+    void requestMerge();
+    void mergeComments(CommentObject *parentComment, const QList<CommentObject *> &commentList);
+    CommentObject *adoptComment(CommentObject *comment, CommentObject *parentComment);
 
 protected slots:
     void setLoadingStatus(LoadingStatus status);
-    void onFetchMoreFinished(const QList<CommentObject *> &commentList);
-    void onFetchMoreFailure(const QString &errorString);
+    void onFetchMoreFinished(int requestId, const QList<CommentObject *> &commentList);
+    void onFetchMoreFailure(int requestId, const QString &errorString);
+    void onCacheLoaded(const QUrl &gagUrl, int sorting, bool success);
 
 private:
+    CommentArena m_commentArena;
     CommentObject *m_rootComment;
     bool m_isEmpty;
     QUrl m_gagUrl;
@@ -162,7 +172,18 @@ private:
     LoadingStatus m_loadingStatus;
     Sorting m_sorting;
 
-    QModelIndex m_currentParentIndex;
+    // the parent comment of each active request, keyed by the request id
+    QHash<int, CommentObject *> m_pendingRequests;
+    // a request has failed while others were active, reported once the last one has finished
+    bool m_fetchMoreFailed;
+
+    // the request that refreshes the comments restored from the CommentCache in the background, its
+    // comments are parsed into a detached parent and arena until they have been merged
+    int m_mergeRequestId;
+    CommentObject m_mergeRoot;
+    CommentArena m_mergeArena;
+    // the comments are being loaded from the CommentCache on disk
+    bool m_cacheLoadPending;
 
     GagBookManager *m_manager;
 };
@@ -26,6 +26,7 @@
  */
 
 #include <QDebug>
+#include <new>
 
 #include "commentobject.h"
 
@@ -58,7 +59,27 @@ public:
     bool hasMoreTopLvlComments; // needed as a workaround if NineGagApiRequest is used as data source
 
 private:
-    Q_DISABLE_COPY(CommentObjectData)
+    // only copy-constructed, to detach copies of arena-allocated CommentObjects
+    CommentObjectData &operator=(const CommentObjectData &);
+};
+
+/* A CommentArena slot keeps a CommentObject next to its data. The slot holds an additional
+ * reference on the data, so that the QExplicitlySharedDataPointer never tries to delete it. */
+struct CommentArenaSlot
+{
+    explicit CommentArenaSlot(CommentObject *parent) : data(), comment(&data, parent)
+    {
+        data.ref.ref();
+    }
+
+    ~CommentArenaSlot()
+    {
+        // copies of the comment detach, so only the slot and the comment may reference the data
+        Q_ASSERT_X(data.ref.load() <= 2, Q_FUNC_INFO, "The data of an arena slot is still referenced");
+    }
+
+    CommentObjectData data;
+    CommentObject comment;
 };
 
 
@@ -69,6 +90,8 @@ private:
 
     CommentObject contains the comment text, the UserObject, a CommentMediaObject if available and a
     list of child comments which correspond to the answers of a comment.
+    Each child keeps its index position within the list of children up to date, so that row() and
+    childIndex() do not need to search the list.
     CommentObject is an explicitly shared data object.
  */
 
@@ -77,20 +100,41 @@ private:
  * \param parent Pointer to the parent object.
  */
 CommentObject::CommentObject(CommentObject *parent)
-    : data(new CommentObjectData), m_parentComment(parent)
+    : data(new CommentObjectData), m_parentComment(parent), m_row(-1), m_isArenaAllocated(false)
 {
 
 }
 
+/*!
+ * \brief CommentObject::CommentObject Constructs a CommentObject that is owned by a CommentArena.
+ * \param arenaData Pointer to the data, which is stored in the same CommentArena slot.
+ * \param parent Pointer to the parent object.
+ */
+CommentObject::CommentObject(CommentObjectData *arenaData, CommentObject *parent)
+    : data(arenaData), m_parentComment(parent), m_row(-1), m_isArenaAllocated(true)
+{
+
+}
+
+/*!
+ * \brief CommentObject::CommentObject Constructs a copy of \a obj without its parent and children.
+ *  The copy of an arena-allocated CommentObject gets its own data, so that it can outlive the
+ *  CommentArena.
+ */
 CommentObject::CommentObject(const CommentObject &obj)
-    : data(obj.data)
+    : data(obj.m_isArenaAllocated ? new CommentObjectData(*obj.data) : obj.data.data()),
+      m_parentComment(0), m_row(-1), m_isArenaAllocated(false)
 {
 
 }
 
 CommentObject &CommentObject::operator=(const CommentObject &obj)
 {
-    data = obj.data;
+    if (obj.m_isArenaAllocated)
+        data = new CommentObjectData(*obj.data);
+    else
+        data = obj.data;
+
     return *this;
 }
 
@@ -99,7 +143,8 @@ CommentObject &CommentObject::operator=(const CommentObject &obj)
  */
 CommentObject::~CommentObject()
 {
-    qDeleteAll(m_childComments);
+    foreach (CommentObject *child, m_childComments)
+        release(child);
 }
 
 /*!
@@ -112,6 +157,7 @@ CommentObject::~CommentObject()
 void CommentObject::insertChild(int pos, CommentObject *child)
 {
     m_childComments.insert(pos, child);
+    updateChildRows(qBound(0, pos, m_childComments.count() - 1));
 }
 
 /*!
@@ -122,6 +168,7 @@ void CommentObject::insertChild(int pos, CommentObject *child)
  */
 void CommentObject::appendChild(CommentObject *child)
 {
+    child->m_row = m_childComments.count();
     m_childComments.append(child);
 }
 
@@ -133,8 +180,11 @@ void CommentObject::appendChild(CommentObject *child)
  */
 void CommentObject::appendChildren(QList<CommentObject *> commentList)
 {
-    m_childComments.reserve(commentList.count());
+    const int first = m_childComments.count();
+
+    m_childComments.reserve(first + commentList.count());
     m_childComments.append(commentList);
+    updateChildRows(first);
 }
 
 /*!
@@ -151,8 +201,10 @@ void CommentObject::removeChild(int pos)
         return;
     }
 
-    CommentObject *ptr = m_childComments.takeAt(pos);
-    delete ptr;
+    CommentObject *child = m_childComments.takeAt(pos);
+    child->m_row = -1;
+    release(child);
+    updateChildRows(pos);
 }
 
 /*!
@@ -160,7 +212,11 @@ void CommentObject::removeChild(int pos)
  */
 void CommentObject::removeAllChildren()
 {
-    qDeleteAll(m_childComments);
+    foreach (CommentObject *child, m_childComments) {
+        child->m_row = -1;
+        release(child);
+    }
+
     m_childComments.clear();
 }
 
@@ -213,6 +269,9 @@ bool CommentObject::isRootComment()
  */
 int CommentObject::childIndex(CommentObject *comment)
 {
+    if (comment && (comment->m_parentComment == this) && (m_childComments.value(comment->m_row) == comment))
+        return comment->m_row;
+
     int index = m_childComments.indexOf(comment);
 
     // no comment matched
@@ -233,18 +292,40 @@ int CommentObject::currentChildCount() const
 
 /*!
  * \brief CommentObject::row Returns the item's location within its parent's list of items.
- * \return Returns the item's index position within its parent's list of children. For the
- *  root CommentObject (i.e. has no parent) 0 is returned.
+ * \return Returns the item's index position within its parent's list of children or -1 if it
+ *  is not in the list. For the root CommentObject (i.e. has no parent) 0 is returned.
  */
 int CommentObject::row() const
 {
     if (m_parentComment) {
-        return m_parentComment->m_childComments.indexOf(const_cast<CommentObject*>(this));
+        return m_row;
     }
 
     return 0;   // the rootComment has no parent
 }
 
+/*!
+ * \brief CommentObject::updateChildRows Updates the stored index positions of the children
+ *  starting at the given index position.
+ * \param from The index position of the first child whose position has changed.
+ */
+void CommentObject::updateChildRows(int from)
+{
+    for (int i = qMax(0, from); i < m_childComments.count(); ++i)
+        m_childComments.at(i)->m_row = i;
+}
+
+/*!
+ * \brief CommentObject::release Deletes the given CommentObject unless it is owned by a
+ *  CommentArena, which frees all of its CommentObjects at once on CommentArena::clear().
+ * \param comment The CommentObject that is no longer referenced by its parent.
+ */
+void CommentObject::release(CommentObject *comment)
+{
+    if (!comment->m_isArenaAllocated)
+        delete comment;
+}
+
 QString CommentObject::id() const
 {
     return data->id;
@@ -354,3 +435,79 @@ void CommentObject::setHasMoreTopLvlComments(bool hasMore)
 {
     data->hasMoreTopLvlComments = hasMore;
 }
+
+
+/*!
+    \class CommentArena
+    \since 1.5.0
+    \brief The CommentArena class allocates CommentObjects in contiguous blocks.
+
+    Each CommentObject is placed together with its data in a slot of a preallocated block, instead
+    of performing two heap allocations per comment. CommentObjects created by the arena must not
+    be deleted manually. They are all destroyed at once by clear() or on destruction of the arena.
+    Copies of an arena-allocated CommentObject do not share its data, so they stay valid after
+    the CommentArena has been cleared.
+ */
+
+/*!
+ * \brief CommentArena::CommentArena Constructs an empty CommentArena.
+ * \param blockSize The number of CommentObjects that fit into one allocated block.
+ */
+CommentArena::CommentArena(int blockSize)
+    : m_blockSize(qMax(1, blockSize)), m_count(0)
+{
+
+}
+
+/*!
+ * \brief CommentArena::~CommentArena Destroys the CommentArena and all of its CommentObjects.
+ */
+CommentArena::~CommentArena()
+{
+    clear();
+}
+
+/*!
+ * \brief CommentArena::create Creates a new CommentObject inside the arena.
+ * \param parent Pointer to the parent object.
+ * \return Returns the new CommentObject, which stays valid until clear() is called.
+ */
+CommentObject *CommentArena::create(CommentObject *parent)
+{
+    const int slotIndex = m_count % m_blockSize;
+
+    if (slotIndex == 0) {
+        m_blocks.append(static_cast<CommentArenaSlot *>(::operator new(sizeof(CommentArenaSlot) * m_blockSize)));
+    }
+
+    CommentArenaSlot *slot = new (m_blocks.last() + slotIndex) CommentArenaSlot(parent);
+    ++m_count;
+
+    return &slot->comment;
+}
+
+/*!
+ * \brief CommentArena::clear Destroys all CommentObjects of the arena and frees the memory.
+ *  All pointers returned by create() are invalid afterwards.
+ */
+void CommentArena::clear()
+{
+    for (int i = 0; i < m_count; ++i) {
+        CommentArenaSlot *slot = m_blocks.at(i / m_blockSize) + (i % m_blockSize);
+        slot->~CommentArenaSlot();
+    }
+
+    foreach (CommentArenaSlot *block, m_blocks)
+        ::operator delete(block);
+
+    m_blocks.clear();
+    m_count = 0;
+}
+
+/*!
+ * \brief CommentArena::count Returns the number of CommentObjects allocated in the arena.
+ */
+int CommentArena::count() const
+{
+    return m_count;
+}
@@ -46,6 +46,7 @@ enum ContentType {
 Q_DECLARE_METATYPE(ContentType)
 
 class CommentObjectData;
+struct CommentArenaSlot;
 
 class CommentObject
 {
@@ -106,10 +107,36 @@ public:
     void setHasMoreTopLvlComments(bool hasMore);
 
 private:
+    friend struct CommentArenaSlot;
+
+    CommentObject(CommentObjectData *arenaData, CommentObject *parent);
+    static void release(CommentObject *comment);
+    void updateChildRows(int from);
+
     QExplicitlySharedDataPointer<CommentObjectData> data;
 
     QList<CommentObject *> m_childComments;
     CommentObject *m_parentComment;
+    int m_row;
+    bool m_isArenaAllocated;
+};
+
+class CommentArena
+{
+public:
+    explicit CommentArena(int blockSize = 64);
+    ~CommentArena();
+
+    CommentObject *create(CommentObject *parent = 0);
+    void clear();
+    int count() const;
+
+private:
+    Q_DISABLE_COPY(CommentArena)
+
+    QList<CommentArenaSlot *> m_blocks;
+    int m_blockSize;
+    int m_count;
 };
 
 #endif // COMMENTOBJECT_H
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "commentprefetcher.h"
+
+#include <QNetworkConfigurationManager>
+#include <QNetworkRequest>
+#include <QDebug>
+
+#include "gagbookmanager.h"
+#include "gagrequest.h"
+#include "appsettings.h"
+#include "commentcache.h"
+#include "commentmodel.h"
+
+static const int PREFETCH_COUNT = 5;        // comments per post
+static const int MAX_ACTIVE_REQUESTS = 2;
+static const int MAX_QUEUED_POSTS = 10;
+
+/*!
+    \class CommentPrefetcher
+    \since 1.5.0
+    \brief The CommentPrefetcher class prefetches the first comments of posts.
+
+    If enabled in the AppSettings and while connected to a WLAN, CommentPrefetcher fetches the
+    first page of the top-level comments (with the default sorting of the CommentModel) of the
+    posts that are requested via prefetch(). The requests are performed with a low network
+    priority and the results are stored in the CommentCache, so that the CommentModel can be
+    populated without delay once the comments of the post are opened.
+
+    The most recently requested posts are prefetched first and the queue is bounded, so that
+    the posts which have been scrolled past long ago are dropped.
+
+    \sa CommentCache, GagBookManager::prefetchComments()
+*/
+
+/*!
+ * \brief CommentPrefetcher::CommentPrefetcher Constructs a CommentPrefetcher.
+ * \param manager The GagBookManager which is also the parent object.
+ */
+CommentPrefetcher::CommentPrefetcher(GagBookManager *manager)
+    : QObject(manager), m_manager(manager), m_configManager(new QNetworkConfigurationManager(this)),
+      m_hasFastBearer(false)
+{
+    connect(m_configManager, &QNetworkConfigurationManager::onlineStateChanged,
+            this, &CommentPrefetcher::updateBearerState);
+    // a switch between WLAN and mobile data does not necessarily change the online state
+    connect(m_configManager, &QNetworkConfigurationManager::configurationChanged,
+            this, &CommentPrefetcher::updateBearerState);
+
+    updateBearerState();
+}
+
+/*!
+ * \brief CommentPrefetcher::~CommentPrefetcher Aborts all active requests and destroys the
+ *  CommentPrefetcher.
+ */
+CommentPrefetcher::~CommentPrefetcher()
+{
+    abortAll();
+}
+
+/*!
+ * \brief CommentPrefetcher::isEnabled Returns true if prefetching is enabled in the AppSettings
+ *  and there is an active WLAN (or wired) connection.
+ */
+bool CommentPrefetcher::isEnabled() const
+{
+    if ((m_manager->settings() == 0) || !m_manager->settings()->prefetchComments())
+        return false;
+
+    return m_hasFastBearer;
+}
+
+/*!
+ * \brief CommentPrefetcher::prefetch Queues the post for prefetching its first comments.
+ *  Nothing happens if prefetching is disabled or the comments are already cached (checked
+ *  without accessing the disk).
+ * \param gagUrl The URL of the post.
+ */
+void CommentPrefetcher::prefetch(const QUrl &gagUrl)
+{
+    if (gagUrl.isEmpty() || !isEnabled())
+        return;
+
+    if (m_queue.contains(gagUrl) || (m_activeUrls.key(gagUrl, 0) != 0))
+        return;
+
+    if (m_manager->commentCache()->contains(gagUrl, CommentModel::Hot))
+        return;
+
+    m_queue.prepend(gagUrl);
+
+    if (m_queue.count() > MAX_QUEUED_POSTS)
+        m_queue.removeLast();
+
+    startNext();
+}
+
+/*!
+ * \brief CommentPrefetcher::abortAll Clears the queue and aborts all active requests.
+ */
+void CommentPrefetcher::abortAll()
+{
+    m_queue.clear();
+
+    // the GagRequest must not be created here, this also runs when the GagBookManager is destroyed
+    foreach (int requestId, m_activeUrls.keys()) {
+        if (!m_gagRequest.isNull())
+            m_gagRequest->abortCommentsRequest(requestId);
+
+        finishRequest(requestId);
+    }
+}
+
+void CommentPrefetcher::startNext()
+{
+    // the posts are only prefetched with the GagRequest that has been created for the models
+    if (!m_manager->hasGagRequest())
+        return;
+
+    while ((m_activeUrls.count() < MAX_ACTIVE_REQUESTS) && !m_queue.isEmpty()) {
+        const QUrl gagUrl = m_queue.takeFirst();
+
+        if (m_manager->commentCache()->contains(gagUrl, CommentModel::Hot))
+            continue;
+
+        // TODO this is only valid for NineGagApiRequest
+        QVariantList params = {
+            gagUrl,                             // gagUrl
+            PREFETCH_COUNT,                     // count
+            2,                                  // level
+            QString(),                          // refComment
+            CommentModel::Hot,                  // Sorting
+            QString(),                          // auth - TODO
+            QNetworkRequest::LowPriority        // priority
+        };
+
+        GagRequest *gagRequest = m_manager->gagRequest();
+        m_gagRequest = gagRequest;
+
+        connect(gagRequest, &GagRequest::fetchCommentsSuccess, this, &CommentPrefetcher::onFetchFinished,
+                Qt::UniqueConnection);
+        connect(gagRequest, &GagRequest::fetchCommentsFailure, this, &CommentPrefetcher::onFetchFailure,
+                Qt::UniqueConnection);
+
+        CommentObject *rootComment = new CommentObject();
+        CommentArena *arena = new CommentArena(PREFETCH_COUNT * 4);
+        const int requestId = gagRequest->fetchComments(params, rootComment, arena);
+
+        m_activeUrls.insert(requestId, gagUrl);
+        m_activeRoots.insert(requestId, rootComment);
+        m_activeArenas.insert(requestId, arena);
+    }
+}
+
+// Removes the request and frees its comments
+void CommentPrefetcher::finishRequest(int requestId)
+{
+    m_activeUrls.remove(requestId);
+    delete m_activeRoots.take(requestId);
+    delete m_activeArenas.take(requestId);
+}
+
+void CommentPrefetcher::onFetchFinished(int requestId, const QList<CommentObject *> &commentList)
+{
+    // discard results of the requests of the CommentModels
+    if (!m_activeUrls.contains(requestId))
+        return;
+
+    CommentObject *rootComment = m_activeRoots.value(requestId);
+
+    if (!commentList.isEmpty()) {
+        rootComment->appendChildren(commentList);
+        m_manager->commentCache()->store(m_activeUrls.value(requestId), CommentModel::Hot, rootComment);
+    }
+
+    finishRequest(requestId);
+    startNext();
+}
+
+void CommentPrefetcher::onFetchFailure(int requestId, const QString &errorString)
+{
+    if (!m_activeUrls.contains(requestId))
+        return;
+
+    qDebug() << "CommentPrefetcher::onFetchFailure():" << m_activeUrls.value(requestId) << errorString;
+
+    finishRequest(requestId);
+    startNext();
+}
+
+void CommentPrefetcher::updateBearerState()
+{
+    m_hasFastBearer = false;
+
+    foreach (const QNetworkConfiguration &config, m_configManager->allConfigurations(QNetworkConfiguration::Active)) {
+        if ((config.bearerType() == QNetworkConfiguration::BearerWLAN) ||
+                (config.bearerType() == QNetworkConfiguration::BearerEthernet)) {
+            m_hasFastBearer = true;
+            break;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMMENTPREFETCHER_H
+#define COMMENTPREFETCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QUrl>
+#include <QPointer>
+
+#include "commentobject.h"
+
+class GagBookManager;
+class GagRequest;
+class QNetworkConfigurationManager;
+
+class CommentPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CommentPrefetcher(GagBookManager *manager);
+    ~CommentPrefetcher();
+
+    bool isEnabled() const;
+
+    void prefetch(const QUrl &gagUrl);
+    void abortAll();
+
+private slots:
+    void onFetchFinished(int requestId, const QList<CommentObject *> &commentList);
+    void onFetchFailure(int requestId, const QString &errorString);
+    void updateBearerState();
+
+private:
+    void startNext();
+    void finishRequest(int requestId);
+
+    GagBookManager *m_manager;
+    // the GagRequest which performs the active requests, it may be destroyed before the prefetcher
+    QPointer<GagRequest> m_gagRequest;
+    QNetworkConfigurationManager *m_configManager;
+    // an active WLAN or wired connection, updated when the configurations change
+    bool m_hasFastBearer;
+
+    QList<QUrl> m_queue;
+
+    // the gag URL, root comment and CommentArena of each active request, keyed by the request id
+    QHash<int, QUrl> m_activeUrls;
+    QHash<int, CommentObject *> m_activeRoots;
+    QHash<int, CommentArena *> m_activeArenas;
+};
+
+#endif // COMMENTPREFETCHER_H
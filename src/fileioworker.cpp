@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "fileioworker.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QSettings>
+#include <QtCore/QStringList>
+#include <QtCore/QDebug>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+// the time to wait for further jobs after the first job of a batch has been posted
+static const unsigned long BATCH_DELAY_MS = 50;
+
+// Flushes the written data of the file to the disk, but not the data of other files of the file system
+static bool syncFile(const QString &fileName)
+{
+#ifdef Q_OS_LINUX
+    const int fd = ::open(QFile::encodeName(fileName).constData(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    const bool success = (::fdatasync(fd) == 0);
+    ::close(fd);
+    return success;
+#else
+    Q_UNUSED(fileName);
+    return true;
+#endif
+}
+
+// Renames the file to newName and replaces an existing file, on Linux atomically. A replaced file
+// stays valid for readers which have opened or mapped it.
+static bool replaceFile(const QString &fileName, const QString &newName)
+{
+#ifdef Q_OS_LINUX
+    return (::rename(QFile::encodeName(fileName).constData(), QFile::encodeName(newName).constData()) == 0);
+#else
+    QFile::remove(newName);
+    return QFile::rename(fileName, newName);
+#endif
+}
+
+FileIoWorker *FileIoWorker::m_instance = 0;
+
+FileIoWorker::FileIoWorker(QObject *parent) :
+    QThread(parent), m_nextId(0), m_lastDoneId(-1), m_quit(false)
+{
+    Q_ASSERT_X(m_instance == 0, Q_FUNC_INFO, "There must be only one FileIoWorker");
+    m_instance = this;
+
+    start(QThread::LowPriority);
+}
+
+FileIoWorker::~FileIoWorker()
+{
+    m_mutex.lock();
+    m_quit = true;
+    m_jobsPosted.wakeOne();
+    m_mutex.unlock();
+
+    wait();
+    m_instance = 0;
+}
+
+FileIoWorker *FileIoWorker::instance()
+{
+    Q_ASSERT_X(m_instance != 0, Q_FUNC_INFO, "The FileIoWorker must be created in main()");
+    return m_instance;
+}
+
+int FileIoWorker::write(const QString &fileName, const QByteArray &data)
+{
+    return post(WriteJob, fileName, QString(), data);
+}
+
+int FileIoWorker::append(const QString &fileName, const QByteArray &data)
+{
+    return post(AppendJob, fileName, QString(), data);
+}
+
+int FileIoWorker::rename(const QString &fileName, const QString &newName)
+{
+    return post(RenameJob, fileName, newName);
+}
+
+int FileIoWorker::remove(const QString &fileName)
+{
+    return post(RemoveJob, fileName);
+}
+
+int FileIoWorker::copy(const QString &fileName, const QString &newName)
+{
+    return post(CopyJob, fileName, newName);
+}
+
+int FileIoWorker::read(const QString &fileName)
+{
+    return post(ReadJob, fileName);
+}
+
+int FileIoWorker::setSettingsValue(const QString &key, const QVariant &value)
+{
+    return post(SetSettingsJob, key, QString(), QByteArray(), value);
+}
+
+int FileIoWorker::removeSettingsValue(const QString &key)
+{
+    return post(RemoveSettingsJob, key);
+}
+
+void FileIoWorker::waitForDone()
+{
+    QMutexLocker locker(&m_mutex);
+    const int lastId = m_nextId - 1;
+
+    while (m_lastDoneId < lastId)
+        m_batchDone.wait(&m_mutex);
+}
+
+int FileIoWorker::post(JobType type, const QString &path, const QString &newPath,
+                       const QByteArray &data, const QVariant &value)
+{
+    QMutexLocker locker(&m_mutex);
+    const int id = m_nextId++;
+
+    if (coalesce(type, path, id, data, value))
+        return id;
+
+    Job job;
+    job.type = type;
+    job.ids.append(id);
+    job.path = path;
+    job.newPath = newPath;
+    job.data = data;
+    job.value = value;
+    m_jobs.append(job);
+
+    m_jobsPosted.wakeOne();
+    return id;
+}
+
+// Replaces the data of a pending job which writes the same file (or setting), or appends the data
+// to it, if no other pending job accesses it afterwards. Must be called with the mutex locked.
+bool FileIoWorker::coalesce(JobType type, const QString &path, int id, const QByteArray &data,
+                            const QVariant &value)
+{
+    const bool isSettingsJob = (type == SetSettingsJob || type == RemoveSettingsJob);
+
+    if (type != WriteJob && type != AppendJob && !isSettingsJob)
+        return false;
+
+    for (int i = m_jobs.count() - 1; i >= 0; --i) {
+        Job &job = m_jobs[i];
+        const bool isPendingSettingsJob = (job.type == SetSettingsJob || job.type == RemoveSettingsJob);
+
+        if (isSettingsJob != isPendingSettingsJob)
+            continue;
+
+        if (job.path != path && job.newPath != path)
+            continue;
+
+        if (job.newPath == path)
+            return false;
+
+        if (type == AppendJob) {
+            // the data is appended to the pending write or append
+            if (job.type != WriteJob && job.type != AppendJob)
+                return false;
+
+            job.ids.append(id);
+            job.data.append(data);
+            return true;
+        }
+
+        if (job.type != type && !isSettingsJob)
+            return false;
+
+        job.type = type;
+        job.ids.append(id);
+        job.data = data;
+        job.value = value;
+        return true;
+    }
+
+    return false;
+}
+
+void FileIoWorker::run()
+{
+    QSettings settings;
+
+    forever {
+        m_mutex.lock();
+        while (m_jobs.isEmpty() && !m_quit)
+            m_jobsPosted.wait(&m_mutex);
+
+        if (m_jobs.isEmpty()) {
+            m_mutex.unlock();
+            return;
+        }
+
+        bool hasReadJob = false;
+        foreach (const Job &job, m_jobs)
+            hasReadJob = hasReadJob || (job.type == ReadJob);
+
+        // give the poster the chance to post more jobs which are written within the same batch,
+        // reads are not delayed since someone is waiting for the data
+        if (!m_quit && !hasReadJob) {
+            m_mutex.unlock();
+            msleep(BATCH_DELAY_MS);
+            m_mutex.lock();
+        }
+
+        const QList<Job> jobs = m_jobs;
+        const int lastId = m_nextId - 1;
+        m_jobs.clear();
+        m_mutex.unlock();
+
+        QList<bool> results;
+        bool settingsChanged = false;
+
+        foreach (const Job &job, jobs) {
+            if (job.type == SetSettingsJob) {
+                settings.setValue(job.path, job.value);
+                settingsChanged = true;
+                results.append(true);
+            }
+            else if (job.type == RemoveSettingsJob) {
+                settings.remove(job.path);
+                settingsChanged = true;
+                results.append(true);
+            }
+            else {
+                results.append(process(job));
+            }
+        }
+
+        // the settings must survive a crash or power loss, the cache files can be fetched again
+        if (settingsChanged) {
+            settings.sync();
+
+            if ((settings.status() != QSettings::NoError) || !syncFile(settings.fileName())) {
+                qWarning("FileIoWorker::run(): Unable to write the settings");
+
+                for (int i = 0; i < jobs.count(); ++i) {
+                    if (jobs.at(i).type == SetSettingsJob || jobs.at(i).type == RemoveSettingsJob)
+                        results[i] = false;
+                }
+            }
+        }
+
+        for (int i = 0; i < jobs.count(); ++i) {
+            foreach (int id, jobs.at(i).ids)
+                emit jobFinished(id, results.at(i));
+        }
+
+        m_mutex.lock();
+        m_lastDoneId = lastId;
+        m_batchDone.wakeAll();
+        m_mutex.unlock();
+    }
+}
+
+// Performs a file job
+bool FileIoWorker::process(const Job &job)
+{
+    bool success = false;
+
+    switch (job.type) {
+    case WriteJob: {
+        // truncating the file in place would crash a reader which has mapped it (see MappedFile),
+        // so the data is written to a new file which replaces it
+        const QString partPath = job.path + ".part";
+        QFile file(partPath);
+        if (file.open(QIODevice::WriteOnly)) {
+            success = (file.write(job.data) == job.data.size());
+            file.close();
+        }
+
+        if (success)
+            success = replaceFile(partPath, job.path);
+        else
+            QFile::remove(partPath);
+
+        if (!success) {
+            qWarning("FileIoWorker::process(): Unable to write [%s]: %s",
+                     qPrintable(job.path), qPrintable(file.errorString()));
+        }
+        break;
+    }
+    case AppendJob: {
+        QFile file(job.path);
+        if (file.open(QIODevice::Append)) {
+            success = (file.write(job.data) == job.data.size());
+            file.close();
+        }
+
+        if (!success) {
+            qWarning("FileIoWorker::process(): Unable to write [%s]: %s",
+                     qPrintable(job.path), qPrintable(file.errorString()));
+        }
+        break;
+    }
+    case RenameJob:
+        success = replaceFile(job.path, job.newPath);
+        break;
+    case RemoveJob:
+        success = QFile::remove(job.path) || !QFile::exists(job.path);
+        break;
+    case CopyJob:
+        success = MappedFile::copy(job.path, job.newPath);
+        break;
+    case ReadJob: {
+        QFile file(job.path);
+        QByteArray data;
+        if (file.open(QIODevice::ReadOnly)) {
+            data = file.readAll();
+            success = true;
+        }
+
+        emit fileRead(job.ids.first(), data);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return success;
+}
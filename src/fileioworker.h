@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FILEIOWORKER_H
+#define FILEIOWORKER_H
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QList>
+#include <QtCore/QVariant>
+
+/*! Worker thread for file system writes
+
+    Performs writes, renames, removals, copies and reads of files as well as writes of
+    the app settings in a single thread, so that the GUI thread is never blocked by the
+    file system. Jobs are processed in the order in which they have been posted and
+    are collected into batches: multiple writes of the same file (or setting) in a
+    batch are coalesced. A written file is replaced by a new file instead of being
+    truncated, since other threads may have mapped it (see MappedFile). The written
+    files are caches, so they are not synced to the disk. Only the settings file is
+    flushed (fdatasync) in a batch which changed it.
+
+    There is one instance per application, which must be created in main() before
+    any other object that posts jobs and outlive them. Pending jobs are completed
+    when the worker is destroyed.
+ */
+class FileIoWorker : public QThread
+{
+    Q_OBJECT
+public:
+    /*! Constructor, starts the thread. */
+    explicit FileIoWorker(QObject *parent = 0);
+
+    /*! Destructor, completes all pending jobs and stops the thread. */
+    ~FileIoWorker();
+
+    /*! Get the instance of the application. */
+    static FileIoWorker *instance();
+
+    /*! Post a job to write \p data to the file \p fileName, an existing file is replaced
+        atomically by the file "<fileName>.part". Returns the id of the job. */
+    int write(const QString &fileName, const QByteArray &data);
+
+    /*! Post a job to append \p data to the file \p fileName, the file is created if it doesn't
+        exist. Returns the id of the job. */
+    int append(const QString &fileName, const QByteArray &data);
+
+    /*! Post a job to rename the file \p fileName to \p newName, an existing file is replaced
+        atomically. Returns the id of the job. */
+    int rename(const QString &fileName, const QString &newName);
+
+    /*! Post a job to remove the file \p fileName. Returns the id of the job. */
+    int remove(const QString &fileName);
+
+    /*! Post a job to copy the file \p fileName to \p newName, the copy fails if
+        \p newName already exists. Returns the id of the job. */
+    int copy(const QString &fileName, const QString &newName);
+
+    /*! Post a job to read the file \p fileName, the content is passed to fileRead(). A read
+        sees all writes of the file which have been posted before. Returns the id of the job. */
+    int read(const QString &fileName);
+
+    /*! Post a job to set the QSettings value \p key of the application to \p value.
+        Returns the id of the job. */
+    int setSettingsValue(const QString &key, const QVariant &value);
+
+    /*! Post a job to remove the QSettings value \p key of the application. Returns the id
+        of the job. */
+    int removeSettingsValue(const QString &key);
+
+    /*! Block until all jobs posted so far have been completed. */
+    void waitForDone();
+
+signals:
+    /*! Emit in the worker thread when the job with the id \p jobId has been completed. */
+    void jobFinished(int jobId, bool success);
+
+    /*! Emit in the worker thread before jobFinished() when the read job with the id \p jobId
+        has been completed, \p data is empty if the file could not be read. */
+    void fileRead(int jobId, const QByteArray &data);
+
+protected:
+    void run();
+
+private:
+    enum JobType {
+        WriteJob,
+        AppendJob,
+        RenameJob,
+        RemoveJob,
+        CopyJob,
+        ReadJob,
+        SetSettingsJob,
+        RemoveSettingsJob
+    };
+
+    struct Job {
+        JobType type;
+        QList<int> ids;     // the ids of all coalesced jobs
+        QString path;       // the file name or the settings key
+        QString newPath;
+        QByteArray data;
+        QVariant value;
+    };
+
+    int post(JobType type, const QString &path, const QString &newPath = QString(),
+             const QByteArray &data = QByteArray(), const QVariant &value = QVariant());
+    bool coalesce(JobType type, const QString &path, int id, const QByteArray &data,
+                  const QVariant &value);
+    bool process(const Job &job);
+
+    static FileIoWorker *m_instance;
+
+    QMutex m_mutex;
+    QWaitCondition m_jobsPosted;
+    QWaitCondition m_batchDone;
+    QList<Job> m_jobs;
+    int m_nextId;
+    int m_lastDoneId;
+    bool m_quit;
+};
+
+#endif // FILEIOWORKER_H
@@ -33,15 +33,21 @@
 #include <QtNetwork/QNetworkReply>
 #include <QtCore/QUrlQuery>
 #include <QtCore/QDateTime>
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
 
 #include "networkmanager.h"
 #include "gagimagedownloader.h"
 #include "appsettings.h"
 #include "ninegagapirequest.h"
+#include "commentcache.h"
+#include "commentprefetcher.h"
+#include "metricsregistry.h"
 
 GagBookManager::GagBookManager(QObject *parent) :
     QObject(parent), m_isBusy(false), m_settings(0),
-    m_netManager(new NetworkManager(this)), m_loginReply(0), m_gagRequest(0)
+    m_netManager(new NetworkManager(this)), m_commentCache(new CommentCache(this)),
+    m_commentPrefetcher(new CommentPrefetcher(this)), m_loginReply(0), m_gagRequest(0)
 {
     GagImageDownloader::initializeCache();
     connect(m_netManager, SIGNAL(downloadCounterChanged()), SIGNAL(downloadCounterChanged()));
@@ -67,11 +73,37 @@ void GagBookManager::setSettings(AppSettings *settings)
     m_settings = settings;
 }
 
+MetricsRegistry *GagBookManager::metrics() const
+{
+    return MetricsRegistry::instance();
+}
+
 NetworkManager *GagBookManager::networkManager() const
 {
     return m_netManager;
 }
 
+CommentCache *GagBookManager::commentCache() const
+{
+    return m_commentCache;
+}
+
+MediaQualityPolicy GagBookManager::mediaQualityPolicy() const
+{
+    const bool dataSaver = (m_settings != 0) && m_settings->dataSaver();
+
+    // the posts are shown in the width of the screen in portrait orientation
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    const int screenWidth = (screen != 0) ? qMin(screen->size().width(), screen->size().height()) : 540;
+
+    return MediaQualityPolicy::evaluate(m_netManager->throughput(), dataSaver, screenWidth);
+}
+
+void GagBookManager::prefetchComments(const QUrl &gagUrl)
+{
+    m_commentPrefetcher->prefetch(gagUrl);
+}
+
 void GagBookManager::login(const QString &username, const QString &password)
 {
     Q_ASSERT(m_netManager);
@@ -112,6 +144,11 @@ GagRequest *GagBookManager::gagRequest()
     return m_gagRequest;
 }
 
+bool GagBookManager::hasGagRequest() const
+{
+    return m_gagRequest != 0;
+}
+
 void GagBookManager::initGagRequest()
 {
     if (m_gagRequest == 0) {
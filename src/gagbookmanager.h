@@ -34,7 +34,10 @@
 #include "gagrequest.h"
 
 class NetworkManager;
+class CommentCache;
+class CommentPrefetcher;
 class AppSettings;
+class MetricsRegistry;
 class QNetworkReply;
 
 /*! Handle login and hold other global instance class
@@ -58,6 +61,9 @@ class GagBookManager : public QObject
         can not be change afterward. */
     Q_PROPERTY(AppSettings *settings READ settings WRITE setSettings)
 
+    /*! The performance metrics of the app session, see MetricsRegistry. */
+    Q_PROPERTY(MetricsRegistry *metrics READ metrics CONSTANT)
+
 public:
     explicit GagBookManager(QObject *parent = 0);
 
@@ -68,9 +74,22 @@ public:
     AppSettings *settings() const;
     void setSettings(AppSettings *settings);
 
+    /*! Get the MetricsRegistry of the application. */
+    MetricsRegistry *metrics() const;
+
     /*! Get the global instance of NetworkManager. */
     NetworkManager *networkManager() const;
 
+    /*! Get the global instance of CommentCache. */
+    CommentCache *commentCache() const;
+
+    /*! Evaluate the policy for the media renditions of the next page of posts. */
+    MediaQualityPolicy mediaQualityPolicy() const;
+
+    /*! Prefetch the first comments of the post in the background, if enabled in the
+        settings and connected to a WLAN. Should be called for the visible posts. */
+    Q_INVOKABLE void prefetchComments(const QUrl &gagUrl);
+
     /*! Login to 9GAG account. If login success, loginSuccess() will emit, otherwise
         loginFailure() will emit. */
     Q_INVOKABLE void login(const QString &username, const QString &password);
@@ -80,6 +99,9 @@ public:
 
     GagRequest *gagRequest();
 
+    /*! True if the GagRequest has been created, gagRequest() creates it on demand. */
+    bool hasGagRequest() const;
+
 private:
     void initGagRequest();
 
@@ -101,6 +123,8 @@ private:
     bool m_isBusy;
     AppSettings *m_settings;
     NetworkManager *m_netManager;
+    CommentCache *m_commentCache;
+    CommentPrefetcher *m_commentPrefetcher;
     QNetworkReply *m_loginReply;
     GagRequest *m_gagRequest;
 };
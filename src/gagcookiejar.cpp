@@ -30,6 +30,8 @@
 #include <QtCore/QSettings>
 #include <QtNetwork/QNetworkCookie>
 
+#include "fileioworker.h"
+
 GagCookieJar::GagCookieJar(QObject *parent) :
     QNetworkCookieJar(parent)
 {
@@ -52,13 +54,11 @@ GagCookieJar::~GagCookieJar()
     }
     rawCookies.chop(1); // chop the last extra "\n"
 
-    QSettings settings;
-    settings.setValue("cookies", rawCookies);
+    FileIoWorker::instance()->setSettingsValue("cookies", rawCookies);
 }
 
 void GagCookieJar::clear()
 {
     setAllCookies(QList<QNetworkCookie>());
-    QSettings settings;
-    settings.remove("cookies");
+    FileIoWorker::instance()->removeSettingsValue("cookies");
 }
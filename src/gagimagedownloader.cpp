@@ -28,16 +28,51 @@
 
 #include "gagimagedownloader.h"
 
+#include <QtCore/QBuffer>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QStandardPaths>
 #include <QtGui/QImageReader>
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
 #include <QtNetwork/QNetworkReply>
 
 #include "networkmanager.h"
+#include "imagesavejob.h"
+#include "fileioworker.h"
+#include "videoposterextractor.h"
+#include "allocprofiler.h"
+#include "jankmonitor.h"
+#include "tracing.h"
 
 static const QString FILE_CACHE_PATH = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
         + "/harbour-gagbook";
 
+// the thumbnails are scaled to the width of the screen in portrait orientation
+static int thumbnailWidth()
+{
+    const QScreen *screen = QGuiApplication::primaryScreen();
+
+    if (screen == 0)
+        return 540;
+
+    return qMin(screen->size().width(), screen->size().height());
+}
+
+// Returns the path of the cache file for the downloaded URL
+static QString cacheFileName(const QUrl &url)
+{
+    const QString urlStr = url.toString();
+    return FILE_CACHE_PATH + "/" + urlStr.mid(urlStr.lastIndexOf("/") + 1);
+}
+
+// Returns the path to which a streamed download is written until it is complete, the cache file
+// is replaced by it afterwards, so it is never seen (or mapped) incomplete
+static QString streamFileName(const QString &fileName)
+{
+    return fileName + ".download";
+}
+
 void GagImageDownloader::initializeCache()
 {
     // create the cache dir if not existent
@@ -48,8 +83,9 @@ void GagImageDownloader::initializeCache()
 
 GagImageDownloader::GagImageDownloader(NetworkManager *networkManager, QObject *parent) :
     QObject(parent), m_networkManager(networkManager), m_downloadPartialImage(false),
-    m_downloadGIF(false), m_downloadVideo(false)
+    m_downloadGIF(false), m_downloadVideo(false), m_extractVideoPosters(false)
 {
+    connect(FileIoWorker::instance(), SIGNAL(jobFinished(int,bool)), SLOT(onFileWritten(int,bool)));
 }
 
 QList<GagObject> GagImageDownloader::gagList() const
@@ -87,6 +123,11 @@ void GagImageDownloader::setDownloadVideo(bool downloadVideo)
     m_downloadVideo = downloadVideo;
 }
 
+void GagImageDownloader::setExtractVideoPosters(bool extractVideoPosters)
+{
+    m_extractVideoPosters = extractVideoPosters;
+}
+
 void GagImageDownloader::start()
 {
     // if there are still downloads ongoing when start() is called then
@@ -121,14 +162,23 @@ void GagImageDownloader::start()
             downloadImageUrl = gag.gifImageUrl();
         else if (m_downloadPartialImage)
             downloadImageUrl = gag.fullImageUrl();
+        else if (isPosterExtracted(gag))
+            downloadImageUrl = gag.videoUrl();
         else
             downloadImageUrl = gag.imageUrl();
 
         QNetworkReply *reply = m_networkManager->createGetRequest(downloadImageUrl, NetworkManager::Image);
         // make sure the QNetworkReply will be destroy when this object is destroyed
         reply->setParent(this);
+        GAGBOOK_TRACE_REPLY(reply, "Media download");
         m_replyHash.insert(reply, gag);
         connect(reply, SIGNAL(finished()), SLOT(onFinished()));
+
+        // videos are written while they are downloaded instead of being buffered completely
+        if (m_downloadVideo || isPosterExtracted(gag)) {
+            m_streamedBytes.insert(reply, 0);
+            connect(reply, SIGNAL(readyRead()), SLOT(onReadyRead()));
+        }
     }
 
     m_imagesTotal = m_replyHash.count();
@@ -149,48 +199,58 @@ void GagImageDownloader::stop()
     }
 }
 
+bool GagImageDownloader::isExtractingPosters() const
+{
+    return !m_posterJobs.isEmpty();
+}
+
 void GagImageDownloader::onFinished()
 {
+    GAGBOOK_TRACE_SCOPE("GagImageDownloader::onFinished");
+    JankMonitor::Task guiTask("GagImageDownloader::onFinished");
+    GAGBOOK_ALLOC_SCOPE("GagImageDownloader::onFinished");
+
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
     Q_ASSERT_X(reply != 0, Q_FUNC_INFO, "Unable to cast sender() to QNetworkReply *");
 
     if (reply->error() == QNetworkReply::NoError) {
-        const QString urlStr = reply->url().toString();
-        const QString fileName = FILE_CACHE_PATH + "/" + urlStr.mid(urlStr.lastIndexOf("/") + 1);
-
-        QFile image(fileName);
-        bool opened = image.open(QIODevice::WriteOnly);
-        if (opened) {
-            image.write(reply->readAll());
-            image.close();
-
-            GagObject gag = m_replyHash.value(reply);
-            if (m_downloadVideo) {
-                if (gag.imageUrl().isEmpty())
-                    gag.setImageUrl(QUrl::fromLocalFile(fileName));
-                gag.setVideoUrl(QUrl::fromLocalFile(fileName));
-            }
-            else if (m_downloadGIF) {
-                if (gag.imageUrl().isEmpty())
-                    gag.setImageUrl(QUrl::fromLocalFile(fileName));
-                gag.setGifImageUrl(QUrl::fromLocalFile(fileName));
-            }
-            else if (m_downloadPartialImage) {
-                if (gag.imageUrl().isEmpty())
-                    gag.setImageUrl(QUrl::fromLocalFile(fileName));
-                gag.setFullImageUrl(QUrl::fromLocalFile(fileName));
-            }
-            else {
-                gag.setImageUrl(QUrl::fromLocalFile(fileName));
+        const QString fileName = cacheFileName(reply->url());
+        GagObject gag = m_replyHash.value(reply);
+        int jobId;
+
+        if (m_streamedBytes.contains(reply)) {
+            // write the rest of the streamed file and move it to the cache file
+            const QByteArray data = reply->readAll();
+            const qint64 streamedBytes = m_streamedBytes.take(reply);
+
+            if (streamedBytes == 0)
+                FileIoWorker::instance()->write(streamFileName(fileName), data);
+            else
+                FileIoWorker::instance()->append(streamFileName(fileName), data);
+
+            jobId = FileIoWorker::instance()->rename(streamFileName(fileName), fileName);
+            m_expectedSizes.insert(jobId, streamedBytes + data.size());
+        }
+        else {
+            const QByteArray imageData = reply->readAll();
+
+            // probe the downloaded data instead of opening and reading the written file again
+            if (!m_downloadPartialImage) {
+                QBuffer buffer;
+                buffer.setData(imageData);
+                gag.setImageSize(QImageReader(&buffer).size());
             }
 
-            if (!m_downloadPartialImage)
-                gag.setImageSize(QImageReader(&image).size());
-        } else {
-            qWarning("GagImageDownloader::onFinished(): Unable to open QFile [with fileName = %s] for writing: %s",
-                     qPrintable(fileName), qPrintable(image.errorString()));
+            jobId = FileIoWorker::instance()->write(fileName, imageData);
         }
+
+        // the local URLs are set when the file has been written (see onFileWritten())
+        m_writeJobs.insert(jobId, qMakePair(gag, fileName));
     } else {
+        // remove the incomplete file
+        if (m_streamedBytes.take(reply) > 0)
+            FileIoWorker::instance()->remove(streamFileName(cacheFileName(reply->url())));
+
         if (reply->error() != QNetworkReply::OperationCanceledError) {
             qWarning("GagImageDownloader::onFinished(): Network error for [%s]: %s",
                      qPrintable(reply->url().toString()), qPrintable(reply->errorString()));
@@ -204,6 +264,156 @@ void GagImageDownloader::onFinished()
     reply->deleteLater();
 
     emit downloadProgress(m_imagesTotal - m_replyHash.count(), m_imagesTotal);
-    if (m_replyHash.isEmpty())
+    emitFinishedIfDone();
+}
+
+void GagImageDownloader::onReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    Q_ASSERT_X(reply != 0, Q_FUNC_INFO, "Unable to cast sender() to QNetworkReply *");
+
+    if (reply->error() != QNetworkReply::NoError || !m_streamedBytes.contains(reply))
+        return;
+
+    const QByteArray data = reply->readAll();
+    if (data.isEmpty())
+        return;
+
+    const QString fileName = streamFileName(cacheFileName(reply->url()));
+    qint64 &streamedBytes = m_streamedBytes[reply];
+
+    // the first part replaces an existing file, consecutive parts are coalesced by the worker
+    if (streamedBytes == 0)
+        FileIoWorker::instance()->write(fileName, data);
+    else
+        FileIoWorker::instance()->append(fileName, data);
+
+    streamedBytes += data.size();
+}
+
+void GagImageDownloader::onFileWritten(int jobId, bool success)
+{
+    JankMonitor::Task guiTask("GagImageDownloader::onFileWritten");
+
+    if (!m_writeJobs.contains(jobId))
+        return;
+
+    const QPair<GagObject, QString> writeJob = m_writeJobs.take(jobId);
+    GagObject gag = writeJob.first;
+    const QString &fileName = writeJob.second;
+
+    // a streamed file is complete if all its parts have been written, the jobs are done in order
+    if (success && m_expectedSizes.contains(jobId))
+        success = (QFileInfo(fileName).size() == m_expectedSizes.value(jobId));
+    m_expectedSizes.remove(jobId);
+
+    if (success) {
+        if (m_downloadVideo) {
+            if (gag.imageUrl().isEmpty())
+                gag.setImageUrl(QUrl::fromLocalFile(fileName));
+            gag.setVideoUrl(QUrl::fromLocalFile(fileName));
+        }
+        else if (m_downloadGIF) {
+            if (gag.imageUrl().isEmpty())
+                gag.setImageUrl(QUrl::fromLocalFile(fileName));
+            gag.setGifImageUrl(QUrl::fromLocalFile(fileName));
+        }
+        else if (m_downloadPartialImage) {
+            if (gag.imageUrl().isEmpty())
+                gag.setImageUrl(QUrl::fromLocalFile(fileName));
+            gag.setFullImageUrl(QUrl::fromLocalFile(fileName));
+        }
+        else if (isPosterExtracted(gag)) {
+            gag.setVideoUrl(QUrl::fromLocalFile(fileName));
+            startPosterJob(gag, fileName);
+        }
+        else {
+            gag.setImageUrl(QUrl::fromLocalFile(fileName));
+        }
+
+        if (!m_downloadVideo && !m_downloadGIF && !m_downloadPartialImage && !isPosterExtracted(gag))
+            startThumbnailJob(gag, fileName);
+    } else {
+        qWarning("GagImageDownloader::onFileWritten(): Unable to write the file [%s]", qPrintable(fileName));
+    }
+
+    emitFinishedIfDone();
+}
+
+bool GagImageDownloader::isPosterExtracted(const GagObject &gag) const
+{
+    return m_extractVideoPosters && gag.isVideo() && !gag.videoUrl().isEmpty()
+            && !m_downloadVideo && !m_downloadGIF && !m_downloadPartialImage;
+}
+
+// The posters are not waited for, since they are extracted one after another (see VideoPosterExtractor)
+void GagImageDownloader::emitFinishedIfDone()
+{
+    if (m_replyHash.isEmpty() && m_writeJobs.isEmpty() && m_thumbnailJobs.isEmpty())
         emit finished();
 }
+
+// Creates a downscaled copy of the title image in a worker thread, which is shown in the list of posts
+// instead of the original image (to avoid decoding the full image on every creation of a delegate)
+void GagImageDownloader::startThumbnailJob(const GagObject &gag, const QString &fileName)
+{
+    const int width = thumbnailWidth();
+
+    if (gag.imageSize().width() <= width)
+        return;
+
+    QString thumbnailName = fileName + "_thumb.jpg";
+    const int suffixPos = fileName.lastIndexOf(".");
+    if (suffixPos > fileName.lastIndexOf("/"))
+        thumbnailName = fileName.left(suffixPos) + "_thumb" + fileName.mid(suffixPos);
+
+    // the job deletes itself when finished, so it must not be a child of this object
+    ImageSaveJob *job = new ImageSaveJob(fileName, thumbnailName, QSize(width, 0));
+    connect(job, SIGNAL(finished(QString)), SLOT(onThumbnailFinished(QString)));
+    m_thumbnailJobs.insert(job, gag);
+    job->start();
+}
+
+void GagImageDownloader::onThumbnailFinished(const QString &savedFileUrl)
+{
+    ImageSaveJob *job = static_cast<ImageSaveJob *>(sender());
+    GagObject gag = m_thumbnailJobs.take(job);
+
+    if (!savedFileUrl.isEmpty())
+        gag.setThumbnailUrl(QUrl(savedFileUrl));
+    else
+        qWarning("GagImageDownloader::onThumbnailFinished(): Unable to create the thumbnail");
+
+    emitFinishedIfDone();
+}
+
+// Extracts the first frame of the downloaded video, which is shown instead of the (not downloaded) image
+void GagImageDownloader::startPosterJob(const GagObject &gag, const QString &fileName)
+{
+    QString posterName = fileName + "_poster.jpg";
+    const int suffixPos = fileName.lastIndexOf(".");
+    if (suffixPos > fileName.lastIndexOf("/"))
+        posterName = fileName.left(suffixPos) + "_poster.jpg";
+
+    // the extractor deletes itself when finished, so it must not be a child of this object
+    VideoPosterExtractor *extractor = new VideoPosterExtractor(fileName, posterName);
+    connect(extractor, SIGNAL(finished(QString,QSize)), SLOT(onPosterExtracted(QString,QSize)));
+    m_posterJobs.insert(extractor, gag);
+    extractor->extract();
+}
+
+void GagImageDownloader::onPosterExtracted(const QString &posterUrl, const QSize &size)
+{
+    VideoPosterExtractor *extractor = static_cast<VideoPosterExtractor *>(sender());
+    GagObject gag = m_posterJobs.take(extractor);
+
+    // the remote image is shown if the extraction failed
+    if (!posterUrl.isEmpty()) {
+        gag.setImageUrl(QUrl(posterUrl));
+        gag.setImageSize(size);
+        emit posterExtracted(gag);
+    }
+
+    if (m_posterJobs.isEmpty())
+        emit postersFinished();
+}
@@ -31,11 +31,14 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QHash>
+#include <QtCore/QPair>
 
 #include "gagobject.h"
 
 class NetworkManager;
 class QNetworkReply;
+class ImageSaveJob;
+class VideoPosterExtractor;
 
 /*! Download images for list of GagObject
 
@@ -80,30 +83,61 @@ public:
         instead of normal images (GagObject::imageUrl()). */
     void setDownloadVideo(bool downloadVideo);
 
+    /*! If this is set to true, only the videos (GagObject::videoUrl()) of video posts are
+        downloaded and their first frames are used as images (GagObject::imageUrl()) instead
+        of downloading the images. Has no effect if any other download mode is set. */
+    void setExtractVideoPosters(bool extractVideoPosters);
+
     /*! Start the download request. */
     void start();
 
     /*! Stop and abort all active download requests. */
     void stop();
 
+    /*! True if video posters are still being extracted, see posterExtracted(). */
+    bool isExtractingPosters() const;
+
 signals:
     /*! Emit when download progress is changed. */
     void downloadProgress(qint64 downloaded, qint64 total);
 
-    /*! Emit when all images has been downloaded. */
+    /*! Emit when all images has been downloaded and written to the cache and their thumbnails (see
+        GagObject::thumbnailUrl()) have been created. The video posters may still be extracted. */
     void finished();
 
+    /*! Emit when the video poster of \p gag has been extracted and set as its image, which is
+        usually after finished(). */
+    void posterExtracted(const GagObject &gag);
+
+    /*! Emit when the last pending video poster has been extracted (or the extraction failed). */
+    void postersFinished();
+
 private slots:
     void onFinished();
+    void onReadyRead();
+    void onFileWritten(int jobId, bool success);
+    void onThumbnailFinished(const QString &savedFileUrl);
+    void onPosterExtracted(const QString &posterUrl, const QSize &size);
 
 private:
+    bool isPosterExtracted(const GagObject &gag) const;
+    void emitFinishedIfDone();
+    void startThumbnailJob(const GagObject &gag, const QString &fileName);
+    void startPosterJob(const GagObject &gag, const QString &fileName);
+
     NetworkManager *m_networkManager;
     QList<GagObject> m_gagList;
     bool m_downloadPartialImage;
     bool m_downloadGIF;
     bool m_downloadVideo;
+    bool m_extractVideoPosters;
 
     QHash<QNetworkReply*, GagObject> m_replyHash;
+    QHash<QNetworkReply*, qint64> m_streamedBytes;
+    QHash<int, QPair<GagObject, QString> > m_writeJobs;
+    QHash<int, qint64> m_expectedSizes;
+    QHash<ImageSaveJob*, GagObject> m_thumbnailJobs;
+    QHash<VideoPosterExtractor*, GagObject> m_posterJobs;
     int m_imagesTotal;
 };
 
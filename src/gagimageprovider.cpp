@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "gagimageprovider.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QMutexLocker>
+#include <QtGui/QImageReader>
+
+#include "imagescaler.h"
+#include "mappedfile.h"
+#include "metricsregistry.h"
+#include "startupprofiler.h"
+
+static const QString PROVIDER_ID = "gagbook";
+
+// the memory of the decoded images which are kept in the cache (about 8 screen-width images)
+static const int MAX_CACHE_BYTES = 24 * 1024 * 1024;
+
+// only a few threads are used to keep the device responsive while scrolling
+static const int MAX_DECODE_THREADS = 2;
+
+GagImageProvider *GagImageProvider::s_instance = 0;
+
+class DecodeAheadTask : public QRunnable
+{
+public:
+    DecodeAheadTask(GagImageProvider *provider, const QString &filePath, const QSize &requestedSize)
+        : m_provider(provider), m_filePath(filePath), m_requestedSize(requestedSize)
+    {
+    }
+
+    void run()
+    {
+        m_provider->insertImage(GagImageProvider::cacheKey(m_filePath, m_requestedSize),
+                                GagImageProvider::decode(m_filePath, m_requestedSize));
+    }
+
+private:
+    GagImageProvider *m_provider;
+    const QString m_filePath;
+    const QSize m_requestedSize;
+};
+
+GagImageProvider::GagImageProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image), m_cache(MAX_CACHE_BYTES), m_cacheHits(0),
+      m_cacheMisses(0)
+{
+    m_threadPool.setMaxThreadCount(MAX_DECODE_THREADS);
+
+    // the cache metrics are only published when they are read, the requests don't touch the registry
+    m_metricsConnection = QObject::connect(MetricsRegistry::instance(), &MetricsRegistry::snapshotRequested,
+                                           [this]() { updateMetrics(); });
+
+    s_instance = this;
+}
+
+GagImageProvider::~GagImageProvider()
+{
+    s_instance = 0;
+    QObject::disconnect(m_metricsConnection);
+
+    // the tasks must not access the provider after it has been destroyed
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+
+    // the removed tasks will not deliver their images anymore
+    QMutexLocker locker(&m_mutex);
+    m_pendingDecodes.clear();
+    m_decodeFinished.wakeAll();
+}
+
+GagImageProvider *GagImageProvider::instance()
+{
+    return s_instance;
+}
+
+QUrl GagImageProvider::imageUrl(const QUrl &fileUrl)
+{
+    if (!fileUrl.isLocalFile())
+        return QUrl();
+
+    // the id of the requested image is the absolute file path (beginning with '/')
+    return QUrl("image://" + PROVIDER_ID + "/" + fileUrl.toLocalFile());
+}
+
+// Note: this is called from the threads of the QML engine if the Image is loaded asynchronously
+QImage GagImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    const QString key = cacheKey(id, requestedSize);
+    QImage image;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // wait for a decode of the same image (e.g. by decodeAhead()) instead of decoding it twice
+        while (m_pendingDecodes.contains(key))
+            m_decodeFinished.wait(&m_mutex);
+
+        const QImage *cacheEntry = m_cache.object(key);
+
+        if (cacheEntry != 0)
+            image = *cacheEntry;
+        else
+            m_pendingDecodes.insert(key);
+    }
+
+    if (image.isNull()) {
+        m_cacheMisses.ref();
+        image = decode(id, requestedSize);
+        insertImage(key, image);
+
+        if (!image.isNull())
+            StartupProfiler::mark("first image decoded");
+    }
+    else {
+        m_cacheHits.ref();
+    }
+
+    if (size != 0)
+        *size = image.size();
+
+    return image;
+}
+
+void GagImageProvider::decodeAhead(const QUrl &fileUrl, const QSize &requestedSize)
+{
+    if (!fileUrl.isLocalFile())
+        return;
+
+    const QString filePath = fileUrl.toLocalFile();
+    const QString key = cacheKey(filePath, requestedSize);
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_cache.contains(key) || m_pendingDecodes.contains(key))
+            return;
+
+        m_pendingDecodes.insert(key);
+    }
+
+    m_threadPool.start(new DecodeAheadTask(this, filePath, requestedSize));
+}
+
+int GagImageProvider::maxCacheBytes() const
+{
+    return MAX_CACHE_BYTES;
+}
+
+int GagImageProvider::cacheBytes()
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_cache.totalCost();
+}
+
+int GagImageProvider::cacheHits() const
+{
+    return m_cacheHits.load();
+}
+
+int GagImageProvider::cacheMisses() const
+{
+    return m_cacheMisses.load();
+}
+
+// A width or height <= 0 of the requested size is not limited (e.g. if only sourceSize.width is set)
+QSize GagImageProvider::normalizedSize(const QSize &requestedSize)
+{
+    return QSize(qMax(0, requestedSize.width()), qMax(0, requestedSize.height()));
+}
+
+QString GagImageProvider::cacheKey(const QString &filePath, const QSize &requestedSize)
+{
+    const QSize size = normalizedSize(requestedSize);
+
+    if (size.isNull())
+        return filePath;
+
+    return filePath + QString("@%1x%2").arg(size.width()).arg(size.height());
+}
+
+// Decodes the image and scales it down (keeping the aspect ratio) if it exceeds the requested size
+QImage GagImageProvider::decode(const QString &filePath, const QSize &requestedSize)
+{
+    MetricsTimer decodeTimer("image.decodeMs");
+    QImage image;
+    MappedFile mappedFile(filePath);
+
+    // decode directly from the mapped file instead of reading it into a buffer first
+    if (mappedFile.isValid()) {
+        QByteArray imageData = mappedFile.bytes();
+        QBuffer buffer(&imageData);
+        image = QImageReader(&buffer).read();
+    }
+    else {
+        image = QImageReader(filePath).read();
+    }
+
+    const QSize maxSize = normalizedSize(requestedSize);
+
+    if (image.isNull() || maxSize.isNull())
+        return image;
+
+    const QSize targetSize = ImageScaler::boundedSize(image.size(), maxSize);
+
+    if (targetSize == image.size())
+        return image;
+
+    return ImageScaler::scaled(image, targetSize);
+}
+
+void GagImageProvider::insertImage(const QString &key, const QImage &image)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_pendingDecodes.remove(key);
+
+    // images which exceed the whole budget are not cached
+    if (!image.isNull())
+        m_cache.insert(key, new QImage(image), image.byteCount());
+
+    // the waiting requests decode the image themselves if it could not be cached
+    m_decodeFinished.wakeAll();
+}
+
+// Publishes the cache metrics, called when a snapshot of the MetricsRegistry is taken
+void GagImageProvider::updateMetrics()
+{
+    MetricsRegistry *metrics = MetricsRegistry::instance();
+    const int hits = m_cacheHits.load();
+    const int misses = m_cacheMisses.load();
+
+    metrics->setGauge("imageCache.hits", hits);
+    metrics->setGauge("imageCache.misses", misses);
+    metrics->setGauge("imageCache.kb", cacheBytes() / 1024);
+
+    if (hits + misses > 0)
+        metrics->setGauge("imageCache.hitRatePercent", 100.0 * hits / (hits + misses));
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAGIMAGEPROVIDER_H
+#define GAGIMAGEPROVIDER_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
+#include <QtCore/QUrl>
+#include <QtCore/QWaitCondition>
+#include <QtGui/QImage>
+#include <QtQuick/QQuickImageProvider>
+
+/*! Image provider for the cached images of the posts
+
+    Serves the locally cached images under "image://gagbook/<file path>" from a LRU cache
+    of decoded images, which can be filled in advance with decodeAhead(). The cache is
+    bounded by the memory of the images (see maxCacheBytes()) and images are scaled down
+    to the requested sourceSize of the QML Image, so that the image memory is predictable.
+    Only a single instance should be created and added to the QML engine.
+ */
+class GagImageProvider : public QQuickImageProvider
+{
+public:
+    GagImageProvider();
+    ~GagImageProvider();
+
+    /*! Get the instance which has been added to the QML engine (can be 0). */
+    static GagImageProvider *instance();
+
+    /*! Get the URL under which the provider serves the local file \p fileUrl. Returns
+        an empty URL if \p fileUrl is not a local file. */
+    static QUrl imageUrl(const QUrl &fileUrl);
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize);
+
+    /*! Decode the local file \p fileUrl in a worker thread and keep it in the cache so
+        that a following request with the same \p requestedSize is served immediately. */
+    void decodeAhead(const QUrl &fileUrl, const QSize &requestedSize = QSize());
+
+    /*! Get the maximum memory of the cached images in bytes. */
+    int maxCacheBytes() const;
+
+    /*! Get the current memory of the cached images in bytes. */
+    int cacheBytes();
+
+    /*! Get the number of requests which have been served from the cache. */
+    int cacheHits() const;
+
+    /*! Get the number of requests for which the image had to be decoded. */
+    int cacheMisses() const;
+
+private:
+    friend class DecodeAheadTask;
+
+    static QSize normalizedSize(const QSize &requestedSize);
+    static QString cacheKey(const QString &filePath, const QSize &requestedSize);
+    static QImage decode(const QString &filePath, const QSize &requestedSize);
+
+    void insertImage(const QString &key, const QImage &image);
+    void updateMetrics();
+
+    static GagImageProvider *s_instance;
+
+    QMutex m_mutex;
+    QCache<QString, QImage> m_cache;
+    // the keys of the images which are being decoded, a request for them waits for the decode
+    QSet<QString> m_pendingDecodes;
+    QWaitCondition m_decodeFinished;
+    QAtomicInt m_cacheHits;
+    QAtomicInt m_cacheMisses;
+    QThreadPool m_threadPool;
+    QMetaObject::Connection m_metricsConnection;
+};
+
+#endif // GAGIMAGEPROVIDER_H
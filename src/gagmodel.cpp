@@ -37,11 +37,42 @@
 #include "gagrequest.h"
 #include "gagimagedownloader.h"
 #include "sectionmodel.h"
+#include "gagimageprovider.h"
+#include "allocprofiler.h"
+#include "jankmonitor.h"
+#include "metricsregistry.h"
+#include "startupprofiler.h"
+#include "tracing.h"
+
+// the number of following images which are decoded in advance
+static const int DECODE_AHEAD_COUNT = 3;
+
+// The roles which change when the files of a gag have been downloaded. Only these are
+// passed with dataChanged(), so that the other bindings of the delegate are not re-evaluated.
+static QVector<int> mediaRoles()
+{
+    static const QVector<int> roles = QVector<int>()
+            << GagModel::ImageUrlRole << GagModel::FullImageUrlRole << GagModel::GifImageUrlRole
+            << GagModel::VideoUrlRole << GagModel::ImageSizeRole << GagModel::ThumbnailUrlRole
+            << GagModel::IsDownloadingRole;
+
+    return roles;
+}
+
+// Returns the local file of the image which is shown in the list (the thumbnail if available)
+static QUrl displayedImageUrl(const GagObject &gag)
+{
+    if (gag.thumbnailUrl().isLocalFile())
+        return gag.thumbnailUrl();
+
+    return gag.imageUrl();
+}
 
 GagModel::GagModel(QObject *parent) :
     QAbstractListModel(parent), m_groupId(1), m_section(QString()), m_lastId(QString()),
     m_selectedSection(0), m_busy(false), m_progress(0), m_manualProgress(0), m_manager(0),
-    m_gagList(QList<GagObject>()), m_imageDownloader(0), m_manualImageDownloader(0), m_downloadingIndex(-1)
+    m_gagList(QList<GagObject>()), m_imageDownloader(0), m_manualImageDownloader(0), m_downloadingIndex(-1),
+    m_lazyMedia(false)
 {
     _roles[TitleRole] = "title";
     _roles[IdRole] = "id";
@@ -60,6 +91,7 @@ GagModel::GagModel(QObject *parent) :
     _roles[IsPartialImageRole] = "isPartialImage";
     _roles[SavedFileUrlRole] = "savedFileUrl";
     _roles[IsDownloadingRole] = "isDownloading";
+    _roles[ThumbnailUrlRole] = "thumbnailUrl";
 }
 
 void GagModel::classBegin()
@@ -127,7 +159,10 @@ QVariant GagModel::data(const QModelIndex &index, int role) const
             return QUrl();
         return gag.savedFileUrl();
     case IsDownloadingRole:
-        return index.row() == m_downloadingIndex;
+        return index.row() == m_downloadingIndex || m_mediaDownloaders.contains(index.row());
+    case ThumbnailUrlRole:
+        // served by GagImageProvider, falls back to the title image if there is no thumbnail
+        return GagImageProvider::imageUrl(displayedImageUrl(gag));
     default:
         qWarning("GagModel::data(): Invalid role");
         return QVariant();
@@ -217,11 +252,16 @@ void GagModel::refresh(RefreshType refreshType)
     }
 
     if (m_imageDownloader != 0) {
+        // the replies are aborted so that they are finished before the downloader is deleted
         m_imageDownloader->disconnect();
+        m_imageDownloader->stop();
         m_imageDownloader->deleteLater();
         m_imageDownloader = 0;
     }
 
+    if (refreshType == RefreshAll)
+        clearMediaDownloads();
+
     if (m_manager == 0) {
         qWarning("GagModel::refresh(): Error! GagBookManager has not been set yet!");
         return;
@@ -247,6 +287,7 @@ void GagModel::refresh(RefreshType refreshType)
             beginRemoveRows(QModelIndex(), 0, m_gagList.count() - 1);
             m_gagList.clear();
             endRemoveRows();
+            MetricsRegistry::instance()->setGauge("model.rows", 0);
         } else {
             m_lastId = "";
 
@@ -288,12 +329,12 @@ void GagModel::downloadImage(int i)
         if (m_downloadingIndex != -1) {
             QModelIndex modelIndex = index(m_downloadingIndex);
             m_downloadingIndex = -1;
-            emit dataChanged(modelIndex, modelIndex);
+            emit dataChanged(modelIndex, modelIndex, QVector<int>() << IsDownloadingRole);
         }
     }
 
     m_downloadingIndex = i;
-    emit dataChanged(index(i), index(i));
+    emit dataChanged(index(i), index(i), QVector<int>() << IsDownloadingRole);
 
     if (m_manualProgress != 0) {
         m_manualProgress = 0;
@@ -322,12 +363,99 @@ void GagModel::changeLikes(const QString &id, int likes)
             int oldLikes = gag.likes();
             gag.setLikes(likes);
             gag.setVotesCount(gag.votesCount() + (likes - oldLikes));
-            emit dataChanged(index(i), index(i));
+            emit dataChanged(index(i), index(i), QVector<int>() << LikesRole << VotesCountRole);
             break;
         }
     }
 }
 
+void GagModel::decodeAhead(int i, const QSize &sourceSize)
+{
+    GagImageProvider *imageProvider = GagImageProvider::instance();
+
+    if (imageProvider == 0)
+        return;
+
+    const int last = qMin(i + DECODE_AHEAD_COUNT, m_gagList.count() - 1);
+
+    for (int row = i + 1; row <= last; ++row)
+        imageProvider->decodeAhead(displayedImageUrl(m_gagList.at(row)), sourceSize);
+}
+
+void GagModel::requestMedia(int i)
+{
+    if (!m_lazyMedia || i < 0 || i >= m_gagList.count())
+        return;
+
+    m_requestedRows.insert(i);
+
+    // a cancelled download is restarted when it has finished (see onMediaDownloadFinished())
+    if (!m_mediaDownloaders.contains(i))
+        startMediaDownload(i);
+}
+
+void GagModel::cancelMedia(int i)
+{
+    m_requestedRows.remove(i);
+
+    // the downloader finishes after the replies have been aborted, so that files which have
+    // been downloaded already are still assigned to the gag (and removed with it)
+    GagImageDownloader *downloader = m_mediaDownloaders.value(i, 0);
+    if (downloader != 0) {
+        m_cancelledRows.insert(i);
+        downloader->stop();
+    }
+}
+
+void GagModel::startMediaDownload(int i)
+{
+    const GagObject &gag = m_gagList.at(i);
+
+    if (gag.imageUrl().isEmpty() || gag.imageUrl().isLocalFile())
+        return;
+
+    GagImageDownloader *downloader = new GagImageDownloader(manager()->networkManager(), this);
+    downloader->setGagList(QList<GagObject>() << gag);
+    if (m_manager->settings() != 0)
+        downloader->setExtractVideoPosters(m_manager->settings()->extractVideoPosters());
+    connect(downloader, SIGNAL(finished()), SLOT(onMediaDownloadFinished()));
+    connect(downloader, SIGNAL(posterExtracted(GagObject)), SLOT(onPosterExtracted(GagObject)));
+    m_mediaDownloaders.insert(i, downloader);
+    downloader->start();
+
+    if (m_mediaDownloaders.contains(i))
+        emit dataChanged(index(i), index(i), QVector<int>() << IsDownloadingRole);
+}
+
+void GagModel::onMediaDownloadFinished()
+{
+    GagImageDownloader *downloader = static_cast<GagImageDownloader *>(sender());
+    const int i = m_mediaDownloaders.key(downloader);
+    m_mediaDownloaders.remove(i);
+    releaseDownloader(downloader);
+
+    const bool wasCancelled = m_cancelledRows.remove(i);
+
+    emit dataChanged(index(i), index(i), mediaRoles());
+
+    // the gag became visible again while its download has been cancelled
+    if (wasCancelled && m_requestedRows.contains(i) && !m_gagList.at(i).imageUrl().isLocalFile())
+        startMediaDownload(i);
+}
+
+void GagModel::clearMediaDownloads()
+{
+    foreach (GagImageDownloader *downloader, m_mediaDownloaders) {
+        downloader->disconnect();
+        downloader->stop();
+        downloader->deleteLater();
+    }
+
+    m_mediaDownloaders.clear();
+    m_requestedRows.clear();
+    m_cancelledRows.clear();
+}
+
 void GagModel::startRequest()
 {
     GagRequest *gagReq = m_manager->gagRequest();
@@ -337,6 +465,8 @@ void GagModel::startRequest()
     connect(gagReq, SIGNAL(fetchGagsFailure(QString)), this, SLOT(onFailure(QString)), Qt::UniqueConnection);
     connect(gagReq, &GagRequest::reachedEndOfList, this, &GagModel::onEndOfList, Qt::UniqueConnection);
 
+    // re-evaluated for every page, since the connection may have changed
+    gagReq->setMediaQualityPolicy(m_manager->mediaQualityPolicy());
     gagReq->fetchGags(m_groupId, m_section, m_lastId);
 }
 
@@ -352,13 +482,27 @@ void GagModel::onEndOfList()
 
 void GagModel::onSuccess(const QList<GagObject> &gagList)
 {
+    GAGBOOK_ALLOC_SCOPE("GagModel::onSuccess");
+
+    m_lazyMedia = (m_manager->settings() != 0) && m_manager->settings()->dataSaver();
+
+    // the data saver downloads the images when the gags become visible (see requestMedia())
+    if (m_lazyMedia) {
+        appendGags(gagList);
+        return;
+    }
+
     m_imageDownloader = new GagImageDownloader(manager()->networkManager(), this);
     m_imageDownloader->setGagList(gagList);
     m_imageDownloader->setDownloadGIF(false);
+    if (m_manager->settings() != 0)
+        m_imageDownloader->setExtractVideoPosters(m_manager->settings()->extractVideoPosters());
     connect(m_imageDownloader, SIGNAL(downloadProgress(qint64,qint64)), this,
             SLOT(onDownloadProgress(qint64,qint64)), Qt::UniqueConnection);
     connect(m_imageDownloader, SIGNAL(finished()), this,
             SLOT(onDownloadFinished()), Qt::UniqueConnection);
+    connect(m_imageDownloader, SIGNAL(posterExtracted(GagObject)), this,
+            SLOT(onPosterExtracted(GagObject)), Qt::UniqueConnection);
     m_imageDownloader->start();
 }
 
@@ -388,21 +532,61 @@ void GagModel::onDownloadProgress(qint64 downloaded, qint64 total)
 
 void GagModel::onDownloadFinished()
 {
-    const QList<GagObject> gagList = m_imageDownloader->gagList();
-    beginInsertRows(QModelIndex(), m_gagList.count(), m_gagList.count() + gagList.count() - 1);
-    m_gagList.reserve(m_gagList.count() + gagList.count());
-    m_gagList.append(gagList);
-    endInsertRows();
+    GAGBOOK_TRACE_SCOPE("GagModel::onDownloadFinished");
+    JankMonitor::Task guiTask("GagModel::onDownloadFinished");
+
+    appendGags(m_imageDownloader->gagList());
+
+    Q_ASSERT(m_imageDownloader != 0);
+    releaseDownloader(m_imageDownloader);
+    m_imageDownloader = 0;
+}
+
+// The gags of the downloader share their data with the gags of the model, so the poster has been
+// set already and only the row of the gag is updated
+void GagModel::onPosterExtracted(const GagObject &gag)
+{
+    for (int i = 0; i < m_gagList.count(); ++i) {
+        if (m_gagList.at(i).id() == gag.id()) {
+            emit dataChanged(index(i), index(i), QVector<int>() << ImageUrlRole << ImageSizeRole
+                             << ThumbnailUrlRole);
+            return;
+        }
+    }
+}
+
+// Deletes a finished downloader, but not before it has extracted its video posters, which are still
+// passed to onPosterExtracted()
+void GagModel::releaseDownloader(GagImageDownloader *downloader)
+{
+    disconnect(downloader, SIGNAL(finished()), this, 0);
+    disconnect(downloader, SIGNAL(downloadProgress(qint64,qint64)), this, 0);
+
+    if (downloader->isExtractingPosters())
+        connect(downloader, SIGNAL(postersFinished()), downloader, SLOT(deleteLater()));
+    else
+        downloader->deleteLater();
+}
+
+void GagModel::appendGags(const QList<GagObject> &gagList)
+{
+    GAGBOOK_TRACE_SCOPE("GagModel::appendGags");
+    JankMonitor::Task guiTask("GagModel::appendGags");
+    GAGBOOK_ALLOC_SCOPE("GagModel::appendGags");
+
+    if (!gagList.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_gagList.count(), m_gagList.count() + gagList.count() - 1);
+        m_gagList.reserve(m_gagList.count() + gagList.count());
+        m_gagList.append(gagList);
+        endInsertRows();
+        MetricsRegistry::instance()->setGauge("model.rows", m_gagList.count());
+        StartupProfiler::mark("first post list");
+    }
 
     if (m_busy != false) {
         m_busy = false;
         emit busyChanged();
     }
-
-    Q_ASSERT(m_imageDownloader != 0);
-    m_imageDownloader->disconnect();
-    m_imageDownloader->deleteLater();
-    m_imageDownloader = 0;
 }
 
 void GagModel::onManualDownloadProgress(qint64 downloaded, qint64 total)
@@ -423,7 +607,7 @@ void GagModel::onManualDownloadFinished()
 {
     QModelIndex modelIndex = index(m_downloadingIndex);
     m_downloadingIndex = -1;
-    emit dataChanged(modelIndex, modelIndex);
+    emit dataChanged(modelIndex, modelIndex, mediaRoles());
 
     m_manualImageDownloader->deleteLater();
     m_manualImageDownloader = 0;
@@ -30,6 +30,7 @@
 #define GAGMODEL_H
 
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QSet>
 #include <QtQml/QQmlParserStatus>
 
 #include "gagobject.h"
@@ -79,7 +80,8 @@ public:
         IsVideoRole,
         IsPartialImageRole,
         SavedFileUrlRole,
-        IsDownloadingRole
+        IsDownloadingRole,
+        ThumbnailUrlRole
     };
 
     enum RefreshType {
@@ -118,6 +120,17 @@ public:
     Q_INVOKABLE void downloadImage(int i);
     /*! Change the `likes` of a gag with the \p id. */
     Q_INVOKABLE void changeLikes(const QString &id, int likes);
+    /*! Decode the images of the gags following the index \p i in the background, so that
+        they are shown without delay (see GagImageProvider). \p sourceSize must match the
+        sourceSize of the Image which shows them. */
+    Q_INVOKABLE void decodeAhead(int i, const QSize &sourceSize = QSize());
+    /*! Download the image of the gag at index \p i if it has not been downloaded with the
+        list, which is the case if the data saver is enabled (see AppSettings::dataSaver).
+        Should be called when the gag becomes visible. */
+    Q_INVOKABLE void requestMedia(int i);
+    /*! Cancel the download started with requestMedia(). Should be called when the gag is
+        not visible anymore. */
+    Q_INVOKABLE void cancelMedia(int i);
 
 signals:
     void busyChanged();
@@ -138,8 +151,15 @@ private slots:
     void onDownloadFinished();
     void onManualDownloadProgress(qint64 downloaded, qint64 total);
     void onManualDownloadFinished();
+    void onMediaDownloadFinished();
+    void onPosterExtracted(const GagObject &gag);
 
 private:
+    void appendGags(const QList<GagObject> &gagList);
+    void releaseDownloader(GagImageDownloader *downloader);
+    void startMediaDownload(int i);
+    void clearMediaDownloads();
+
     int m_groupId;
     QString m_section;
     QString m_lastId;
@@ -154,6 +174,12 @@ private:
     GagImageDownloader *m_imageDownloader;
     GagImageDownloader *m_manualImageDownloader;
     int m_downloadingIndex;
+
+    // the lazy downloads of the data saver mode
+    bool m_lazyMedia;
+    QHash<int, GagImageDownloader*> m_mediaDownloaders;
+    QSet<int> m_requestedRows;
+    QSet<int> m_cancelledRows;
 };
 
 #endif // GAGMODEL_H
@@ -51,6 +51,8 @@ public:
             QFile::remove(videoUrl.toLocalFile());
         if (fullImageUrl.isLocalFile())
             QFile::remove(fullImageUrl.toLocalFile());
+        if (thumbnailUrl.isLocalFile())
+            QFile::remove(thumbnailUrl.toLocalFile());
     }
 
     QString id;
@@ -58,6 +60,7 @@ public:
     QString title;
     QUrl imageUrl;
     QUrl fullImageUrl;
+    QUrl thumbnailUrl;
     QUrl gifImageUrl;
     QUrl videoUrl;
     QSize imageSize;
@@ -144,6 +147,16 @@ void GagObject::setFullImageUrl(const QUrl &fullImageUrl)
     d->fullImageUrl = fullImageUrl;
 }
 
+QUrl GagObject::thumbnailUrl() const
+{
+    return d->thumbnailUrl;
+}
+
+void GagObject::setThumbnailUrl(const QUrl &thumbnailUrl)
+{
+    d->thumbnailUrl = thumbnailUrl;
+}
+
 QUrl GagObject::gifImageUrl() const
 {
     return d->gifImageUrl;
@@ -66,6 +66,9 @@ public:
     QUrl fullImageUrl() const;
     void setFullImageUrl(const QUrl &fullImageUrl);
 
+    QUrl thumbnailUrl() const;
+    void setThumbnailUrl(const QUrl &thumbnailUrl);
+
     QUrl gifImageUrl() const;
     void setGifImageUrl(const QUrl &imageUrl);
 
@@ -27,6 +27,9 @@
  */
 
 #include "gagrequest.h"
+#include "allocprofiler.h"
+#include "jankmonitor.h"
+#include "tracing.h"
 
 /*!
     \class GagRequest
@@ -47,7 +50,7 @@
  */
 GagRequest::GagRequest(NetworkManager *networkManager, QObject *parent) :
     QObject(parent), m_networkManager(networkManager), m_gagsReply(0),
-    m_commentsReply(0)
+    m_lastCommentsRequestId(0)
 {
 }
 
@@ -79,40 +82,44 @@ void GagRequest::fetchGags(int groupId, QString &section, QString &lastId)
 }
 
 /*!
- * \brief GagRequest::fetchComments Initiates the request to fetch comments.
+ * \brief GagRequest::fetchComments Initiates the request to fetch comments. Several requests
+ *  (e.g. for different parent comments) can be active at the same time.
  * \param data A list of the required parameters to perform the comments request.
  * \param parentComment The parent comment for that the comments should be fetched.
+ * \param arena The CommentArena that should own the fetched comments (can be 0).
+ * \return Returns the id of the request, which is passed to the fetchCommentsSuccess() and
+ *  fetchCommentsFailure() signals.
  */
-void GagRequest::fetchComments(const QVariantList &data, CommentObject *parentComment)
+int GagRequest::fetchComments(const QVariantList &data, CommentObject *parentComment, CommentArena *arena)
 {
-    if (m_commentsReply != 0) {
-        qWarning() << "GagRequest::fetchComments(): A request is still active and will be aborted!";
-        m_commentsReply->abort();   // emits finished() signal!
-        m_commentsReply->deleteLater();
-        m_commentsReply = 0;
-    }
+    const int requestId = ++m_lastCommentsRequestId;
 
-    m_commentsReply = fetchCommentsImpl(data);
-    m_commentsReply->setParent(this);
+    QNetworkReply *reply = fetchCommentsImpl(data);
+    reply->setParent(this);
+    m_commentsReplies.insert(requestId, reply);
 
     // It is assured that the connection is a QUniqueConnection since a new reply is created everytime
-    connect(m_commentsReply, &QNetworkReply::finished,
-            [this, parentComment](){ this->onFetchCommentsFinished(parentComment); });
+    connect(reply, &QNetworkReply::finished,
+            [this, requestId, parentComment, arena](){ this->onFetchCommentsFinished(requestId, parentComment, arena); });
+
+    return requestId;
 }
 
 /*!
- * \brief GagRequest::abortCommentsRequest Aborts all active comment requests, if there are any active,
- *  and closes down any network connections.
+ * \brief GagRequest::abortCommentsRequest Aborts the comments request with the given id, if it is
+ *  still active, and closes down its network connection.
  *  Note: The finished() signal will be NOT emitted.
+ * \param requestId The id of the request that has been returned by fetchComments().
  */
-void GagRequest::abortCommentsRequest()
+void GagRequest::abortCommentsRequest(int requestId)
 {
-    if (m_commentsReply != 0) {
+    QNetworkReply *reply = m_commentsReplies.take(requestId);
+
+    if (reply != 0) {
         // prevent emitting the 'finished()' signal since calling this method implies an intended action
-        m_commentsReply->disconnect();
-        m_commentsReply->abort();
-        m_commentsReply->deleteLater();
-        m_commentsReply = 0;
+        reply->disconnect();
+        reply->abort();
+        reply->deleteLater();
     }
 }
 
@@ -121,6 +128,10 @@ void GagRequest::abortCommentsRequest()
  */
 void GagRequest::onFetchGagsFinished()
 {
+    GAGBOOK_TRACE_SCOPE("GagRequest::onFetchGagsFinished");
+    JankMonitor::Task guiTask("GagRequest::onFetchGagsFinished");
+    GAGBOOK_ALLOC_SCOPE("GagRequest::onFetchGagsFinished");
+
     if (m_gagsReply->error()) {
         qDebug() << "QNetworkReply error: " << m_gagsReply->error()
                  << "\nQNetworkReply object: " << m_gagsReply->readAll();
@@ -151,30 +162,35 @@ void GagRequest::onFetchGagsFinished()
 /*!
  * \brief GagRequest::onFetchCommentsFinished Slot to process the QNetworkReply after fetching
  *  the comments.
+ * \p requestId The id of the finished request.
  * \p parentComment The parent comment for that the comments has been fetched.
+ * \p arena The CommentArena that should own the parsed comments.
  */
-void GagRequest::onFetchCommentsFinished(CommentObject *parentComment)
+void GagRequest::onFetchCommentsFinished(int requestId, CommentObject *parentComment, CommentArena *arena)
 {
-    if (m_commentsReply->error()) {
-        qDebug() << "QNetworkReply error on fetching comments: " << m_commentsReply->error()
-                 << "\nQNetworkReply object: " << m_commentsReply->readAll();
-        QString errorStr = m_commentsReply->errorString();
-        m_commentsReply->disconnect();
-        m_commentsReply->deleteLater();
-        m_commentsReply = 0;
-        emit fetchCommentsFailure(errorStr);
+    JankMonitor::Task guiTask("GagRequest::onFetchCommentsFinished");
+
+    QNetworkReply *reply = m_commentsReplies.take(requestId);
+    Q_ASSERT(reply != 0);
+
+    if (reply->error()) {
+        qDebug() << "QNetworkReply error on fetching comments: " << reply->error()
+                 << "\nQNetworkReply object: " << reply->readAll();
+        QString errorStr = reply->errorString();
+        reply->disconnect();
+        reply->deleteLater();
+        emit fetchCommentsFailure(requestId, errorStr);
         return;
     }
 
-    QByteArray response = m_commentsReply->readAll();
-    m_commentsReply->disconnect();
-    m_commentsReply->deleteLater();
-    m_commentsReply = 0;
+    QByteArray response = reply->readAll();
+    reply->disconnect();
+    reply->deleteLater();
 
     // TODO check for an empty list & parse errors!
-    const QList<CommentObject *> &commentList = parseComments(response, parentComment);
+    const QList<CommentObject *> &commentList = parseComments(response, parentComment, arena);
 
-    emit fetchCommentsSuccess(commentList);
+    emit fetchCommentsSuccess(requestId, commentList);
 }
 
 /*!
@@ -185,3 +201,21 @@ NetworkManager *GagRequest::networkManager() const
 {
     return m_networkManager;
 }
+
+/*!
+ * \brief GagRequest::setMediaQualityPolicy Sets the policy which selects the media renditions.
+ * \param policy The policy, it is used for all gags that are fetched afterwards.
+ */
+void GagRequest::setMediaQualityPolicy(const MediaQualityPolicy &policy)
+{
+    m_mediaQualityPolicy = policy;
+}
+
+/*!
+ * \brief GagRequest::mediaQualityPolicy Getter for the policy which selects the media renditions.
+ * \return Returns the policy that has been set with setMediaQualityPolicy().
+ */
+MediaQualityPolicy GagRequest::mediaQualityPolicy() const
+{
+    return m_mediaQualityPolicy;
+}
@@ -32,11 +32,13 @@
 #include <QtNetwork/QNetworkReply>
 #include <QtCore/QObject>
 #include <QtCore/QList>
+#include <QtCore/QHash>
 
 #include "networkmanager.h"
 #include "gagobject.h"
 #include "gagmodel.h"
 #include "commentobject.h"
+#include "mediaqualitypolicy.h"
 
 class GagRequest : public QObject
 {
@@ -47,8 +49,12 @@ public:
 
     void initiateGagsRequest();
     void fetchGags(int groupId, QString &section, QString &lastId);
-    void fetchComments(const QVariantList &data, CommentObject *parentComment);
-    void abortCommentsRequest();
+    int fetchComments(const QVariantList &data, CommentObject *parentComment, CommentArena *arena = 0);
+    void abortCommentsRequest(int requestId);
+
+    /*! Set the policy which selects the media renditions of the gags that are fetched
+     *  afterwards. \sa MediaQualityPolicy */
+    void setMediaQualityPolicy(const MediaQualityPolicy &policy);
 
 signals:
     /*! Emit this if the network request succeeds on fetching the gags data and
@@ -70,17 +76,22 @@ signals:
 
     /*! Emit this if the network request succeeds on fetching the comments data and
      *  the content has been parsed successful.
+     *  \p requestId The id of the request that has been returned by fetchComments().
      *  \p commentList Contains the parsed CommentObjects. */
-    void fetchCommentsSuccess(const QList<CommentObject *> &commentList);
+    void fetchCommentsSuccess(int requestId, const QList<CommentObject *> &commentList);
 
     /*! Emit this if the network request failed on fetching the comments data.
+     *  \p requestId The id of the request that has been returned by fetchComments().
      *  \p error Contains the reason of the failure. */
-    void fetchCommentsFailure(const QString &error);
+    void fetchCommentsFailure(int requestId, const QString &error);
 
 protected:
     /*! Get the global instance of NetworkManager. */
     NetworkManager *networkManager() const;
 
+    /*! Get the policy that should be used to select the media renditions in parseGags(). */
+    MediaQualityPolicy mediaQualityPolicy() const;
+
     /*! Implement this to start/send the request by emitting the readyToRequestGags
      *  signal. This function is useful if some preparation is needed prior to
      *  the request or to achieve a specific state of the derived GagRequest
@@ -108,20 +119,25 @@ protected:
     /*! Implement this to parse the network response to a list of CommentObjects.
      *  \p response This is the content of the network reply.
      *  \p parentComment Specifies the CommentObject that is the parent for the
-     *   retrieved data. */
+     *   retrieved data.
+     *  \p arena The CommentArena in which the CommentObjects should be allocated. If
+     *   it is 0, the CommentObjects are allocated on the heap. */
     virtual QList<CommentObject *> parseComments(const QByteArray &response,
-                                                 CommentObject *parentComment) = 0;
+                                                 CommentObject *parentComment,
+                                                 CommentArena *arena) = 0;
 
 private slots:
     void onFetchGagsFinished();
-    void onFetchCommentsFinished(CommentObject *parentComment);
+    void onFetchCommentsFinished(int requestId, CommentObject *parentComment, CommentArena *arena);
 
 private:
     NetworkManager *m_networkManager;
     QNetworkReply *m_gagsReply;
     QList<GagObject> m_gagList;
+    MediaQualityPolicy m_mediaQualityPolicy;
 
-    QNetworkReply *m_commentsReply;
+    QHash<int, QNetworkReply *> m_commentsReplies;
+    int m_lastCommentsRequestId;
 };
 
 #endif // GAGREQUEST_H
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "imagesavejob.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QFile>
+#include <QtCore/QUrl>
+#include <QtCore/QThreadPool>
+#include <QtGui/QImage>
+#include <QtGui/QImageReader>
+#include <QtGui/QPainter>
+
+#include "imagescaler.h"
+#include "mappedfile.h"
+#include "fileioworker.h"
+
+// the number of source rows which are decoded and scaled at once
+static const int STRIP_HEIGHT = 2048;
+
+// Lets the reader decode the mapped file or, if the file could not be mapped, read the file itself
+static void setReaderSource(QImageReader &reader, QBuffer &buffer, const MappedFile &mappedFile,
+                            const QString &filePath)
+{
+    if (mappedFile.isValid()) {
+        // each reader starts at the beginning of the buffer
+        if (buffer.isOpen())
+            buffer.seek(0);
+
+        reader.setDevice(&buffer);
+    }
+    else {
+        reader.setFileName(filePath);
+    }
+}
+
+/*!
+    \class ImageSaveJob
+    \since 1.5.0
+    \brief The ImageSaveJob class saves an image to the gallery in a worker thread.
+
+    Images which exceed the given maximum size (e.g. long images or thumbnails) are scaled down
+    with their aspect ratio preserved (see ImageScaler). Formats which can decode a part of the
+    image (e.g. JPEG) are decoded and resampled in strips of source rows with a new reader per
+    strip, so that only one strip of the source image is held in memory. Other formats (e.g. PNG and GIF) are decoded
+    as a whole before they are resampled, so their memory use is not bounded. Images which don't
+    exceed the maximum size are just copied.
+
+    The job runs on the global QThreadPool and reports its progress, a plain copy is done
+    by the FileIoWorker. It deletes itself after the finished() signal has been emitted.
+
+    \sa QMLUtils::saveImageAsync()
+*/
+
+/*!
+ * \brief ImageSaveJob::ImageSaveJob Constructs an ImageSaveJob. Call start() to run the job.
+ * \param imagePath The path of the local file that should be saved.
+ * \param savePath The path to which the file should be saved.
+ * \param maxSize The maximum size of the saved image, a width or height <= 0 is not limited.
+ *  Pass QSize() to just copy the file.
+ * \param parent Pointer to the parent object.
+ */
+ImageSaveJob::ImageSaveJob(const QString &imagePath, const QString &savePath, const QSize &maxSize,
+                           QObject *parent)
+    : QObject(parent), m_imagePath(imagePath), m_savePath(savePath), m_maxSize(maxSize),
+      m_progress(0.0), m_isRunning(false), m_copyJobId(-1)
+{
+    // the job deletes itself after the results have been delivered (see onSaveDone())
+    setAutoDelete(false);
+
+    connect(this, &ImageSaveJob::progressReported, this, &ImageSaveJob::onProgressReported, Qt::QueuedConnection);
+    connect(this, &ImageSaveJob::saveDone, this, &ImageSaveJob::onSaveDone, Qt::QueuedConnection);
+}
+
+qreal ImageSaveJob::progress() const
+{
+    return m_progress;
+}
+
+bool ImageSaveJob::isRunning() const
+{
+    return m_isRunning;
+}
+
+/*!
+ * \brief ImageSaveJob::start Starts the job on the global QThreadPool (or the FileIoWorker).
+ */
+void ImageSaveJob::start()
+{
+    if (m_isRunning)
+        return;
+
+    m_isRunning = true;
+    emit runningChanged();
+
+    // a plain copy is done by the I/O worker, it doesn't need a thread of the pool
+    if ((m_maxSize.width() <= 0) && (m_maxSize.height() <= 0)) {
+        connect(FileIoWorker::instance(), &FileIoWorker::jobFinished, this, &ImageSaveJob::onCopyFinished);
+        m_copyJobId = FileIoWorker::instance()->copy(m_imagePath, m_savePath);
+        return;
+    }
+
+    QThreadPool::globalInstance()->start(this);
+}
+
+/*!
+ * \brief ImageSaveJob::run Reimplementation of QRunnable, is executed in the worker thread.
+ */
+void ImageSaveJob::run()
+{
+    const bool success = saveImage(m_imagePath, m_savePath, m_maxSize, this);
+
+    // nothing must be accessed after this since the job may get deleted
+    emit saveDone(success);
+}
+
+/*!
+ * \brief ImageSaveJob::saveImage Saves the image, scales it down if it exceeds \a maxSize.
+ *  This method is thread-safe and can also be used without a job.
+ * \param imagePath The path of the local file that should be saved.
+ * \param savePath The path to which the file should be saved.
+ * \param maxSize The maximum size of the saved image, a width or height <= 0 is not limited.
+ *  Pass QSize() to just copy the file.
+ * \param job The job to which the progress is reported (can be 0).
+ * \return Returns true if the file has been saved.
+ */
+bool ImageSaveJob::saveImage(const QString &imagePath, const QString &savePath, const QSize &maxSize,
+                             ImageSaveJob *job)
+{
+    if ((maxSize.width() <= 0) && (maxSize.height() <= 0))
+        return MappedFile::copy(imagePath, savePath);
+
+    // the image is decoded directly from the mapping, the file is not read into a separate buffer
+    MappedFile mappedFile(imagePath);
+    QByteArray imageData = mappedFile.bytes();
+    QBuffer buffer(&imageData);
+    QImageReader reader;
+    setReaderSource(reader, buffer, mappedFile, imagePath);
+
+    const QSize size = reader.size();
+
+    // formats that can't decode a part of the image are decoded as a whole
+    if (!size.isValid() || !reader.supportsOption(QImageIOHandler::ClipRect)) {
+        const QImage fullImage = reader.read();
+
+        if (fullImage.isNull())
+            return false;
+
+        const QSize targetSize = ImageScaler::boundedSize(fullImage.size(), maxSize);
+
+        if (targetSize == fullImage.size())
+            return MappedFile::copy(imagePath, savePath);
+
+        const QImage targetImage = ImageScaler::scaled(fullImage, targetSize);
+
+        if (job != 0)
+            emit job->progressReported(1.0);
+
+        return !targetImage.isNull() && targetImage.save(savePath);
+    }
+
+    const QSize targetSize = ImageScaler::boundedSize(size, maxSize);
+
+    if (targetSize == size)
+        return MappedFile::copy(imagePath, savePath);
+
+    // a reader decodes only once, so each strip is decoded by a new reader; the rows above a strip
+    // may be decoded again for every strip, which trades decoding time for the bounded memory
+    const int targetWidth = targetSize.width();
+    const int targetHeight = targetSize.height();
+    const int targetStripHeight = qMax(1, int(qint64(STRIP_HEIGHT) * targetHeight / size.height()));
+    QImage targetImage;
+
+    for (int targetY = 0; targetY < targetHeight; targetY += targetStripHeight) {
+        const int targetEnd = qMin(targetY + targetStripHeight, targetHeight);
+
+        // the source rows which are mapped to the target rows [targetY, targetEnd)
+        const int sourceY = int(qint64(targetY) * size.height() / targetHeight);
+        const int sourceEnd = int(qint64(targetEnd) * size.height() / targetHeight);
+        const QRect clipRect(0, sourceY, size.width(), sourceEnd - sourceY);
+        const QSize stripSize(targetWidth, targetEnd - targetY);
+
+        QImageReader stripReader;
+        setReaderSource(stripReader, buffer, mappedFile, imagePath);
+        stripReader.setClipRect(clipRect);
+        const QImage strip = ImageScaler::scaled(stripReader.read(), stripSize);
+
+        if (strip.isNull())
+            return false;
+
+        if (targetImage.isNull()) {
+            targetImage = QImage(targetSize, strip.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                   : QImage::Format_RGB32);
+        }
+
+        QPainter painter(&targetImage);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(0, targetY, strip);
+        painter.end();
+
+        if (job != 0)
+            emit job->progressReported(qreal(targetEnd) / targetHeight);
+    }
+
+    return targetImage.save(savePath);
+}
+
+void ImageSaveJob::onProgressReported(qreal progress)
+{
+    if (qFuzzyCompare(m_progress, progress))
+        return;
+
+    m_progress = progress;
+    emit progressChanged();
+}
+
+void ImageSaveJob::onCopyFinished(int jobId, bool success)
+{
+    if (jobId == m_copyJobId)
+        onSaveDone(success);
+}
+
+void ImageSaveJob::onSaveDone(bool success)
+{
+    m_progress = 1.0;
+    m_isRunning = false;
+    emit progressChanged();
+    emit runningChanged();
+
+    // use QUrl to get the 'file://' scheme so that it can be opened using Qt.openUrlExternally() in QML
+    emit finished((success || QFile::exists(m_savePath)) ? QUrl::fromLocalFile(m_savePath).toString() : QString(""));
+
+    deleteLater();
+}
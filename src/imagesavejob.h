@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGESAVEJOB_H
+#define IMAGESAVEJOB_H
+
+#include <QtCore/QObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QString>
+#include <QtCore/QSize>
+
+class ImageSaveJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+    /*! The progress of the job from 0.0 to 1.0. */
+    Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
+
+    /*! True until the job has finished. */
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+
+public:
+    ImageSaveJob(const QString &imagePath, const QString &savePath, const QSize &maxSize,
+                 QObject *parent = 0);
+
+    qreal progress() const;
+    bool isRunning() const;
+
+    void start();
+    void run();
+
+    static bool saveImage(const QString &imagePath, const QString &savePath, const QSize &maxSize,
+                          ImageSaveJob *job = 0);
+
+signals:
+    void progressChanged();
+    void runningChanged();
+
+    /*! Emit when the job has finished. \p savedFileUrl is the 'file://' URL of the saved
+        file or an empty string if saving failed. The job is deleted afterwards. */
+    void finished(const QString &savedFileUrl);
+
+    // used internally to pass the results of the worker thread to the thread of the job
+    void progressReported(qreal progress);
+    void saveDone(bool success);
+
+private slots:
+    void onProgressReported(qreal progress);
+    void onCopyFinished(int jobId, bool success);
+    void onSaveDone(bool success);
+
+private:
+    Q_DISABLE_COPY(ImageSaveJob)
+
+    const QString m_imagePath;
+    const QString m_savePath;
+    const QSize m_maxSize;
+    qreal m_progress;
+    bool m_isRunning;
+    int m_copyJobId;
+};
+
+#endif // IMAGESAVEJOB_H
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "imagescaler.h"
+
+#include <QtCore/QVarLengthArray>
+
+#include <cstring>
+
+// IMAGESCALER_NO_SIMD forces the scalar fallback, e.g. to test it against the vectorized code
+#if defined(IMAGESCALER_NO_SIMD)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGESCALER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGESCALER_SSE2
+#endif
+
+static const int MAX_BOX_FACTOR = 256;
+
+// the sum of the rows is accumulated in 16 bit per channel, so at most 257 rows can be summed up at once
+static const int MAX_ACCUMULATED_ROWS = 257;
+
+// Adds the channels of the given row (count bytes) to the 16 bit accumulators
+static void accumulateRow(quint16 *acc, const uchar *row, int count)
+{
+    int i = 0;
+
+#if defined(IMAGESCALER_NEON)
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t pixels = vld1q_u8(row + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(pixels)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(pixels)));
+    }
+#elif defined(IMAGESCALER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= count; i += 16) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        __m128i *low = reinterpret_cast<__m128i *>(acc + i);
+        __m128i *high = reinterpret_cast<__m128i *>(acc + i + 8);
+
+        _mm_storeu_si128(low, _mm_add_epi16(_mm_loadu_si128(low), _mm_unpacklo_epi8(pixels, zero)));
+        _mm_storeu_si128(high, _mm_add_epi16(_mm_loadu_si128(high), _mm_unpackhi_epi8(pixels, zero)));
+    }
+#endif
+
+    // scalar fallback and the remaining bytes
+    for (; i < count; ++i)
+        acc[i] += row[i];
+}
+
+// Adds the channels of count pixels (the sums of their columns) to sum
+template <typename T>
+static void sumColumns(const T *column, int count, quint32 *sum)
+{
+    for (int i = 0; i < count; ++i, column += 4) {
+        sum[0] += column[0];
+        sum[1] += column[1];
+        sum[2] += column[2];
+        sum[3] += column[3];
+    }
+}
+
+/*!
+    \class ImageScaler
+    \since 1.5.0
+    \brief The ImageScaler class provides a fast downscaler for large images.
+
+    ImageScaler reduces images by an integer factor with a box (area averaging) filter before the
+    remaining fractional scaling is done by QImage::scaled(). The summing of the source rows,
+    which is the hot loop, is vectorized with NEON or SSE2 if the compiler targets it and
+    otherwise falls back to plain C++. This is considerably faster than the generic smooth
+    scaling of QImage for large reduction factors, e.g. for long images.
+*/
+
+/*!
+ * \brief ImageScaler::scaled Scales the image to the given size.
+ * \param image The image that should be scaled.
+ * \param size The size of the scaled image, the aspect ratio is not preserved.
+ * \return Returns the scaled image. Images which are scaled up are scaled by QImage::scaled().
+ */
+QImage ImageScaler::scaled(const QImage &image, const QSize &size)
+{
+    if (image.isNull() || size.isEmpty())
+        return QImage();
+
+    const int factor = qMin(MAX_BOX_FACTOR, qMin(image.width() / size.width(), image.height() / size.height()));
+    QImage result = (factor >= 2) ? boxDownscaled(image, factor) : image;
+
+    if (result.size() != size)
+        result = result.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    return result;
+}
+
+/*!
+ * \brief ImageScaler::boundedSize Calculates the size of an image which is scaled down to fit
+ *  into \a maxSize with its aspect ratio preserved.
+ * \param size The size of the image.
+ * \param maxSize The maximum size, a width or height <= 0 is not limited.
+ * \return Returns the scaled size or \a size if it fits into \a maxSize.
+ */
+QSize ImageScaler::boundedSize(const QSize &size, const QSize &maxSize)
+{
+    QSize targetSize = size;
+
+    if (maxSize.width() > 0)
+        targetSize.setWidth(qMin(targetSize.width(), maxSize.width()));
+    if (maxSize.height() > 0)
+        targetSize.setHeight(qMin(targetSize.height(), maxSize.height()));
+
+    if (targetSize == size)
+        return size;
+
+    return size.scaled(targetSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+}
+
+/*!
+ * \brief ImageScaler::boxDownscaled Reduces the image by an integer factor, every pixel of the
+ *  result is the average of a square of \a factor x \a factor source pixels.
+ * \param image The image that should be reduced.
+ * \param factor The reduction factor from 1 to 256. The remaining rows and columns of the image
+ *  which do not fill a whole square are averaged into the last square of each row and column, so
+ *  that the result covers the whole image.
+ * \return Returns the reduced image in the format QImage::Format_RGB32 or, if the image has an
+ *  alpha channel, QImage::Format_ARGB32_Premultiplied.
+ */
+QImage ImageScaler::boxDownscaled(const QImage &image, int factor)
+{
+    if (image.isNull() || (factor < 1) || (factor > MAX_BOX_FACTOR))
+        return QImage();
+
+    // all channels are averaged in the same way, which is only correct for premultiplied alpha
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                          : QImage::Format_RGB32;
+    const QImage source = (image.format() == format) ? image : image.convertToFormat(format);
+
+    const int targetWidth = source.width() / factor;
+    const int targetHeight = source.height() / factor;
+
+    if ((targetWidth == 0) || (targetHeight == 0))
+        return QImage();
+
+    QImage target(targetWidth, targetHeight, format);
+
+    const int rowBytes = source.width() * 4;
+    QVarLengthArray<quint16, 4096> acc(rowBytes);
+    // the last row of squares can have more rows than the 16 bit accumulators can sum up
+    QVarLengthArray<quint32, 1> wideAcc;
+
+    for (int y = 0; y < targetHeight; ++y) {
+        const int firstRow = y * factor;
+        const int rowCount = (y == targetHeight - 1) ? source.height() - firstRow : factor;
+        const bool isWide = rowCount > MAX_ACCUMULATED_ROWS;
+
+        memset(acc.data(), 0, rowBytes * sizeof(quint16));
+
+        if (isWide) {
+            wideAcc.resize(rowBytes);
+            memset(wideAcc.data(), 0, rowBytes * sizeof(quint32));
+        }
+
+        for (int i = 0; i < rowCount; ++i) {
+            accumulateRow(acc.data(), source.constScanLine(firstRow + i), rowBytes);
+
+            // the 16 bit sums are moved to the wide accumulators before they can overflow
+            if (isWide && (((i + 1) % MAX_ACCUMULATED_ROWS == 0) || (i == rowCount - 1))) {
+                for (int j = 0; j < rowBytes; ++j)
+                    wideAcc[j] += acc[j];
+
+                memset(acc.data(), 0, rowBytes * sizeof(quint16));
+            }
+        }
+
+        uchar *targetLine = target.scanLine(y);
+
+        for (int x = 0; x < targetWidth; ++x) {
+            const int firstColumn = x * factor;
+            const int columnCount = (x == targetWidth - 1) ? source.width() - firstColumn : factor;
+            const quint32 area = quint32(rowCount) * columnCount;
+            quint32 sum[4] = {0, 0, 0, 0};
+
+            if (isWide)
+                sumColumns(wideAcc.constData() + firstColumn * 4, columnCount, sum);
+            else
+                sumColumns(acc.constData() + firstColumn * 4, columnCount, sum);
+
+            for (int c = 0; c < 4; ++c)
+                targetLine[x * 4 + c] = uchar((sum[c] + area / 2) / area);
+        }
+    }
+
+    return target;
+}
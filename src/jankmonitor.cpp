@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "jankmonitor.h"
+
+#include <QtCore/QThread>
+#include <QtCore/QDebug>
+#include <QtGui/QScreen>
+#include <QtQuick/QQuickWindow>
+
+#include "metricsregistry.h"
+
+// the number of recent tasks which are kept for the attribution of the long frames
+static const int MAX_TASKS = 64;
+
+// the number of frames of the rolling jank histogram (10 seconds at 60 fps)
+static const int RECENT_FRAMES = 600;
+
+// tasks which block the GUI thread for longer are logged
+static const qint64 LONG_TASK_MS = 100;
+
+JankMonitor *JankMonitor::m_instance = 0;
+
+JankMonitor::Task::Task(const char *name)
+    : m_name(name), m_start(-1)
+{
+    JankMonitor *monitor = JankMonitor::instance();
+
+    // only the tasks of the GUI thread can block the frames
+    if (monitor != 0 && QThread::currentThread() == monitor->thread())
+        m_start = monitor->m_clock.elapsed();
+}
+
+JankMonitor::Task::~Task()
+{
+    JankMonitor *monitor = JankMonitor::instance();
+
+    if (m_start >= 0 && monitor != 0)
+        monitor->addTask(m_name, m_start, monitor->m_clock.elapsed());
+}
+
+JankMonitor::JankMonitor(QQuickWindow *window, QObject *parent) :
+    QObject(parent), m_frameInterval(1000.0 / 60), m_lastSwapTime(-1), m_tasks(MAX_TASKS),
+    m_nextTask(0), m_recentDropped(RECENT_FRAMES, -1), m_nextFrame(0)
+{
+    Q_ASSERT_X(m_instance == 0, Q_FUNC_INFO, "Only one JankMonitor may be created");
+    m_instance = this;
+
+    TaskRecord emptyRecord = { 0, 0, 0 };
+    m_tasks.fill(emptyRecord);
+
+    if (window->screen() != 0 && window->screen()->refreshRate() > 0)
+        m_frameInterval = 1000.0 / window->screen()->refreshRate();
+
+    m_clock.start();
+
+    // frameSwapped() is emitted on the render thread, the frame is processed on the GUI thread
+    connect(window, &QQuickWindow::frameSwapped, this, &JankMonitor::onFrameSwapped,
+            Qt::DirectConnection);
+}
+
+JankMonitor::~JankMonitor()
+{
+    m_instance = 0;
+}
+
+JankMonitor *JankMonitor::instance()
+{
+    return m_instance;
+}
+
+void JankMonitor::onFrameSwapped()
+{
+    QMetaObject::invokeMethod(this, "processFrame", Qt::QueuedConnection,
+                              Q_ARG(qint64, m_clock.elapsed()));
+}
+
+void JankMonitor::watchView(QObject *view)
+{
+    if (view == 0 || view->metaObject()->indexOfProperty("moving") < 0) {
+        qWarning("JankMonitor::watchView(): The view has no 'moving' property");
+        return;
+    }
+
+    connect(view, SIGNAL(movingChanged()), this, SLOT(onViewMovingChanged()), Qt::UniqueConnection);
+    connect(view, SIGNAL(destroyed(QObject*)), this, SLOT(onViewDestroyed(QObject*)), Qt::UniqueConnection);
+}
+
+void JankMonitor::processFrame(qint64 swapTime)
+{
+    // a view requests a frame after every frame only while it is moving, the interval to
+    // a frame which has been requested on demand (e.g. after a tap) is not a dropped frame
+    if (m_movingViews.isEmpty()) {
+        m_lastSwapTime = -1;
+        return;
+    }
+
+    const qint64 lastSwapTime = m_lastSwapTime;
+    m_lastSwapTime = swapTime;
+
+    if (lastSwapTime < 0)
+        return;
+
+    const qint64 interval = swapTime - lastSwapTime;
+
+    MetricsRegistry *metrics = MetricsRegistry::instance();
+    metrics->addSample("frame.intervalMs", interval);
+
+    const int dropped = qMax(0, qRound(interval / m_frameInterval) - 1);
+    m_recentDropped[m_nextFrame] = dropped;
+    m_nextFrame = (m_nextFrame + 1) % RECENT_FRAMES;
+
+    // the gauges are updated about once per second while a view is moving
+    if (m_nextFrame % 60 == 0)
+        updateRecentDropped();
+
+    if (dropped == 0)
+        return;
+
+    metrics->increment("frame.long");
+
+    const TaskRecord *task = longestTask(lastSwapTime, swapTime);
+    if (task != 0) {
+        metrics->increment(QString("frame.longBy.") + task->name);
+        qDebug("JankMonitor: Frame of %lld ms dropped %d frames, %s ran for %lld ms", interval,
+               dropped, task->name, task->end - task->start);
+    }
+    else {
+        metrics->increment("frame.longBy.unknown");
+    }
+}
+
+void JankMonitor::onViewMovingChanged()
+{
+    QObject *view = sender();
+
+    if (view->property("moving").toBool()) {
+        m_movingViews.insert(view);
+        return;
+    }
+
+    m_movingViews.remove(view);
+
+    if (m_movingViews.isEmpty())
+        m_lastSwapTime = -1;
+}
+
+void JankMonitor::onViewDestroyed(QObject *view)
+{
+    m_movingViews.remove(view);
+
+    if (m_movingViews.isEmpty())
+        m_lastSwapTime = -1;
+}
+
+void JankMonitor::addTask(const char *name, qint64 start, qint64 end)
+{
+    TaskRecord &record = m_tasks[m_nextTask];
+    record.name = name;
+    record.start = start;
+    record.end = end;
+    m_nextTask = (m_nextTask + 1) % MAX_TASKS;
+
+    MetricsRegistry::instance()->addSample(QString("guiTask.%1Ms").arg(name), end - start);
+
+    if (end - start > LONG_TASK_MS)
+        qDebug("JankMonitor: %s blocked the GUI thread for %lld ms", name, end - start);
+}
+
+// Returns the longest task which ran between start and end and might have delayed the frame
+const JankMonitor::TaskRecord *JankMonitor::longestTask(qint64 start, qint64 end) const
+{
+    const TaskRecord *longest = 0;
+
+    for (int i = 0; i < m_tasks.count(); ++i) {
+        const TaskRecord &record = m_tasks.at(i);
+        if (record.name == 0 || record.end < start || record.start > end)
+            continue;
+
+        if (longest == 0 || record.end - record.start > longest->end - longest->start)
+            longest = &record;
+    }
+
+    // short tasks are not the cause of the long frame
+    if (longest != 0 && longest->end - longest->start < m_frameInterval / 2)
+        return 0;
+
+    return longest;
+}
+
+void JankMonitor::updateRecentDropped()
+{
+    int counts[5] = { 0, 0, 0, 0, 0 };
+
+    foreach (int dropped, m_recentDropped) {
+        if (dropped < 0)
+            continue;
+        else if (dropped <= 2)
+            ++counts[dropped];
+        else if (dropped <= 5)
+            ++counts[3];
+        else
+            ++counts[4];
+    }
+
+    MetricsRegistry *metrics = MetricsRegistry::instance();
+    metrics->setGauge("frame.recentDropped.0", counts[0]);
+    metrics->setGauge("frame.recentDropped.1", counts[1]);
+    metrics->setGauge("frame.recentDropped.2", counts[2]);
+    metrics->setGauge("frame.recentDropped.3to5", counts[3]);
+    metrics->setGauge("frame.recentDropped.6plus", counts[4]);
+}
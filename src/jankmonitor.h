@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef JANKMONITOR_H
+#define JANKMONITOR_H
+
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+class QQuickWindow;
+
+/*! Monitor of the frame times of the QML window
+
+    Measures the interval between the frames swapped by the scene graph while a list view
+    is moving (see watchView()) and counts the frames which have been dropped. The scene is
+    rendered on demand, so the interval between other frames says nothing about jank. A frame is dropped if the
+    GUI thread was blocked for longer than the frame interval of the screen, which is the
+    cause of the stutter while scrolling. The C++ slots which run on the GUI thread are
+    marked with a JankMonitor::Task, so that each long frame is attributed to the longest
+    task that ran during it.
+
+    The results are recorded in the MetricsRegistry: the histogram "frame.intervalMs", the
+    counter "frame.long" and one counter "frame.longBy.<task>" per attributed task, the
+    histogram "guiTask.<task>Ms" with the duration of each task and the gauges
+    "frame.recentDropped.<n>" with the number of frames in the last 10 seconds that
+    dropped n frames (the rolling jank histogram).
+
+    There is one instance per application, which must be created in main() after the
+    MetricsRegistry.
+ */
+class JankMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    /*! Marks the code which runs on the GUI thread until the end of the scope, \p name
+        must be a string literal. */
+    class Task
+    {
+    public:
+        explicit Task(const char *name);
+        ~Task();
+
+    private:
+        Q_DISABLE_COPY(Task)
+
+        const char *m_name;
+        qint64 m_start;
+    };
+
+    /*! Constructor, starts monitoring the frames of \p window. */
+    explicit JankMonitor(QQuickWindow *window, QObject *parent = 0);
+    ~JankMonitor();
+
+    /*! Get the instance of the application (can be 0). */
+    static JankMonitor *instance();
+
+    /*! Measure the frames while \p view (a Flickable) is moving. */
+    Q_INVOKABLE void watchView(QObject *view);
+
+private slots:
+    void onFrameSwapped();
+    void processFrame(qint64 swapTime);
+    void onViewMovingChanged();
+    void onViewDestroyed(QObject *view);
+
+private:
+    struct TaskRecord {
+        const char *name;
+        qint64 start;
+        qint64 end;
+    };
+
+    void addTask(const char *name, qint64 start, qint64 end);
+    const TaskRecord *longestTask(qint64 start, qint64 end) const;
+    void updateRecentDropped();
+
+    static JankMonitor *m_instance;
+
+    QElapsedTimer m_clock;          // shared by the GUI and the render thread
+    qreal m_frameInterval;          // in ms
+    qint64 m_lastSwapTime;          // in ms, -1 while no view is moving
+    QSet<QObject *> m_movingViews;
+    QVector<TaskRecord> m_tasks;    // a ring buffer of the recent tasks
+    int m_nextTask;
+    QVector<int> m_recentDropped;   // a ring buffer of the dropped frames of the recent frames
+    int m_nextFrame;
+};
+
+#endif // JANKMONITOR_H
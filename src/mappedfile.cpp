@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "mappedfile.h"
+
+#include <climits>
+
+MappedFile::MappedFile(const QString &fileName)
+    : m_file(fileName), m_data(0), m_size(0)
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+        return;
+
+    m_size = m_file.size();
+
+    if (m_size > 0)
+        m_data = m_file.map(0, m_size);
+
+    if (m_data == 0)
+        m_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != 0)
+        m_file.unmap(m_data);
+}
+
+bool MappedFile::isValid() const
+{
+    return m_data != 0;
+}
+
+const uchar *MappedFile::data() const
+{
+    return m_data;
+}
+
+qint64 MappedFile::size() const
+{
+    return m_size;
+}
+
+QByteArray MappedFile::bytes() const
+{
+    if ((m_data == 0) || (m_size > INT_MAX))
+        return QByteArray();
+
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_data), int(m_size));
+}
+
+bool MappedFile::copy(const QString &source, const QString &destination)
+{
+    MappedFile sourceFile(source);
+
+    // e.g. empty files or file systems which do not support mapping
+    if (!sourceFile.isValid())
+        return QFile::copy(source, destination);
+
+    if (QFile::exists(destination))
+        return false;
+
+    QFile destinationFile(destination);
+    if (!destinationFile.open(QIODevice::WriteOnly))
+        return false;
+
+    const qint64 written = destinationFile.write(reinterpret_cast<const char *>(sourceFile.data()), sourceFile.size());
+    destinationFile.close();
+
+    if (written != sourceFile.size()) {
+        destinationFile.remove();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+
+/*! Read-only memory mapping of a file
+
+    Maps a whole file into memory, so that its content can be passed to decoders or
+    written to another file without reading it into a buffer first. The mapping is
+    released when the object is destroyed.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const QString &fileName);
+    ~MappedFile();
+
+    /*! True if the file has been mapped. Empty files can not be mapped. */
+    bool isValid() const;
+
+    const uchar *data() const;
+    qint64 size() const;
+
+    /*! Get the content of the file without copying it. The returned QByteArray must not
+        be used after the MappedFile has been destroyed. */
+    QByteArray bytes() const;
+
+    /*! Copy the file \p source to \p destination by writing the mapped content. Like
+        QFile::copy() the copy fails if \p destination already exists. */
+    static bool copy(const QString &source, const QString &destination);
+
+private:
+    Q_DISABLE_COPY(MappedFile)
+
+    QFile m_file;
+    uchar *m_data;
+    qint64 m_size;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "mediaqualitypolicy.h"
+
+#include <limits>
+
+// below this throughput the smallest renditions are downloaded
+static const qint64 LOW_THROUGHPUT = 128 * 1024;    // in bytes per second
+
+/*!
+    \class MediaQualityPolicy
+    \since 1.5.0
+    \brief The MediaQualityPolicy class selects the media renditions of the posts.
+
+    With HighQuality, the smallest image rendition whose width is at least the width of the
+    screen is selected (or the widest one if none is wide enough), so that no data is
+    downloaded for pixels which can not be displayed. With LowQuality, the smallest rendition
+    is selected. LowQuality is used if the data saver is enabled or the throughput of the
+    network is low.
+
+    There is only a single video rendition ('image460sv'), the watermarked rendition is
+    used as fallback.
+
+    \sa GagRequest::setMediaQualityPolicy()
+*/
+
+MediaQualityPolicy::MediaQualityPolicy()
+    : m_quality(HighQuality), m_screenWidth(std::numeric_limits<int>::max())
+{
+}
+
+MediaQualityPolicy MediaQualityPolicy::evaluate(qint64 throughput, bool dataSaver, int screenWidth)
+{
+    MediaQualityPolicy policy;
+    policy.m_screenWidth = screenWidth;
+
+    if (dataSaver || (throughput >= 0 && throughput < LOW_THROUGHPUT))
+        policy.m_quality = LowQuality;
+
+    return policy;
+}
+
+MediaQualityPolicy::Quality MediaQualityPolicy::quality() const
+{
+    return m_quality;
+}
+
+QUrl MediaQualityPolicy::imageUrl(const QJsonObject &images) const
+{
+    return QUrl(images.value(imageKey(images)).toObject().value("url").toString());
+}
+
+QSize MediaQualityPolicy::imageSize(const QJsonObject &images) const
+{
+    const QJsonObject rendition = images.value(imageKey(images)).toObject();
+    const QSize size(rendition.value("width").toInt(), rendition.value("height").toInt());
+
+    return size.isEmpty() ? QSize() : size;
+}
+
+QUrl MediaQualityPolicy::videoUrl(const QJsonObject &images) const
+{
+    return renditionUrl(images, QStringList() << "image460sv" << "image460svwm");
+}
+
+// Returns the URL of the first of the given renditions which is available
+QUrl MediaQualityPolicy::renditionUrl(const QJsonObject &images, const QStringList &keys)
+{
+    foreach (const QString &key, keys) {
+        const QUrl url(images.value(key).toObject().value("url").toString());
+
+        if (!url.isEmpty())
+            return url;
+    }
+
+    return QUrl();
+}
+
+// Returns the key of the image rendition which should be used, see the class description
+QString MediaQualityPolicy::imageKey(const QJsonObject &images) const
+{
+    const QStringList keys = QStringList() << "image460" << "image700";
+    QString selectedKey;
+    int selectedWidth = 0;
+
+    foreach (const QString &key, keys) {
+        const QJsonObject rendition = images.value(key).toObject();
+
+        if (rendition.value("url").toString().isEmpty())
+            continue;
+
+        int width = rendition.value("width").toInt();
+        if (width <= 0)
+            width = key.mid(5).toInt();     // e.g. 460 for 'image460'
+
+        if (selectedKey.isEmpty()) {
+            selectedKey = key;
+            selectedWidth = width;
+        }
+        // replace the smaller rendition only if it doesn't cover the screen
+        else if (m_quality == HighQuality && selectedWidth < m_screenWidth && width > selectedWidth) {
+            selectedKey = key;
+            selectedWidth = width;
+        }
+    }
+
+    return selectedKey;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef MEDIAQUALITYPOLICY_H
+#define MEDIAQUALITYPOLICY_H
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+#include <QtCore/QSize>
+
+/*! Select the media renditions of the posts
+
+    The 9GAG API provides every image in multiple renditions (e.g. 'image460' and 'image700').
+    The policy selects the rendition that should be downloaded, based on the measured
+    throughput of the network (see NetworkManager::throughput()), the data saver setting
+    (see AppSettings::dataSaver) and the width of the screen. It is evaluated for every
+    page of posts, so that the quality follows a changing connection.
+ */
+class MediaQualityPolicy
+{
+public:
+    enum Quality {
+        HighQuality,    //!< The smallest rendition that covers the width of the screen.
+        LowQuality      //!< The smallest available rendition.
+    };
+
+    /*! Constructor, the policy selects the widest renditions. */
+    MediaQualityPolicy();
+
+    /*! Evaluate the policy. \p throughput is the throughput in bytes per second (or a
+        negative value if unknown) and \p screenWidth the width of the screen in portrait
+        orientation. */
+    static MediaQualityPolicy evaluate(qint64 throughput, bool dataSaver, int screenWidth);
+
+    Quality quality() const;
+
+    /*! Get the URL of the image rendition for photos and preview images from \p images. */
+    QUrl imageUrl(const QJsonObject &images) const;
+
+    /*! Get the size of the image rendition that is selected by imageUrl(), or an invalid
+        size if it is not specified in \p images. */
+    QSize imageSize(const QJsonObject &images) const;
+
+    /*! Get the URL of the video rendition from \p images. */
+    QUrl videoUrl(const QJsonObject &images) const;
+
+private:
+    QString imageKey(const QJsonObject &images) const;
+    static QUrl renditionUrl(const QJsonObject &images, const QStringList &keys);
+
+    Quality m_quality;
+    int m_screenWidth;
+};
+
+#endif // MEDIAQUALITYPOLICY_H
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "metricsregistry.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QStringList>
+#include <QtCore/qmath.h>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+// the upper bounds of the buckets of the histograms, the last bucket holds all larger samples
+static const double BUCKET_BOUNDS[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+static const int BUCKET_COUNT = sizeof(BUCKET_BOUNDS) / sizeof(BUCKET_BOUNDS[0]) + 1;
+
+MetricsRegistry *MetricsRegistry::m_instance = 0;
+
+MetricsRegistry::Histogram::Histogram()
+    : buckets(BUCKET_COUNT, 0), count(0), sum(0), min(0), max(0)
+{
+}
+
+void MetricsRegistry::Histogram::add(double value)
+{
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && value > BUCKET_BOUNDS[bucket])
+        ++bucket;
+
+    ++buckets[bucket];
+    min = (count == 0) ? value : qMin(min, value);
+    max = (count == 0) ? value : qMax(max, value);
+    sum += value;
+    ++count;
+}
+
+// Estimates the percentile by the upper bound of the bucket which contains it
+double MetricsRegistry::Histogram::percentile(double fraction) const
+{
+    const int rank = qMax(1, qCeil(fraction * count));
+    int cumulative = 0;
+
+    for (int bucket = 0; bucket < BUCKET_COUNT - 1; ++bucket) {
+        cumulative += buckets.at(bucket);
+        if (cumulative >= rank)
+            return qBound(min, BUCKET_BOUNDS[bucket], max);
+    }
+
+    return max;
+}
+
+MetricsRegistry::MetricsRegistry(QObject *parent) :
+    QObject(parent)
+{
+    Q_ASSERT_X(m_instance == 0, Q_FUNC_INFO, "Only one MetricsRegistry may be created");
+    m_instance = this;
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    m_instance = 0;
+}
+
+MetricsRegistry *MetricsRegistry::instance()
+{
+    Q_ASSERT_X(m_instance != 0, Q_FUNC_INFO, "The MetricsRegistry has not been created");
+    return m_instance;
+}
+
+void MetricsRegistry::increment(const QString &name, qint64 delta)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_counters[name] += delta;
+}
+
+void MetricsRegistry::setGauge(const QString &name, double value)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_gauges.insert(name, value);
+}
+
+void MetricsRegistry::addSample(const QString &name, double value)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_histograms[name].add(value);
+}
+
+QVariantList MetricsRegistry::snapshot()
+{
+    emit snapshotRequested();
+
+    const double memoryKb = residentMemoryKb();
+    if (memoryKb >= 0)
+        setGauge("memory.residentKb", memoryKb);
+
+    QMutexLocker locker(&m_mutex);
+    QVariantList metrics;
+
+    QMap<QString, qint64>::const_iterator counter = m_counters.constBegin();
+    for (; counter != m_counters.constEnd(); ++counter) {
+        QVariantMap metric;
+        metric.insert("name", counter.key());
+        metric.insert("type", "counter");
+        metric.insert("value", counter.value());
+        metrics.append(metric);
+    }
+
+    QMap<QString, double>::const_iterator gauge = m_gauges.constBegin();
+    for (; gauge != m_gauges.constEnd(); ++gauge) {
+        QVariantMap metric;
+        metric.insert("name", gauge.key());
+        metric.insert("type", "gauge");
+        metric.insert("value", gauge.value());
+        metrics.append(metric);
+    }
+
+    QMap<QString, Histogram>::const_iterator histogram = m_histograms.constBegin();
+    for (; histogram != m_histograms.constEnd(); ++histogram) {
+        const Histogram &h = histogram.value();
+        QVariantMap metric;
+        metric.insert("name", histogram.key());
+        metric.insert("type", "histogram");
+        metric.insert("count", h.count);
+        metric.insert("mean", h.sum / h.count);
+        metric.insert("min", h.min);
+        metric.insert("max", h.max);
+        metric.insert("p50", h.percentile(0.5));
+        metric.insert("p95", h.percentile(0.95));
+        metrics.append(metric);
+    }
+
+    return metrics;
+}
+
+QString MetricsRegistry::report()
+{
+    QStringList lines;
+    lines << QString("GagBook %1, %2").arg(QCoreApplication::applicationVersion())
+                                      .arg(QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+
+    foreach (const QVariant &metricVariant, snapshot()) {
+        const QVariantMap metric = metricVariant.toMap();
+
+        if (metric.value("type") == "histogram") {
+            lines << QString("%1: n=%2 mean=%3 p50=%4 p95=%5 min=%6 max=%7")
+                     .arg(metric.value("name").toString()).arg(metric.value("count").toInt())
+                     .arg(metric.value("mean").toDouble(), 0, 'f', 1)
+                     .arg(metric.value("p50").toDouble(), 0, 'f', 1)
+                     .arg(metric.value("p95").toDouble(), 0, 'f', 1)
+                     .arg(metric.value("min").toDouble(), 0, 'f', 1)
+                     .arg(metric.value("max").toDouble(), 0, 'f', 1);
+        }
+        else {
+            lines << QString("%1: %2").arg(metric.value("name").toString())
+                                      .arg(metric.value("value").toDouble(), 0, 'f', 0);
+        }
+    }
+
+    return lines.join("\n");
+}
+
+void MetricsRegistry::reset()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_counters.clear();
+    m_gauges.clear();
+    m_histograms.clear();
+}
+
+// Returns the resident memory of the process in KB or -1 if it is not available
+double MetricsRegistry::residentMemoryKb()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+
+    // the second field is the number of resident pages
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count() < 2)
+        return -1;
+
+    return fields.at(1).toDouble() * sysconf(_SC_PAGESIZE) / 1024;
+#else
+    return -1;
+#endif
+}
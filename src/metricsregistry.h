@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef METRICSREGISTRY_H
+#define METRICSREGISTRY_H
+
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QVariantList>
+#include <QtCore/QVector>
+
+/*! Registry of the performance metrics of the app session
+
+    Collects counters (e.g. the number of API requests), gauges (e.g. the number of rows
+    of the GagModel) and histograms (e.g. the latency of the API requests in ms) by name,
+    so that they can be shown on the diagnostics page and sent in bug reports. The
+    resident memory of the process is sampled when a snapshot is taken. All methods are
+    thread-safe.
+
+    There is one instance per application, which must be created in main() before any
+    other object that records metrics and outlive them.
+ */
+class MetricsRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    /*! Constructor, sets the instance of the application. */
+    explicit MetricsRegistry(QObject *parent = 0);
+    ~MetricsRegistry();
+
+    /*! Get the instance of the application. */
+    static MetricsRegistry *instance();
+
+    /*! Add \p delta to the counter \p name. */
+    void increment(const QString &name, qint64 delta = 1);
+
+    /*! Set the gauge \p name to \p value. */
+    void setGauge(const QString &name, double value);
+
+    /*! Add the sample \p value to the histogram \p name. */
+    void addSample(const QString &name, double value);
+
+    /*! Get all metrics as a list of maps, sorted by type and name. Each map contains the
+        "name", the "type" ("counter", "gauge" or "histogram") and the "value". Histograms
+        contain the "count", "mean", "min", "max", "p50" and "p95" instead of the value. */
+    Q_INVOKABLE QVariantList snapshot();
+
+    /*! Get all metrics as plain text, one metric per line. */
+    Q_INVOKABLE QString report();
+
+    /*! Remove all metrics. */
+    Q_INVOKABLE void reset();
+
+signals:
+    /*! Emit by snapshot() in the calling thread before the metrics are collected, so that
+        gauges which would be costly to keep up to date can be set on demand (connect with
+        Qt::DirectConnection). */
+    void snapshotRequested();
+
+private:
+    struct Histogram {
+        Histogram();
+        void add(double value);
+        double percentile(double fraction) const;
+
+        QVector<int> buckets;
+        int count;
+        double sum;
+        double min;
+        double max;
+    };
+
+    static double residentMemoryKb();
+
+    static MetricsRegistry *m_instance;
+
+    QMutex m_mutex;
+    QMap<QString, qint64> m_counters;
+    QMap<QString, double> m_gauges;
+    QMap<QString, Histogram> m_histograms;
+};
+
+/*! Add the time in ms from the construction to the destruction to the histogram \p name
+    of the MetricsRegistry. */
+class MetricsTimer
+{
+public:
+    explicit MetricsTimer(const QString &name) : m_name(name) { m_timer.start(); }
+    ~MetricsTimer() { MetricsRegistry::instance()->addSample(m_name, m_timer.nsecsElapsed() / 1000000.0); }
+
+private:
+    Q_DISABLE_COPY(MetricsTimer)
+
+    const QString m_name;
+    QElapsedTimer m_timer;
+};
+
+#endif // METRICSREGISTRY_H
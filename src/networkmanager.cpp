@@ -33,8 +33,14 @@
 #include <QtNetwork/QNetworkCookie>
 
 #include "gagcookiejar.h"
+#include "networkrecorder.h"
 
 static const QByteArray USER_AGENT = QByteArray("GagBook/") + APP_VERSION;
+
+// smaller downloads are dominated by the latency and are not measured
+static const qint64 MIN_MEASURED_BYTES = 64 * 1024;
+// weight of a new measurement in the moving average
+static const qreal THROUGHPUT_WEIGHT = 0.3;
 /*
 // Note: QT 5.6 and SFOS 2.1.0.x introduced 'QNetworkRequest::FollowRedirectsAttribute'
 static bool checkForRedirection(QNetworkReply *reply)
@@ -54,11 +60,10 @@ static bool checkForRedirection(QNetworkReply *reply)
 
 NetworkManager::NetworkManager(QObject *parent) :
     QObject(parent), m_networkAccessManager(new QNetworkAccessManager(this)),
-    m_downloadCounter(0), m_downloadCounterStr("0.00")
+    m_recorder(NetworkRecorder::fromEnvironment(this)), m_downloadCounter(0), m_downloadCounterStr("0.00"), m_busyBytes(0),
+    m_throughput(-1)
 {
     m_networkAccessManager->setCookieJar(new GagCookieJar);
-    connect(m_networkAccessManager, SIGNAL(finished(QNetworkReply*)),
-            SLOT(increaseDownloadCounter(QNetworkReply*)));
 }
 
 QNetworkReply *NetworkManager::createGetRequest(const QUrl &url, AcceptType acceptType)
@@ -75,7 +80,21 @@ QNetworkReply *NetworkManager::createGetRequest(const QUrl &url, AcceptType acce
     default: qWarning("NetworkManager::createGetRequest(): Invalid acceptType"); break;
     }
 
-    return m_networkAccessManager->get(request);
+    QNetworkReply *reply = sendRequest(request, QNetworkAccessManager::GetOperation);
+
+    // the replies of image requests are used to measure the throughput
+    if (acceptType == Image) {
+        if (m_activeImageReplies.isEmpty()) {
+            m_busyTimer.start();
+            m_busyBytes = 0;
+        }
+        m_activeImageReplies.insert(reply);
+
+        // a reply which is deleted without having finished must not keep the busy period open
+        connect(reply, &QObject::destroyed, this, [this, reply]() { endImageReply(reply); });
+    }
+
+    return reply;
 }
 
 QNetworkReply *NetworkManager::createGetRequest(QNetworkRequest &netRequest)
@@ -86,7 +105,7 @@ QNetworkReply *NetworkManager::createGetRequest(QNetworkRequest &netRequest)
     }*/
 
     //netRequest.setRawHeader("User-Agent", USER_AGENT);
-    return m_networkAccessManager->get(netRequest);
+    return sendRequest(netRequest, QNetworkAccessManager::GetOperation);
 }
 
 QNetworkReply *NetworkManager::createPostRequest(const QUrl &url, const QByteArray &data)
@@ -96,7 +115,37 @@ QNetworkReply *NetworkManager::createPostRequest(const QUrl &url, const QByteArr
     request.setRawHeader("User-Agent", USER_AGENT);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
 
-    return m_networkAccessManager->post(request, data);
+    return sendRequest(request, QNetworkAccessManager::PostOperation, data);
+}
+
+QNetworkReply *NetworkManager::sendRequest(const QNetworkRequest &request,
+                                           QNetworkAccessManager::Operation operation,
+                                           const QByteArray &data)
+{
+    QNetworkReply *reply;
+
+    if (m_recorder != 0 && m_recorder->mode() == NetworkRecorder::ReplayMode) {
+        reply = m_recorder->replay(request, operation);
+    }
+    else {
+        if (operation == QNetworkAccessManager::PostOperation)
+            reply = m_networkAccessManager->post(request, data);
+        else
+            reply = m_networkAccessManager->get(request);
+
+        if (m_recorder != 0)
+            reply = m_recorder->record(reply);
+    }
+
+    // the callers may drain the reply on readyRead(), so that size() is only the last chunk when it
+    // has finished; the received bytes are taken from the download progress instead
+    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply](qint64 bytesReceived, qint64) {
+        m_receivedBytes.insert(reply, bytesReceived);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { increaseDownloadCounter(reply); });
+    connect(reply, &QObject::destroyed, this, [this, reply]() { m_receivedBytes.remove(reply); });
+
+    return reply;
 }
 
 void NetworkManager::clearCookies()
@@ -111,12 +160,51 @@ QString NetworkManager::downloadCounter() const
     return m_downloadCounterStr;
 }
 
+qint64 NetworkManager::throughput() const
+{
+    return m_throughput;
+}
+
 void NetworkManager::increaseDownloadCounter(QNetworkReply *reply)
 {
-    m_downloadCounter += reply->size();
+    const qint64 receivedBytes = m_receivedBytes.take(reply);
+    updateThroughput(reply, receivedBytes);
+
+    m_downloadCounter += receivedBytes;
     const QString downloadCounterStr = QString::number(qreal(m_downloadCounter) / 1024 / 1024, 'f', 2);
     if (m_downloadCounterStr != downloadCounterStr) {
         m_downloadCounterStr = downloadCounterStr;
         emit downloadCounterChanged();
     }
 }
+
+void NetworkManager::updateThroughput(QNetworkReply *reply, qint64 receivedBytes)
+{
+    if (!m_activeImageReplies.contains(reply))
+        return;
+
+    // the replies share the bandwidth, so all replies of a busy period are measured together
+    if (reply->error() == QNetworkReply::NoError)
+        m_busyBytes += receivedBytes;
+
+    endImageReply(reply);
+}
+
+// Ends the busy period once no image reply is active anymore. Note: \a reply may have been destroyed.
+void NetworkManager::endImageReply(QNetworkReply *reply)
+{
+    if (!m_activeImageReplies.remove(reply) || !m_activeImageReplies.isEmpty())
+        return;
+
+    const qint64 elapsed = m_busyTimer.elapsed();
+
+    if (m_busyBytes < MIN_MEASURED_BYTES || elapsed <= 0)
+        return;
+
+    const qint64 sample = m_busyBytes * 1000 / elapsed;
+
+    if (m_throughput < 0)
+        m_throughput = sample;
+    else
+        m_throughput = qint64(THROUGHPUT_WEIGHT * sample + (1.0 - THROUGHPUT_WEIGHT) * m_throughput);
+}
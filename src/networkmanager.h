@@ -30,9 +30,13 @@
 #define NETWORKMANAGER_H
 
 #include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QNetworkRequest>
+#include <QNetworkAccessManager>
 
-class QNetworkAccessManager;
+class NetworkRecorder;
 //class QNetworkRequest;
 class QNetworkReply;
 class QUrl;
@@ -42,6 +46,7 @@ class QUrl;
     A wrapper for QNetworkAccessManager to provide easy-to-use create*Request()
     functions for use by other classes. Also responsible for tracking download counter.
     Only a single global instance of NetworkManager should be created for each app session.
+    The network traffic can be recorded and replayed, see NetworkRecorder.
  */
 class NetworkManager : public QObject
 {
@@ -69,6 +74,10 @@ public:
 
     QString downloadCounter() const;
 
+    /*! Get the measured throughput of the image downloads in bytes per second, or -1 if
+        nothing has been measured yet. */
+    qint64 throughput() const;
+
 signals:
     void downloadCounterChanged();
 
@@ -76,11 +85,25 @@ private slots:
     void increaseDownloadCounter(QNetworkReply *reply);
 
 private:
+    QNetworkReply *sendRequest(const QNetworkRequest &request, QNetworkAccessManager::Operation operation,
+                               const QByteArray &data = QByteArray());
+    void updateThroughput(QNetworkReply *reply, qint64 receivedBytes);
+    void endImageReply(QNetworkReply *reply);
+
     Q_DISABLE_COPY(NetworkManager)
 
     QNetworkAccessManager *m_networkAccessManager;
+    NetworkRecorder *m_recorder; // 0 unless recording or replaying
     qint64 m_downloadCounter; // in bytes
+    // the bytes received by the active replies, which are read by the callers while they are downloaded
+    QHash<QNetworkReply *, qint64> m_receivedBytes;
     QString m_downloadCounterStr; // in MB
+
+    // the throughput is measured over the periods in which images are downloaded
+    QElapsedTimer m_busyTimer;
+    QSet<QNetworkReply *> m_activeImageReplies;
+    qint64 m_busyBytes;
+    qint64 m_throughput; // in bytes per second
 };
 
 #endif // NETWORKMANAGER_H
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "networkrecorder.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+#include <QtCore/QDebug>
+
+#include "fileioworker.h"
+
+static const QByteArray ARCHIVE_MAGIC = "GAGBOOK-NETWORK-ARCHIVE-1\n";
+
+// the maximum number of chunks in which the body of a response is replayed
+static const int MAX_REPLAY_CHUNKS = 20;
+static const int REPLAY_CHUNK_SIZE = 64 * 1024;
+
+/*
+ * The reply that is handed out in both modes: it either forwards a live reply and
+ * records its response or it plays back a recorded response.
+ */
+class RecordedReply : public QNetworkReply
+{
+public:
+    RecordedReply(const QNetworkRequest &request, QNetworkAccessManager::Operation operation,
+                  QObject *parent);
+    ~RecordedReply();
+
+    void forward(QNetworkReply *source, NetworkRecorder *recorder);
+    void play(const NetworkRecorder::Entry &entry);
+
+    void abort();
+    qint64 bytesAvailable() const;
+    bool isSequential() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+
+private:
+    void applyMetaData(int statusCode, const QByteArray &reasonPhrase, const QString &redirectUrl,
+                       const QList<RawHeaderPair> &headers);
+    void appendData(const QByteArray &data);
+    void finish(NetworkError code, const QString &errorString);
+    void onSourceMetaDataChanged();
+    void onSourceReadyRead();
+    void onSourceFinished();
+    void playNextStep();
+    void releaseSource();
+
+    QPointer<QNetworkReply> m_source;
+    NetworkRecorder *m_recorder;
+    NetworkRecorder::Entry m_entry;
+    QElapsedTimer m_requestTimer;
+    QTimer m_replayTimer;
+    int m_replayStep;
+    int m_replayChunks;
+    QByteArray m_data;
+    int m_readPos;
+    qint64 m_received;
+    bool m_done;
+};
+
+RecordedReply::RecordedReply(const QNetworkRequest &request, QNetworkAccessManager::Operation operation,
+                             QObject *parent)
+    : QNetworkReply(parent), m_recorder(0), m_replayStep(0), m_replayChunks(0), m_readPos(0),
+      m_received(0), m_done(false)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(operation);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    m_replayTimer.setSingleShot(true);
+    connect(&m_replayTimer, &QTimer::timeout, this, [this]() { playNextStep(); });
+}
+
+RecordedReply::~RecordedReply()
+{
+    releaseSource();
+}
+
+void RecordedReply::forward(QNetworkReply *source, NetworkRecorder *recorder)
+{
+    m_source = source;
+    m_recorder = recorder;
+    m_requestTimer.start();
+
+    m_entry.operation = NetworkRecorder::operationName(source->operation());
+    m_entry.url = source->url().toString(QUrl::FullyEncoded);
+    m_entry.startTime = recorder->elapsed();
+
+    connect(source, &QNetworkReply::metaDataChanged, this, [this]() { onSourceMetaDataChanged(); });
+    connect(source, &QNetworkReply::readyRead, this, [this]() { onSourceReadyRead(); });
+    connect(source, &QNetworkReply::downloadProgress, this, &QNetworkReply::downloadProgress);
+    connect(source, &QNetworkReply::finished, this, [this]() { onSourceFinished(); });
+}
+
+void RecordedReply::play(const NetworkRecorder::Entry &entry)
+{
+    m_entry = entry;
+
+    if (!entry.body.isEmpty())
+        m_replayChunks = qBound(1, entry.body.size() / REPLAY_CHUNK_SIZE + 1, MAX_REPLAY_CHUNKS);
+
+    m_replayTimer.start(entry.firstByteTime);
+}
+
+void RecordedReply::abort()
+{
+    if (m_done)
+        return;
+
+    // aborted requests are not recorded
+    if (m_source) {
+        m_source->disconnect(this);
+        m_source->abort();
+    }
+    releaseSource();
+
+    finish(OperationCanceledError, "Operation canceled");
+}
+
+qint64 RecordedReply::bytesAvailable() const
+{
+    return m_data.size() - m_readPos + QNetworkReply::bytesAvailable();
+}
+
+bool RecordedReply::isSequential() const
+{
+    return true;
+}
+
+qint64 RecordedReply::readData(char *data, qint64 maxSize)
+{
+    const int count = int(qMin<qint64>(maxSize, m_data.size() - m_readPos));
+
+    if (count <= 0)
+        return m_done ? -1 : 0;
+
+    memcpy(data, m_data.constData() + m_readPos, count);
+    m_readPos += count;
+
+    if (m_readPos == m_data.size()) {
+        m_data.clear();
+        m_readPos = 0;
+    }
+
+    return count;
+}
+
+void RecordedReply::applyMetaData(int statusCode, const QByteArray &reasonPhrase,
+                                  const QString &redirectUrl, const QList<RawHeaderPair> &headers)
+{
+    if (statusCode != 0) {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, statusCode);
+        setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, reasonPhrase);
+    }
+    if (!redirectUrl.isEmpty())
+        setAttribute(QNetworkRequest::RedirectionTargetAttribute, QUrl(redirectUrl));
+
+    foreach (const RawHeaderPair &header, headers)
+        setRawHeader(header.first, header.second);
+}
+
+void RecordedReply::appendData(const QByteArray &data)
+{
+    if (data.isEmpty())
+        return;
+
+    m_data.append(data);
+    m_received += data.size();
+
+    emit readyRead();
+}
+
+void RecordedReply::finish(NetworkError code, const QString &errorString)
+{
+    if (m_done)
+        return;
+
+    m_done = true;
+    m_replayTimer.stop();
+
+    if (code != NoError) {
+        setError(code, errorString);
+        emit error(code);
+    }
+
+    setFinished(true);
+    emit readChannelFinished();
+    emit finished();
+}
+
+void RecordedReply::onSourceMetaDataChanged()
+{
+    if (m_entry.firstByteTime < 0)
+        m_entry.firstByteTime = m_requestTimer.elapsed();
+
+    m_entry.statusCode = m_source->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    m_entry.reasonPhrase = m_source->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toByteArray();
+    m_entry.redirectUrl = m_source->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl()
+                          .toString(QUrl::FullyEncoded);
+    m_entry.headers = m_source->rawHeaderPairs();
+
+    applyMetaData(m_entry.statusCode, m_entry.reasonPhrase, m_entry.redirectUrl, m_entry.headers);
+    emit metaDataChanged();
+}
+
+void RecordedReply::onSourceReadyRead()
+{
+    if (m_entry.firstByteTime < 0)
+        m_entry.firstByteTime = m_requestTimer.elapsed();
+
+    const QByteArray data = m_source->readAll();
+    m_entry.body.append(data);
+    appendData(data);
+}
+
+void RecordedReply::onSourceFinished()
+{
+    const QByteArray data = m_source->readAll();
+    m_entry.body.append(data);
+    appendData(data);
+
+    m_entry.duration = m_requestTimer.elapsed();
+    if (m_entry.firstByteTime < 0)
+        m_entry.firstByteTime = m_entry.duration;
+    m_entry.error = m_source->error();
+    m_entry.errorString = m_source->errorString();
+    m_recorder->writeEntry(m_entry);
+
+    const NetworkError error = m_source->error();
+    const QString errorString = m_source->errorString();
+    releaseSource();
+
+    finish(error, errorString);
+}
+
+// Plays back the meta data after the time to the first byte, then the body in chunks and
+// finishes after the recorded duration
+void RecordedReply::playNextStep()
+{
+    if (m_replayStep == 0) {
+        applyMetaData(m_entry.statusCode, m_entry.reasonPhrase, m_entry.redirectUrl, m_entry.headers);
+        emit metaDataChanged();
+    }
+    else if (m_replayStep <= m_replayChunks) {
+        const int chunkSize = (m_entry.body.size() + m_replayChunks - 1) / m_replayChunks;
+        appendData(m_entry.body.mid((m_replayStep - 1) * chunkSize, chunkSize));
+        emit downloadProgress(m_received, m_entry.body.size());
+    }
+    else {
+        finish(NetworkError(m_entry.error), m_entry.errorString);
+        return;
+    }
+
+    ++m_replayStep;
+
+    const qint64 transferTime = qMax(Q_INT64_C(0), m_entry.duration - m_entry.firstByteTime);
+    m_replayTimer.start(int(transferTime / (m_replayChunks + 1)));
+}
+
+void RecordedReply::releaseSource()
+{
+    if (!m_source)
+        return;
+
+    m_source->disconnect(this);
+    if (!m_source->isFinished())
+        m_source->abort();
+    m_source->deleteLater();
+    m_source = 0;
+}
+
+NetworkRecorder::Entry::Entry()
+    : startTime(0), firstByteTime(-1), duration(0), error(QNetworkReply::NoError), statusCode(0)
+{
+}
+
+NetworkRecorder::NetworkRecorder(Mode mode, const QString &archiveName, QObject *parent) :
+    QObject(parent), m_mode(mode), m_archiveName(archiveName)
+{
+    m_clock.start();
+
+    if (m_mode == RecordMode) {
+        FileIoWorker::instance()->write(m_archiveName, ARCHIVE_MAGIC);
+        qDebug() << "NetworkRecorder: Recording the network traffic to" << m_archiveName;
+    }
+    else if (load()) {
+        qDebug() << "NetworkRecorder: Replaying the network traffic from" << m_archiveName;
+    }
+}
+
+NetworkRecorder *NetworkRecorder::fromEnvironment(QObject *parent)
+{
+    const QString replayArchive = QFile::decodeName(qgetenv("GAGBOOK_NETWORK_REPLAY"));
+    if (!replayArchive.isEmpty())
+        return new NetworkRecorder(ReplayMode, replayArchive, parent);
+
+    const QString recordArchive = QFile::decodeName(qgetenv("GAGBOOK_NETWORK_RECORD"));
+    if (!recordArchive.isEmpty())
+        return new NetworkRecorder(RecordMode, recordArchive, parent);
+
+    return 0;
+}
+
+NetworkRecorder::Mode NetworkRecorder::mode() const
+{
+    return m_mode;
+}
+
+QNetworkReply *NetworkRecorder::record(QNetworkReply *reply)
+{
+    Q_ASSERT(m_mode == RecordMode);
+
+    RecordedReply *recordedReply = new RecordedReply(reply->request(), reply->operation(), this);
+    recordedReply->forward(reply, this);
+    return recordedReply;
+}
+
+QNetworkReply *NetworkRecorder::replay(const QNetworkRequest &request,
+                                       QNetworkAccessManager::Operation operation)
+{
+    Q_ASSERT(m_mode == ReplayMode);
+
+    const QByteArray operationStr = operationName(operation);
+    Entry entry;
+
+    if (!takeEntry(operationStr, request.url(), &entry)) {
+        qWarning("NetworkRecorder::replay(): No recorded response for %s %s", operationStr.constData(),
+                 qPrintable(request.url().toString()));
+        entry.error = QNetworkReply::ContentNotFoundError;
+        entry.errorString = "No recorded response";
+        entry.firstByteTime = 0;
+    }
+
+    RecordedReply *reply = new RecordedReply(request, operation, this);
+    reply->play(entry);
+    return reply;
+}
+
+qint64 NetworkRecorder::elapsed() const
+{
+    return m_clock.elapsed();
+}
+
+void NetworkRecorder::writeEntry(const Entry &entry)
+{
+    Q_ASSERT(m_mode == RecordMode);
+
+    QByteArray entryData;
+    QDataStream entryStream(&entryData, QIODevice::WriteOnly);
+    entryStream.setVersion(QDataStream::Qt_5_0);
+    entryStream << entry.operation << entry.url << entry.startTime << entry.firstByteTime
+                << entry.duration << qint32(entry.error) << entry.errorString << qint32(entry.statusCode)
+                << entry.reasonPhrase << entry.redirectUrl << entry.headers << entry.body;
+
+    // each entry is compressed on its own, so that the archive can be appended
+    QByteArray block;
+    QDataStream blockStream(&block, QIODevice::WriteOnly);
+    blockStream.setVersion(QDataStream::Qt_5_0);
+    blockStream << qCompress(entryData);
+
+    FileIoWorker::instance()->append(m_archiveName, block);
+}
+
+QByteArray NetworkRecorder::operationName(QNetworkAccessManager::Operation operation)
+{
+    switch (operation) {
+    case QNetworkAccessManager::HeadOperation: return "HEAD";
+    case QNetworkAccessManager::GetOperation: return "GET";
+    case QNetworkAccessManager::PutOperation: return "PUT";
+    case QNetworkAccessManager::PostOperation: return "POST";
+    case QNetworkAccessManager::DeleteOperation: return "DELETE";
+    default: return "CUSTOM";
+    }
+}
+
+bool NetworkRecorder::load()
+{
+    QFile file(m_archiveName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("NetworkRecorder::load(): Unable to open %s: %s", qPrintable(m_archiveName),
+                 qPrintable(file.errorString()));
+        return false;
+    }
+
+    if (file.read(ARCHIVE_MAGIC.size()) != ARCHIVE_MAGIC) {
+        qWarning("NetworkRecorder::load(): %s is not a network archive", qPrintable(m_archiveName));
+        return false;
+    }
+
+    QDataStream blockStream(&file);
+    blockStream.setVersion(QDataStream::Qt_5_0);
+    int count = 0;
+
+    while (!blockStream.atEnd()) {
+        QByteArray block;
+        blockStream >> block;
+
+        // the archive may be truncated if the recording app has been killed
+        if (blockStream.status() != QDataStream::Ok)
+            break;
+
+        const QByteArray entryData = qUncompress(block);
+        QDataStream entryStream(entryData);
+        entryStream.setVersion(QDataStream::Qt_5_0);
+
+        Entry entry;
+        qint32 error, statusCode;
+        entryStream >> entry.operation >> entry.url >> entry.startTime >> entry.firstByteTime
+                    >> entry.duration >> error >> entry.errorString >> statusCode
+                    >> entry.reasonPhrase >> entry.redirectUrl >> entry.headers >> entry.body;
+
+        if (entryStream.status() != QDataStream::Ok)
+            break;
+
+        entry.error = error;
+        entry.statusCode = statusCode;
+
+        const QUrl url(entry.url);
+        PathEntries &pathEntries = m_entries[entryKey(entry.operation, url)];
+        pathEntries.entries.append(entry);
+        pathEntries.served.append(false);
+        ++count;
+    }
+
+    qDebug() << "NetworkRecorder: Loaded" << count << "recorded responses";
+    return true;
+}
+
+// Takes the next recorded response for the URL, or for its path if the URL has not been
+// recorded, and marks it as served
+bool NetworkRecorder::takeEntry(const QByteArray &operation, const QUrl &url, Entry *entry)
+{
+    QHash<QString, PathEntries>::iterator it = m_entries.find(entryKey(operation, url));
+    if (it == m_entries.end())
+        return false;
+
+    int index = nextEntry(*it, url.toString(QUrl::FullyEncoded));
+    if (index < 0)
+        index = nextEntry(*it, QString());
+
+    if (index < 0)
+        return false;
+
+    it->served[index] = true;
+    *entry = it->entries.at(index);
+    return true;
+}
+
+// Returns the index of the first response with the URL (any if it is empty) which has not
+// been served, else the index of the last one to repeat it, or -1 if there is none
+int NetworkRecorder::nextEntry(const PathEntries &pathEntries, const QString &url)
+{
+    int last = -1;
+
+    for (int i = 0; i < pathEntries.entries.count(); ++i) {
+        if (!url.isEmpty() && pathEntries.entries.at(i).url != url)
+            continue;
+
+        if (!pathEntries.served.at(i))
+            return i;
+
+        last = i;
+    }
+
+    return last;
+}
+
+QString NetworkRecorder::entryKey(const QByteArray &operation, const QUrl &url)
+{
+    return QString::fromLatin1(operation) + ' ' + url.toString(QUrl::FullyEncoded | QUrl::RemoveQuery);
+}
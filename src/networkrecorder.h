@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NETWORKRECORDER_H
+#define NETWORKRECORDER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+
+/*! Capture and playback of the network traffic
+
+    In the record mode all responses of the requests of the NetworkManager (status,
+    headers, body and timing) are appended to an archive. In the replay mode the
+    responses are served from such an archive with their original timing instead of
+    sending the requests, so that a session can be reproduced without network access.
+    Requests are matched by their operation and URL. Repeated requests are answered
+    with the responses in the recorded order and the last one is repeated. If there is
+    no response with the exact URL, the next one with the same path is used. Each
+    response is served once before the last one is repeated, whether it has been
+    matched by its URL or by its path.
+
+    The modes are enabled by setting the environment variable GAGBOOK_NETWORK_RECORD or
+    GAGBOOK_NETWORK_REPLAY to the file name of the archive. The archive contains the
+    response headers (including cookies), request bodies are not recorded.
+ */
+class NetworkRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        RecordMode,
+        ReplayMode
+    };
+
+    /*! A recorded response. The times are in ms. */
+    struct Entry {
+        Entry();
+
+        QByteArray operation;
+        QString url;
+        qint64 startTime;       // since the recorder has been created
+        qint64 firstByteTime;   // since the start of the request
+        qint64 duration;
+        int error;
+        QString errorString;
+        int statusCode;
+        QByteArray reasonPhrase;
+        QString redirectUrl;
+        QList<QNetworkReply::RawHeaderPair> headers;
+        QByteArray body;
+    };
+
+    NetworkRecorder(Mode mode, const QString &archiveName, QObject *parent = 0);
+
+    /*! Create the recorder which is enabled by the environment, returns 0 if none is. */
+    static NetworkRecorder *fromEnvironment(QObject *parent = 0);
+
+    Mode mode() const;
+
+    /*! Record the response of \p reply. Returns the reply which must be used instead of
+        \p reply (record mode only). */
+    QNetworkReply *record(QNetworkReply *reply);
+
+    /*! Create a reply which serves the recorded response to \p request (replay mode only). */
+    QNetworkReply *replay(const QNetworkRequest &request, QNetworkAccessManager::Operation operation);
+
+    /*! Get the time in ms since the recorder has been created. */
+    qint64 elapsed() const;
+
+    /*! Append \p entry to the archive (record mode only). */
+    void writeEntry(const Entry &entry);
+
+    static QByteArray operationName(QNetworkAccessManager::Operation operation);
+
+private:
+    // the recorded responses of a path in the recorded order and which of them have
+    // been served
+    struct PathEntries {
+        QList<Entry> entries;
+        QVector<bool> served;
+    };
+
+    bool load();
+    bool takeEntry(const QByteArray &operation, const QUrl &url, Entry *entry);
+    static int nextEntry(const PathEntries &pathEntries, const QString &url);
+    static QString entryKey(const QByteArray &operation, const QUrl &url);
+
+    Mode m_mode;
+    QString m_archiveName;
+    QElapsedTimer m_clock;
+    QHash<QString, PathEntries> m_entries;  // by operation and URL without query
+};
+
+#endif // NETWORKRECORDER_H
@@ -30,6 +30,7 @@
 #include <QDateTime>
 #include <QUrlQuery>
 #include <QUuid>
+#include <QElapsedTimer>
 
 //#include <QJsonParseError>
 #include <QJsonDocument>
@@ -39,6 +40,8 @@
 #include <QDebug>
 
 #include "ninegagapiclient.h"
+#include "metricsregistry.h"
+#include "tracing.h"
 
 /*!
     \class NineGagApiClient
@@ -70,6 +73,20 @@ const QByteArray DEVICE_TYPE = "android";
 const QByteArray BUCKET_NAME = "MAIN_RELEASE";   // "__DEFAULT__";
 const QByteArray COMMENT_ID_CDN = "a_dd8f2b7d304a10edaf6f29517ea0ca4100a43d1b";
 
+// Returns the base URL from the environment variable (e.g. to run against a local test server)
+static QByteArray baseUrl(const char *envVarName, const QByteArray &defaultUrl)
+{
+    const QByteArray url = qgetenv(envVarName);
+
+    if (url.isEmpty())
+        return defaultUrl;
+
+    qDebug() << "NineGagApiClient: Using" << url << "from" << envVarName;
+
+    // the paths are appended to the base URL
+    return url.endsWith('/') ? url.left(url.size() - 1) : url;
+}
+
 /*!
  * \brief NineGagApiClient::NineGagApiClient Constructor.
  * \param netMan Pointer to the global NetworkManager instance.
@@ -77,9 +94,51 @@ const QByteArray COMMENT_ID_CDN = "a_dd8f2b7d304a10edaf6f29517ea0ca4100a43d1b";
  */
 NineGagApiClient::NineGagApiClient(NetworkManager *netMan, QObject *parent) :
     QObject(parent), m_netMan(netMan), m_appToken(createSHA1()), m_deviceUUID(createUUID()),
-    m_loginReply(0), m_tokenExpiry(0), m_isGuestSession(true)
+    m_loginReply(0), m_tokenExpiry(0), m_isGuestSession(true),
+    m_apiUrl(baseUrl("GAGBOOK_API_URL", API_URL)),
+    m_commentCdnUrl(baseUrl("GAGBOOK_COMMENT_CDN_URL", COMMENT_URL_CDN))
+{
+
+}
+
+/*!
+ * \brief NineGagApiClient::apiUrl Getter for the base URL of the API server.
+ * \return Returns the base URL, by default 'https://api.9gag.com'.
+ */
+QByteArray NineGagApiClient::apiUrl() const
+{
+    return m_apiUrl;
+}
+
+/*!
+ * \brief NineGagApiClient::setApiUrl Sets the base URL of the API server to which the posts, login
+ *  and sections requests are sent. The initial value can also be set with the environment
+ *  variable 'GAGBOOK_API_URL'.
+ * \param apiUrl The base URL without a trailing '/', e.g. 'http://localhost:8080'.
+ */
+void NineGagApiClient::setApiUrl(const QByteArray &apiUrl)
 {
+    m_apiUrl = apiUrl;
+}
 
+/*!
+ * \brief NineGagApiClient::commentCdnUrl Getter for the base URL of the comments server.
+ * \return Returns the base URL, by default 'https://comment-cdn.9gag.com'.
+ */
+QByteArray NineGagApiClient::commentCdnUrl() const
+{
+    return m_commentCdnUrl;
+}
+
+/*!
+ * \brief NineGagApiClient::setCommentCdnUrl Sets the base URL of the server to which the comments
+ *  requests are sent. The initial value can also be set with the environment variable
+ *  'GAGBOOK_COMMENT_CDN_URL'.
+ * \param commentCdnUrl The base URL without a trailing '/'.
+ */
+void NineGagApiClient::setCommentCdnUrl(const QByteArray &commentCdnUrl)
+{
+    m_commentCdnUrl = commentCdnUrl;
 }
 
 /*!
@@ -157,6 +216,8 @@ QNetworkReply *NineGagApiClient::request(QNetworkRequest netReq)
  */
 QNetworkReply *NineGagApiClient::request(const QUrl &url, bool sign)
 {
+    GAGBOOK_TRACE_SCOPE("NineGagApiClient::request");
+
     QNetworkRequest netReq;
 
     netReq.setUrl(url);
@@ -182,7 +243,18 @@ QNetworkReply *NineGagApiClient::request(const QUrl &url, bool sign)
     // this attribute was introduced with Qt 5.6 and Sailfish OS 2.1.0.x
     //netReq.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
 
-    return this->request(netReq);
+    QNetworkReply *reply = this->request(netReq);
+    GAGBOOK_TRACE_REPLY(reply, "API request");
+
+    QElapsedTimer latencyTimer;
+    latencyTimer.start();
+    connect(reply, &QNetworkReply::finished, [reply, latencyTimer]() {
+        MetricsRegistry *metrics = MetricsRegistry::instance();
+        metrics->increment(reply->error() == QNetworkReply::NoError ? "api.requests" : "api.errors");
+        metrics->addSample("api.latencyMs", latencyTimer.elapsed());
+    });
+
+    return reply;
 }
 
 /*!
@@ -194,7 +266,7 @@ void NineGagApiClient::guestLogin()
         m_isGuestSession = true;
     }
 
-    QUrl url(API_URL + GUEST_PATH);
+    QUrl url(m_apiUrl + GUEST_PATH);
 
     Q_ASSERT(m_loginReply == 0);
 
@@ -214,7 +286,7 @@ void NineGagApiClient::userLogin(const QString &username, const QString &passwor
         m_isGuestSession = false;
     }
 
-    QUrl url(API_URL + LOGIN_PATH);
+    QUrl url(m_apiUrl + LOGIN_PATH);
     QUrlQuery query;
 
     query.addQueryItem("loginMethod", "9gag");  // TODO: "email"?
@@ -298,7 +370,7 @@ bool NineGagApiClient::isGuestSession()
  */
 QNetworkReply *NineGagApiClient::getPosts(const int groupId, const QString &section, const QString &lastId)
 {
-    QUrl url(API_URL + POSTS_PATH);
+    QUrl url(m_apiUrl + POSTS_PATH);
     QUrlQuery query;
 
     // set query arguments
@@ -343,13 +415,16 @@ QNetworkReply *NineGagApiClient::getPosts(const int groupId, const QString &sect
  *  not by the elapsed time!
  * \param sortDirection
  * \param auth
+ * \param priority The priority of the network request, e.g. QNetworkRequest::LowPriority for
+ *  requests which are not directly triggered by the user.
  * \return Returns the retrieved comment data.
  */
 QNetworkReply *NineGagApiClient::getComments(const QUrl &gagUrl, const int count, const int level,
                                              QString refComment, SortOrder sortOrder,
-                                             SortDirection sortDirection, const QString &auth)
+                                             SortDirection sortDirection, const QString &auth,
+                                             QNetworkRequest::Priority priority)
 {
-    QUrl reqUrl(COMMENT_URL_CDN + COMMENT_PATH_CDN);
+    QUrl reqUrl(m_commentCdnUrl + COMMENT_PATH_CDN);
     QUrlQuery query;
 
     query.addQueryItem("appId", COMMENT_ID_CDN);
@@ -399,6 +474,7 @@ QNetworkReply *NineGagApiClient::getComments(const QUrl &gagUrl, const int count
 
     QNetworkRequest netReq;
     netReq.setUrl(reqUrl);
+    netReq.setPriority(priority);
     netReq.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     netReq.setRawHeader("appId", COMMENT_ID_CDN);
     // User-Agent
@@ -414,7 +490,7 @@ QNetworkReply *NineGagApiClient::getComments(const QUrl &gagUrl, const int count
 // TODO
 QNetworkReply *NineGagApiClient::retrieveSections()
 {
-    QUrl url(API_URL + SECTIONS_PATH);
+    QUrl url(m_apiUrl + SECTIONS_PATH);
     QUrlQuery query;
 
     query.addQueryItem("entryTypes", "animated,photo,video,article");
@@ -29,6 +29,7 @@
 #define NINEGAGAPICLIENT_H
 
 #include <QObject>
+#include <QNetworkRequest>
 
 #include "networkmanager.h"
 
@@ -54,9 +55,15 @@ public:
     QNetworkReply *getPosts(const int groupId, const QString &section, const QString &lastId);
     QNetworkReply *getComments(const QUrl &gagUrl, const int count, const int level, QString refComment,
                                SortOrder sortOrder, SortDirection sortDirection,
-                               const QString &auth = QString());
+                               const QString &auth = QString(),
+                               QNetworkRequest::Priority priority = QNetworkRequest::NormalPriority);
     QNetworkReply *retrieveSections();
 
+    QByteArray apiUrl() const;
+    void setApiUrl(const QByteArray &apiUrl);
+    QByteArray commentCdnUrl() const;
+    void setCommentCdnUrl(const QByteArray &commentCdnUrl);
+
 signals:
     void loggedIn();
 
@@ -81,6 +88,8 @@ private:
     QNetworkReply *m_loginReply;
     quint32 m_tokenExpiry;
     bool m_isGuestSession;
+    QByteArray m_apiUrl;
+    QByteArray m_commentCdnUrl;
 };
 
 #endif // NINEGAGAPICLIENT_H
@@ -27,6 +27,10 @@
 
 #include "ninegagapirequest.h"
 #include "commentmodel.h"   // for 'Sorting' enum
+#include "allocprofiler.h"
+#include "metricsregistry.h"
+#include "startupprofiler.h"
+#include "tracing.h"
 
 //#include <QJsonParseError>
 #include <QTextDocument>
@@ -37,6 +41,42 @@
 #include <QDateTime>
 #include <QDebug>
 
+// Returns true if QTextDocument would return the text unchanged, i.e. if it contains neither
+// markup, entities nor whitespace which is collapsed by the HTML parser
+static bool isPlainText(const QString &text)
+{
+    const int length = text.length();
+    const QChar *data = text.constData();
+    bool previousIsSpace = true;    // leading whitespace is removed
+
+    for (int i = 0; i < length; ++i) {
+        const QChar c = data[i];
+
+        if (c == QLatin1Char('<') || c == QLatin1Char('&'))
+            return false;
+
+        const bool isSpace = c.isSpace();
+        if (isSpace && (previousIsSpace || c != QLatin1Char(' ')))
+            return false;
+
+        previousIsSpace = isSpace;
+    }
+
+    return length == 0 || !previousIsSpace;
+}
+
+// Converts the included entity numbers, smilies etc. to plain text. Most texts don't contain any,
+// so the expensive QTextDocument is only created if needed.
+static QString htmlToPlainText(const QString &html)
+{
+    if (isPlainText(html))
+        return html;
+
+    QTextDocument textDoc;
+    textDoc.setHtml(html); // TODO this removes line breaks
+    return textDoc.toPlainText();
+}
+
 /*!
     \class NineGagApiRequest
     \since 1.3.0
@@ -84,6 +124,7 @@ void NineGagApiRequest::startGagsRequest()
 
         // check if a re-login is required
         if (m_apiClient->sessionIsValid()) {
+            StartupProfiler::mark("login done");
             emit readyToRequestGags();
         }
         else {
@@ -123,11 +164,14 @@ QNetworkReply *NineGagApiRequest::fetchGagsImpl(const int groupId, const QString
  */
 QList<GagObject> NineGagApiRequest::parseGags(const QByteArray &response)
 {
+    GAGBOOK_TRACE_SCOPE("NineGagApiRequest::parseGags");
+    MetricsTimer parseTimer("parse.postsMs");
+    GAGBOOK_ALLOC_SCOPE("parseGags");
+
     QJsonObject rootObj = QJsonDocument::fromJson(response).object();
-    QJsonArray postsArr = rootObj.value("data").toObject().value("posts").toArray();
-    const QVariantList postsList = postsArr.toVariantList();
+    const QJsonArray postsArr = rootObj.value("data").toObject().value("posts").toArray();
 
-    if (postsList.isEmpty()) {
+    if (postsArr.isEmpty()) {
         qWarning("Empty JSON API response!");
         qDebug() << "### API response is: ###\n" << response;
 
@@ -141,23 +185,26 @@ QList<GagObject> NineGagApiRequest::parseGags(const QByteArray &response)
     }
 
     QList<GagObject> gagList;
+    gagList.reserve(postsArr.count());
+
+    // the renditions are selected for the whole page
+    const MediaQualityPolicy qualityPolicy = mediaQualityPolicy();
 
-    foreach (const QVariant &gagJson, postsList) {
-        const QVariantMap gagMap = gagJson.toMap();
+    // the JSON objects are read directly, converting the page to a QVariantList would copy
+    // every post (see parseChildComments())
+    foreach (const QJsonValue &gagJson, postsArr) {
+        const QJsonObject gagObj = gagJson.toObject();
 
         GagObject gag;
-        gag.setId(gagMap.value("id").toString());
-        gag.setUrl(gagMap.value("url").toUrl());
+        gag.setId(gagObj.value("id").toString());
+        gag.setUrl(QUrl(gagObj.value("url").toString()));
 
         // title: convert included entity numbers
-        QString titleStr = gagMap.value("title").toString();
-        QTextDocument textDoc;
-        textDoc.setHtml(titleStr);
-        gag.setTitle(textDoc.toPlainText());
+        gag.setTitle(htmlToPlainText(gagObj.value("title").toString()));
 
-        gag.setVotesCount(gagMap.value("totalVoteCount").toInt());
-        gag.setCommentsCount(gagMap.value("commentsCount").toInt());
-        bool nsfw = gagMap.value("nsfw").toBool();
+        gag.setVotesCount(gagObj.value("totalVoteCount").toInt());
+        gag.setCommentsCount(gagObj.value("commentsCount").toInt());
+        bool nsfw = gagObj.value("nsfw").toVariant().toBool();    // 0 or 1
 
         // ToDo: disabled until user login is fully implemented
         if (nsfw) {
@@ -169,23 +216,25 @@ QList<GagObject> NineGagApiRequest::parseGags(const QByteArray &response)
             //qDebug() << "Following Gag is a NSFW gag: " << gag.title();
         }
 
-        QString gagType = gagMap.value("type").toString();
-        QVariantMap imagesMap = gagMap.value("images").toMap();
+        const QString gagType = gagObj.value("type").toString();
+        const QJsonObject imagesObj = gagObj.value("images").toObject();
 
-        // ToDo: set 'imageSize' for each gag
+        // the size of the image is known before it has been downloaded (except for long images),
+        // so that the layout of the list doesn't change when the images are loaded lazily
 
         if (gagType == QString("Photo")) {
-            bool longPost = gagMap.value("hasLongPostCover").toBool();
+            bool longPost = gagObj.value("hasLongPostCover").toVariant().toBool();    // 0 or 1
 
             // Image
             if (!longPost) {
-                gag.setImageUrl(imagesMap.value("image700").toMap().value("url").toUrl());
+                gag.setImageUrl(qualityPolicy.imageUrl(imagesObj));
+                gag.setImageSize(qualityPolicy.imageSize(imagesObj));
             }
             // Long image
             else {
                 gag.setIsPartialImage(true);
-                gag.setImageUrl(imagesMap.value("image460c").toMap().value("url").toUrl());
-                gag.setFullImageUrl(imagesMap.value("image700").toMap().value("url").toUrl());
+                gag.setImageUrl(QUrl(imagesObj.value("image460c").toObject().value("url").toString()));
+                gag.setFullImageUrl(QUrl(imagesObj.value("image700").toObject().value("url").toString()));
 
                 //qDebug() << "Following Gag is a long image: " << gag.title();
             }
@@ -194,8 +243,9 @@ QList<GagObject> NineGagApiRequest::parseGags(const QByteArray &response)
 
             // GIFs are only available as a video source
             gag.setIsVideo(true);
-            gag.setImageUrl(imagesMap.value("image700").toMap().value("url").toUrl());
-            gag.setVideoUrl(imagesMap.value("image460sv").toMap().value("url").toUrl());
+            gag.setImageUrl(qualityPolicy.imageUrl(imagesObj));
+            gag.setImageSize(qualityPolicy.imageSize(imagesObj));
+            gag.setVideoUrl(qualityPolicy.videoUrl(imagesObj));
 
             /*
             int duration = imagesMap.value("image460sv").toMap().value("duration").toInt();
@@ -223,7 +273,7 @@ QList<GagObject> NineGagApiRequest::parseGags(const QByteArray &response)
             /* An Album consists of multiple separate gags with its own id, all specified
              * in the 'article' json object */
 
-            gag.setImageUrl(imagesMap.value("image700").toMap().value("url").toUrl());
+            gag.setImageUrl(QUrl(imagesObj.value("image700").toObject().value("url").toString()));
             qDebug() << "Found an unsupported 'Album' Gag: " << gag.title();
 
             // ToDo: extend the model to support albums
@@ -248,12 +298,17 @@ QList<GagObject> NineGagApiRequest::parseGags(const QByteArray &response)
  *  to contain the following data in the given order:
  *  data = {'URL of the post', 'count of comments to fetch', 'depth level',
  *  'reference comment for pagination', 'sorting value', 'auth string'}
+ *  Optionally a QNetworkRequest::Priority can be appended as seventh value.
  *  \sa NineGagApiClient
  * \return Returns the QNetworkReply object of the request.
  */
 QNetworkReply *NineGagApiRequest::fetchCommentsImpl(const QVariantList &data)
 {
-    Q_ASSERT(data.count() == 6);
+    Q_ASSERT((data.count() == 6) || (data.count() == 7));
+
+    QNetworkRequest::Priority priority = QNetworkRequest::NormalPriority;
+    if (data.count() == 7)
+        priority = static_cast<QNetworkRequest::Priority>(data.at(6).toInt());
 
     CommentModel::Sorting sorting = data.at(4).value<CommentModel::Sorting>();
     NineGagApiClient::SortOrder sortOrder;
@@ -281,7 +336,8 @@ QNetworkReply *NineGagApiRequest::fetchCommentsImpl(const QVariantList &data)
                 data.at(3).toString(),      // refComment
                 sortOrder,                  // sortOrder
                 sortDirection,              // sortDirection
-                data.at(5).toString());     // auth
+                data.at(5).toString(),      // auth
+                priority);                  // priority
 }
 
 /*!
@@ -289,11 +345,16 @@ QNetworkReply *NineGagApiRequest::fetchCommentsImpl(const QVariantList &data)
  *  to a list of comments.
  * \param response The response of the network request.
  * \param parentComment The parent comment for which the comments has been fetched.
+ * \param arena The CommentArena in which the comments are allocated (can be 0).
  * \return Returns a list of CommentObject pointers.
  */
 QList<CommentObject *> NineGagApiRequest::parseComments(const QByteArray &response,
-                                                        CommentObject *parentComment)
+                                                        CommentObject *parentComment,
+                                                        CommentArena *arena)
 {
+    MetricsTimer parseTimer("parse.commentsMs");
+    GAGBOOK_ALLOC_SCOPE("parseComments");
+
     QJsonObject rootObj = QJsonDocument::fromJson(response).object();
     QJsonObject payloadObj = rootObj.value("payload").toObject();
     QJsonArray commentsArr = payloadObj.value("comments").toArray();
@@ -311,7 +372,7 @@ QList<CommentObject *> NineGagApiRequest::parseComments(const QByteArray &respon
         parentComment->setUser(UserObject(payloadObj.value("opUserId").toString()));
     }
 
-    return parseChildComments(commentsArr, parentComment);
+    return parseChildComments(commentsArr, parentComment, arena);
 }
 
 /*!
@@ -320,6 +381,7 @@ QList<CommentObject *> NineGagApiRequest::parseComments(const QByteArray &respon
 void NineGagApiRequest::onLogin()
 {
     m_loginOngoing = false;
+    StartupProfiler::mark("login done");
     emit readyToRequestGags();
 }
 
@@ -328,30 +390,32 @@ void NineGagApiRequest::onLogin()
  *  comments for a parent comment.
  * \param jsonCommentsArray The QJsonArray containing the child comments of the parent.
  * \param parentComment The pointer to the parent comment.
+ * \param arena The CommentArena in which the comments are allocated. If it is 0, the comments
+ *  are allocated on the heap.
  * \return Returns a list of CommentObject pointers.
  */
 QList<CommentObject *> NineGagApiRequest::parseChildComments(const QJsonArray &jsonCommentsArray,
-                                                             CommentObject *parentComment)
+                                                             CommentObject *parentComment,
+                                                             CommentArena *arena)
 {
-    const QVariantList variantList = jsonCommentsArray.toVariantList();
     QList<CommentObject *> commentsList;
+    commentsList.reserve(jsonCommentsArray.count());
 
-    foreach (const QVariant &commentJson, variantList) {
+    // the JSON objects are read directly, converting them to QVariantMaps would copy the whole
+    // subtree (including all the replies) on every level
+    foreach (const QJsonValue &commentJson, jsonCommentsArray) {
 
-        const QVariantMap commentMap = commentJson.toMap();
-        CommentObject *comment = new CommentObject(parentComment);
+        const QJsonObject commentObj = commentJson.toObject();
+        CommentObject *comment = arena ? arena->create(parentComment) : new CommentObject(parentComment);
 
         // commentId
-        comment->setId(commentMap.value("commentId").toString());
+        comment->setId(commentObj.value("commentId").toString());
 
         // text: convert included entity numbers, smilies etc.
-        QString tmpStr = commentMap.value("mediaText").toString();
-        QTextDocument tmpTextDoc;
-        tmpTextDoc.setHtml(tmpStr); // TODO this removes line breaks
-        comment->setText(tmpTextDoc.toPlainText());
+        comment->setText(htmlToPlainText(commentObj.value("mediaText").toString()));
 
         // type of text
-        QString type = commentMap.value("type").toString();
+        const QString type = commentObj.value("type").toString();
         if (type == QString("text"))
             comment->setTextType(ContentType::Text);
         else if (type == QString("userMedia"))
@@ -374,7 +438,7 @@ QList<CommentObject *> NineGagApiRequest::parseChildComments(const QJsonArray &j
             ContentType mediaType = comment->textType();
 
             if (mediaType == ContentType::UserMedia) {
-                const QJsonArray mediaArr = QJsonValue::fromVariant(commentJson).toObject().value("media").toArray();
+                const QJsonArray mediaArr = commentObj.value("media").toArray();
 
                 if (mediaArr.count() > 1)
                     qWarning("NineGagApiRequest::parseCommentMedia(): Unexpectedly the JSON contains several media objects!");
@@ -383,38 +447,33 @@ QList<CommentObject *> NineGagApiRequest::parseChildComments(const QJsonArray &j
                     comment->setMedia(parseCommentMedia(mediaArr.first().toObject(), mediaType));
             }
             else if (mediaType == ContentType::Media) {
-                comment->setMedia(parseCommentMedia(QJsonValue::fromVariant(commentJson).toObject().value(
-                                                        "embedMediaMeta").toObject(), mediaType));
+                comment->setMedia(parseCommentMedia(commentObj.value("embedMediaMeta").toObject(), mediaType));
             }
             else
                 qWarning("NineGagApiRequest::parseChildComments(): An unsupported ContentType value is being used!");
         }
 
         // timestamp
-        comment->setTimestamp(QDateTime::fromMSecsSinceEpoch(commentMap.value("timestamp").toLongLong() * (qint64) 1000));
+        comment->setTimestamp(QDateTime::fromMSecsSinceEpoch(commentObj.value("timestamp").toVariant().toLongLong() * (qint64) 1000));
 
         // permalink
-        comment->setPermalink(commentMap.value("permalink").toUrl());
+        comment->setPermalink(commentObj.value("permalink").toVariant().toUrl());
 
         // orderKey (field is only available for top-level comments) | TODO or is 0 for fetched secondLvlComments
-        comment->setOrderKey(commentMap.value("orderKey").toString());
+        comment->setOrderKey(commentObj.value("orderKey").toVariant().toString());
 
         // user
-        const QJsonObject jsonUser = QJsonValue::fromVariant(commentJson).toObject().value("user").toObject();
-        comment->setUser(parseUser(jsonUser));
+        comment->setUser(parseUser(commentObj.value("user").toObject()));
 
         // upvotes
-        comment->setUpvotes(commentMap.value("likeCount").toInt());
+        comment->setUpvotes(commentObj.value("likeCount").toVariant().toInt());
 
         // child count
-        comment->setTotalChildCount(commentMap.value("childrenTotal").toInt());
+        comment->setTotalChildCount(commentObj.value("childrenTotal").toVariant().toInt());
 
         // parse child comments
         if (comment->totalChildCount() > 0) {
-            const QJsonArray childComments = QJsonValue::fromVariant(
-                        commentJson).toObject().value("children").toArray();
-
-            comment->appendChildren(parseChildComments(childComments, comment));
+            comment->appendChildren(parseChildComments(commentObj.value("children").toArray(), comment, arena));
         }
 
         commentsList.append(comment);
@@ -474,11 +533,8 @@ UserObject NineGagApiRequest::parseUser(const QJsonObject &jsonUser)
     userObj.setAvatarUrl(jsonUser.value("avatarUrl").toVariant().toUrl());
     const QString emojiStr = jsonUser.value("emojiStatus").toString();
 
-    if (!emojiStr.isEmpty()) {
-        QTextDocument textDoc;
-        textDoc.setHtml(emojiStr);
-        userObj.setEmojiStatus(textDoc.toPlainText());
-    }
+    if (!emojiStr.isEmpty())
+        userObj.setEmojiStatus(htmlToPlainText(emojiStr));
 
     const QJsonObject userPermission = jsonUser.value("permissions").toObject();
 
@@ -48,7 +48,8 @@ protected:
     QNetworkReply *fetchGagsImpl(const int groupId, const QString &section, const QString &lastId);
     QList<GagObject> parseGags(const QByteArray &response);
     QNetworkReply *fetchCommentsImpl(const QVariantList &data);
-    QList<CommentObject *> parseComments(const QByteArray &response, CommentObject *parentComment);
+    QList<CommentObject *> parseComments(const QByteArray &response, CommentObject *parentComment,
+                                         CommentArena *arena);
 
 private slots:
     void onLogin();
@@ -58,7 +59,7 @@ private:
     bool m_loginOngoing;
 
     QList<CommentObject *> parseChildComments(const QJsonArray &jsonCommentsArray,
-                                              CommentObject *parentComment);
+                                              CommentObject *parentComment, CommentArena *arena);
     CommentMediaObject parseCommentMedia(const QJsonObject &jsonMedia, ContentType mediaType);
     UserObject parseUser(const QJsonObject &jsonUser);
 };
@@ -28,13 +28,15 @@
 
 #include "qmlutils.h"
 
-#include <QImage>
+#include <QtQml/QQmlEngine>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtGui/QClipboard>
 #include <QtCore/QStandardPaths>
 #include <QtGui/QGuiApplication>
 
+#include "jankmonitor.h"
+
 QMLUtils::QMLUtils(QObject *parent) :
     QObject(parent)
 {
@@ -64,10 +66,42 @@ void QMLUtils::copyToClipboard(const QString &text)
 
 QString QMLUtils::saveImage(const QUrl &imageUrl, bool isLongImage)
 {
+    JankMonitor::Task guiTask("QMLUtils::saveImage");
+
     // if the url is not a local file, return
     if (!imageUrl.isLocalFile())
         return QString("");
 
+    const QString copyPath = savePathForImage(imageUrl);
+
+    // scale the long image to a supported height so that the gallery is able to open/render it without downscaling
+    // Note: this may take a few seconds on very long images (e.g. height > 10000), use saveImageAsync() instead
+    bool success = ImageSaveJob::saveImage(imageUrl.toLocalFile(), copyPath,
+                                           isLongImage ? QSize(0, imageMaxHeight()) : QSize());
+
+    // use QUrl to get the 'file://' scheme so that it can be opened using Qt.openUrlExternally() in QML
+    return ((success || QFile::exists(copyPath)) ? QUrl::fromLocalFile(copyPath).toString() : QString(""));
+}
+
+ImageSaveJob *QMLUtils::saveImageAsync(const QUrl &imageUrl, bool isLongImage)
+{
+    if (!imageUrl.isLocalFile())
+        return 0;
+
+    // the job is not parented to QMLUtils, which may be destroyed before the thread pool has run the job
+    ImageSaveJob *job = new ImageSaveJob(imageUrl.toLocalFile(), savePathForImage(imageUrl),
+                                         isLongImage ? QSize(0, imageMaxHeight()) : QSize());
+
+    // the job deletes itself when finished, so it must not be garbage collected by QML
+    QQmlEngine::setObjectOwnership(job, QQmlEngine::CppOwnership);
+    job->start();
+
+    return job;
+}
+
+// Returns the path in the image saving directory for the given local file
+QString QMLUtils::savePathForImage(const QUrl &imageUrl)
+{
     // create the image saving directory if not existent
     QDir fileSavingDir(QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) + "/GagBook");
 
@@ -75,30 +109,8 @@ QString QMLUtils::saveImage(const QUrl &imageUrl, bool isLongImage)
         fileSavingDir.mkpath(".");
 
     const QString imagePath = imageUrl.toLocalFile();
-    const QString copyPath = fileSavingDir.absoluteFilePath(imagePath.mid(imagePath.lastIndexOf("/") + 1));
-    bool success;
-
-    if (isLongImage) {
-        // scale the long image to a supported height so that the gallery is able to open/render it without downscaling
-        QImage longImg(imagePath);
-        if (!longImg.isNull()) {
-            if (longImg.height() > imageMaxHeight()) {
-                // using 'SmoothTransformation' may take a few seconds on very long images (e.g. height > 10000)
-                QImage scaledImg(longImg.scaledToHeight(imageMaxHeight(), Qt::SmoothTransformation));
-                success = scaledImg.save(copyPath);
-            }
-            else
-                success = QFile::copy(imagePath, copyPath);
-        }
-        else
-            success = false;
-    }
-    else {
-        success = QFile::copy(imagePath, copyPath);
-    }
 
-    // use QUrl to get the 'file://' scheme so that it can be opened using Qt.openUrlExternally() in QML
-    return ((success || QFile::exists(copyPath)) ? QUrl::fromLocalFile(copyPath).toString() : QString(""));
+    return fileSavingDir.absoluteFilePath(imagePath.mid(imagePath.lastIndexOf("/") + 1));
 }
 
 bool QMLUtils::fileExists(const QUrl &url)
@@ -33,6 +33,8 @@
 #include <QtCore/QVariant>
 #include <QtCore/QUrl>
 
+#include "imagesavejob.h"
+
 /*! Utilities functions for QML
 
     Collection of utilities functions and constant properties for use by QML
@@ -58,6 +60,12 @@ public:
       long image so that it will be scaled down to a supported size. */
     Q_INVOKABLE QString saveImage(const QUrl &imageUrl, bool isLongImage = false);
 
+    /*! Same as saveImage() but the file is saved in a worker thread (or copied by the
+      FileIoWorker), so the GUI thread is not blocked. Returns the job
+      which reports the progress and emits ImageSaveJob::finished() with the URL of the
+      saved file. Returns null if \p imageUrl is not a local file. */
+    Q_INVOKABLE ImageSaveJob *saveImageAsync(const QUrl &imageUrl, bool isLongImage = false);
+
     /*! Checks if the file with the given \param url exists.
      * \return Returns true if the file exists. */
     Q_INVOKABLE bool fileExists(const QUrl &url);
@@ -70,6 +78,8 @@ public:
 
 private:
     Q_DISABLE_COPY(QMLUtils)
+
+    QString savePathForImage(const QUrl &imageUrl);
 };
 
 #endif // QMLUTILS_H
@@ -0,0 +1,82 @@
+# The sources of the app without the Sailfish specific parts (sailfishapp, libresourceqt),
+# which are shared by the app (sailfish/) and the benchmarks (tests/)
+
+QT += core gui qml quick network multimedia
+
+# qmake CONFIG+=tracing records trace spans of the hot paths, see tracing.h
+tracing: DEFINES += GAGBOOK_TRACING
+
+# qmake CONFIG+=allocprofile counts the allocations of the hot paths, see allocprofiler.h
+allocprofile: DEFINES += GAGBOOK_ALLOC_PROFILE
+
+INCLUDEPATH += $$PWD/..
+
+HEADERS += \
+    $$PWD/qmlutils.h \
+    $$PWD/appsettings.h \
+    $$PWD/gagbookmanager.h \
+    $$PWD/gagmodel.h \
+    $$PWD/gagobject.h \
+    $$PWD/gagrequest.h \
+    $$PWD/networkmanager.h \
+    $$PWD/gagimagedownloader.h \
+    $$PWD/gagcookiejar.h \
+    $$PWD/votingmanager.h \
+    $$PWD/ninegagapiclient.h \
+    $$PWD/ninegagapirequest.h \
+    $$PWD/sectionmodel.h \
+    $$PWD/commentmodel.h \
+    $$PWD/commentobject.h \
+    $$PWD/commentmediaobject.h \
+    $$PWD/userobject.h \
+    $$PWD/networkaccessmanagerfactory.h \
+    $$PWD/commentcache.h \
+    $$PWD/commentprefetcher.h \
+    $$PWD/imagesavejob.h \
+    $$PWD/imagescaler.h \
+    $$PWD/gagimageprovider.h \
+    $$PWD/mappedfile.h \
+    $$PWD/fileioworker.h \
+    $$PWD/videoposterextractor.h \
+    $$PWD/mediaqualitypolicy.h \
+    $$PWD/tracing.h \
+    $$PWD/metricsregistry.h \
+    $$PWD/jankmonitor.h \
+    $$PWD/startupprofiler.h \
+    $$PWD/networkrecorder.h \
+    $$PWD/allocprofiler.h
+
+SOURCES += \
+    $$PWD/qmlutils.cpp \
+    $$PWD/appsettings.cpp \
+    $$PWD/gagbookmanager.cpp \
+    $$PWD/gagmodel.cpp \
+    $$PWD/gagobject.cpp \
+    $$PWD/gagrequest.cpp \
+    $$PWD/networkmanager.cpp \
+    $$PWD/gagimagedownloader.cpp \
+    $$PWD/gagcookiejar.cpp \
+    $$PWD/votingmanager.cpp \
+    $$PWD/ninegagapiclient.cpp \
+    $$PWD/ninegagapirequest.cpp \
+    $$PWD/sectionmodel.cpp \
+    $$PWD/commentmodel.cpp \
+    $$PWD/commentobject.cpp \
+    $$PWD/commentmediaobject.cpp \
+    $$PWD/userobject.cpp \
+    $$PWD/networkaccessmanagerfactory.cpp \
+    $$PWD/commentcache.cpp \
+    $$PWD/commentprefetcher.cpp \
+    $$PWD/imagesavejob.cpp \
+    $$PWD/imagescaler.cpp \
+    $$PWD/gagimageprovider.cpp \
+    $$PWD/mappedfile.cpp \
+    $$PWD/fileioworker.cpp \
+    $$PWD/videoposterextractor.cpp \
+    $$PWD/mediaqualitypolicy.cpp \
+    $$PWD/tracing.cpp \
+    $$PWD/metricsregistry.cpp \
+    $$PWD/jankmonitor.cpp \
+    $$PWD/startupprofiler.cpp \
+    $$PWD/networkrecorder.cpp \
+    $$PWD/allocprofiler.cpp
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "startupprofiler.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QDebug>
+#include <QtQuick/QQuickWindow>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "metricsregistry.h"
+
+// the milestones which complete the timeline
+static const char *const MILESTONES[] = {
+    "main", "QML engine ready", "first frame", "login done", "first post list", "first image decoded"
+};
+static const int MILESTONE_COUNT = sizeof(MILESTONES) / sizeof(MILESTONES[0]);
+
+StartupProfiler *StartupProfiler::m_instance = 0;
+
+StartupProfiler::StartupProfiler(QObject *parent) :
+    QObject(parent), m_processAge(processAge()), m_finished(false)
+{
+    Q_ASSERT_X(m_instance == 0, Q_FUNC_INFO, "Only one StartupProfiler may be created");
+
+    m_clock.start();
+    m_instance = this;
+
+    addMilestone("main");
+}
+
+StartupProfiler::~StartupProfiler()
+{
+    m_instance = 0;
+
+    if (!m_finished) {
+        qDebug("StartupProfiler: The startup has not been completed");
+        logTimeline();
+    }
+}
+
+void StartupProfiler::mark(const char *milestone)
+{
+    if (m_instance != 0)
+        m_instance->addMilestone(milestone);
+}
+
+void StartupProfiler::watchFirstFrame(QQuickWindow *window)
+{
+    // frameSwapped() is emitted on the render thread
+    m_frameConnection = connect(window, &QQuickWindow::frameSwapped, this,
+                                &StartupProfiler::onFrameSwapped, Qt::DirectConnection);
+}
+
+void StartupProfiler::onFrameSwapped()
+{
+    disconnect(m_frameConnection);
+    addMilestone("first frame");
+}
+
+void StartupProfiler::addMilestone(const char *milestone)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_finished)
+        return;
+
+    QList<QPair<const char *, qint64> >::const_iterator i = m_milestones.constBegin();
+    for (; i != m_milestones.constEnd(); ++i) {
+        if (qstrcmp(i->first, milestone) == 0)
+            return;
+    }
+
+    m_milestones.append(qMakePair(milestone, m_processAge + m_clock.elapsed()));
+
+    for (int j = 0; j < MILESTONE_COUNT; ++j) {
+        bool reached = false;
+        for (i = m_milestones.constBegin(); i != m_milestones.constEnd() && !reached; ++i)
+            reached = (qstrcmp(i->first, MILESTONES[j]) == 0);
+
+        if (!reached)
+            return;
+    }
+
+    QMetaObject::invokeMethod(this, "finish", Qt::QueuedConnection);
+}
+
+void StartupProfiler::finish()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_finished)
+            return;
+
+        m_finished = true;
+    }
+
+    logTimeline();
+
+    MetricsRegistry *metrics = MetricsRegistry::instance();
+    QList<QPair<const char *, qint64> >::const_iterator i = m_milestones.constBegin();
+    for (; i != m_milestones.constEnd(); ++i)
+        metrics->setGauge(QString("startup.%1Ms").arg(QString(i->first).remove(' ')), i->second);
+
+    if (!qgetenv("GAGBOOK_EXIT_AFTER_STARTUP").isEmpty()) {
+        qDebug("StartupProfiler: GAGBOOK_EXIT_AFTER_STARTUP is set, quitting");
+        QCoreApplication::quit();
+    }
+}
+
+void StartupProfiler::logTimeline() const
+{
+    qDebug("StartupProfiler: Startup timeline (ms since the start of the process):");
+    qDebug("%8d  process start", 0);
+
+    QList<QPair<const char *, qint64> >::const_iterator i = m_milestones.constBegin();
+    for (; i != m_milestones.constEnd(); ++i)
+        qDebug("%8lld  %s", i->second, i->first);
+}
+
+// Returns the time in ms since the process has been started or 0 if it is not available
+qint64 StartupProfiler::processAge()
+{
+#ifdef Q_OS_LINUX
+    QFile statFile("/proc/self/stat");
+    if (!statFile.open(QIODevice::ReadOnly))
+        return 0;
+
+    // the fields after the command name (in parentheses) start with the third field, the
+    // 22nd field is the start time of the process in clock ticks since the boot
+    const QByteArray stat = statFile.readAll();
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.count() < 20)
+        return 0;
+
+    struct timespec now;
+    if (clock_gettime(CLOCK_BOOTTIME, &now) != 0)
+        return 0;
+
+    const qint64 startTime = fields.at(19).toLongLong() * 1000 / sysconf(_SC_CLK_TCK);
+    const qint64 uptime = qint64(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+
+    return qMax(Q_INT64_C(0), uptime - startTime);
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+
+class QQuickWindow;
+
+/*! Recorder of the startup timeline
+
+    Records the time since the start of the process at which the milestones of the
+    startup are reached: "main", "QML engine ready", "first frame", "login done",
+    "first post list" and "first image decoded". Only the first mark of a milestone is
+    recorded. Once all milestones have been reached the timeline is logged and recorded
+    as the gauges "startup.<milestone>Ms" in the MetricsRegistry.
+
+    If the environment variable GAGBOOK_EXIT_AFTER_STARTUP is set the app quits after the
+    timeline is complete, so that the startup can be measured by scripts (e.g. against a
+    local server given by GAGBOOK_API_URL, see tests/benchmarks/startup).
+
+    There is one instance per application, which should be created at the beginning of
+    main(). mark() can be called from any thread.
+ */
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+public:
+    /*! Constructor, marks the milestone "main". */
+    explicit StartupProfiler(QObject *parent = 0);
+
+    /*! Destructor, logs the timeline if it is incomplete. */
+    ~StartupProfiler();
+
+    /*! Mark the \p milestone as reached if it hasn't been reached before. Does nothing
+        if there is no instance. */
+    static void mark(const char *milestone);
+
+    /*! Mark the milestone "first frame" when \p window has rendered its first frame. */
+    void watchFirstFrame(QQuickWindow *window);
+
+private slots:
+    void onFrameSwapped();
+    void finish();
+
+private:
+    void addMilestone(const char *milestone);
+    void logTimeline() const;
+    static qint64 processAge();
+
+    static StartupProfiler *m_instance;
+
+    QMutex m_mutex;
+    QElapsedTimer m_clock;
+    qint64 m_processAge;        // the age of the process in ms when the clock was started
+    QList<QPair<const char *, qint64> > m_milestones;
+    QMetaObject::Connection m_frameConnection;
+    bool m_finished;
+};
+
+#endif // STARTUPPROFILER_H
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "tracing.h"
+
+#ifdef GAGBOOK_TRACING
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
+#include <QtCore/QDebug>
+#include <QtNetwork/QNetworkReply>
+
+// the number of events after which further events are dropped, about 50 MB of memory
+static const int MAX_EVENTS = 1000000;
+
+TraceRecorder::TraceRecorder()
+{
+    m_clock.start();
+}
+
+TraceRecorder *TraceRecorder::instance()
+{
+    static TraceRecorder recorder;
+    return &recorder;
+}
+
+qint64 TraceRecorder::timestamp() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+void TraceRecorder::addSpan(const char *name, qint64 start)
+{
+    Event event;
+    event.name = name;
+    event.phase = 'X';
+    event.timestamp = start;
+    event.duration = timestamp() - start;
+    event.threadId = quintptr(QThread::currentThreadId());
+    event.id = 0;
+    addEvent(event);
+}
+
+void TraceRecorder::traceReply(QNetworkReply *reply, const char *name)
+{
+    Event event;
+    event.name = name;
+    event.phase = 'b';
+    event.timestamp = timestamp();
+    event.duration = 0;
+    event.threadId = quintptr(QThread::currentThreadId());
+    event.id = quintptr(reply);
+    event.url = reply->url().toEncoded(QUrl::RemoveQuery);
+    addEvent(event);
+
+    QObject::connect(reply, &QNetworkReply::finished, [this, reply, name]() {
+        Event event;
+        event.name = name;
+        event.phase = 'e';
+        event.timestamp = timestamp();
+        event.duration = 0;
+        event.threadId = quintptr(QThread::currentThreadId());
+        event.id = quintptr(reply);
+        addEvent(event);
+    });
+}
+
+void TraceRecorder::addEvent(const Event &event)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_events.size() < MAX_EVENTS)
+        m_events.append(event);
+}
+
+bool TraceRecorder::save(const QString &fileName)
+{
+    QString path = fileName;
+    if (path.isEmpty())
+        path = QString::fromLocal8Bit(qgetenv("GAGBOOK_TRACE_FILE"));
+    if (path.isEmpty())
+        path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/trace.json";
+
+    QVector<Event> events;
+    {
+        QMutexLocker locker(&m_mutex);
+        events = m_events;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    foreach (const Event &event, events) {
+        QJsonObject object;
+        object.insert("name", QLatin1String(event.name));
+        object.insert("cat", QLatin1String("gagbook"));
+        object.insert("ph", QString(QLatin1Char(event.phase)));
+        object.insert("ts", double(event.timestamp));
+        object.insert("pid", double(pid));
+        object.insert("tid", double(event.threadId));
+
+        if (event.phase == 'X') {
+            object.insert("dur", double(event.duration));
+        } else {
+            object.insert("id", QString("0x%1").arg(event.id, 0, 16));
+            if (!event.url.isEmpty()) {
+                QJsonObject args;
+                args.insert("url", QString::fromUtf8(event.url));
+                object.insert("args", args);
+            }
+        }
+
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", traceEvents);
+    root.insert("displayTimeUnit", QLatin1String("ms"));
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("TraceRecorder::save(): Unable to open %s: %s", qPrintable(path),
+                 qPrintable(file.errorString()));
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    qDebug() << "TraceRecorder::save(): Wrote" << events.size() << "trace events to" << path;
+    return true;
+}
+
+#endif // GAGBOOK_TRACING
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TRACING_H
+#define TRACING_H
+
+/*! Trace spans of the hot paths
+
+    The macros below record spans in the Chrome trace-event format, which can be viewed
+    in chrome://tracing or https://ui.perfetto.dev. They are compiled out unless the app
+    is built with CONFIG+=tracing, which defines GAGBOOK_TRACING.
+
+    GAGBOOK_TRACE_SCOPE(name) records the time until the end of the enclosing scope,
+    GAGBOOK_TRACE_REPLY(reply, name) records the time until the network \p reply has
+    finished and GAGBOOK_TRACE_SAVE() writes all recorded spans to the trace file. The
+    \p name must be a string literal.
+ */
+
+#ifdef GAGBOOK_TRACING
+
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+class QNetworkReply;
+
+class TraceRecorder
+{
+public:
+    /*! Get the recorder of the application. */
+    static TraceRecorder *instance();
+
+    /*! The time in microseconds since the recorder has been created. */
+    qint64 timestamp() const;
+
+    /*! Record a span of the current thread which started at \p start. */
+    void addSpan(const char *name, qint64 start);
+
+    /*! Record a span which lasts until \p reply has finished. */
+    void traceReply(QNetworkReply *reply, const char *name);
+
+    /*! Write the recorded spans to \p fileName. By default the file given by the
+        GAGBOOK_TRACE_FILE environment variable or "trace.json" in the cache directory
+        of the app is written. */
+    bool save(const QString &fileName = QString());
+
+private:
+    TraceRecorder();
+    Q_DISABLE_COPY(TraceRecorder)
+
+    struct Event {
+        const char *name;
+        char phase;         // 'X' for a span of a thread, 'b' and 'e' for a network reply
+        qint64 timestamp;
+        qint64 duration;
+        quintptr threadId;
+        quintptr id;
+        QByteArray url;
+    };
+
+    void addEvent(const Event &event);
+
+    QElapsedTimer m_clock;
+    QMutex m_mutex;
+    QVector<Event> m_events;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name), m_start(TraceRecorder::instance()->timestamp()) {}
+    ~TraceScope() { TraceRecorder::instance()->addSpan(m_name, m_start); }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+
+    const char *m_name;
+    qint64 m_start;
+};
+
+#define GAGBOOK_TRACE_CONCAT_IMPL(a, b) a##b
+#define GAGBOOK_TRACE_CONCAT(a, b) GAGBOOK_TRACE_CONCAT_IMPL(a, b)
+#define GAGBOOK_TRACE_SCOPE(name) TraceScope GAGBOOK_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define GAGBOOK_TRACE_REPLY(reply, name) TraceRecorder::instance()->traceReply(reply, name)
+#define GAGBOOK_TRACE_SAVE() TraceRecorder::instance()->save()
+
+#else
+
+#define GAGBOOK_TRACE_SCOPE(name) do {} while (0)
+#define GAGBOOK_TRACE_REPLY(reply, name) do {} while (0)
+#define GAGBOOK_TRACE_SAVE() do {} while (0)
+
+#endif // GAGBOOK_TRACING
+
+#endif // TRACING_H
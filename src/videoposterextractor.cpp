@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "videoposterextractor.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QUrl>
+#include <QtGui/QImage>
+#include <QtMultimedia/QAbstractVideoSurface>
+
+#include "fileioworker.h"
+#include "jankmonitor.h"
+
+// the time after which the extraction is cancelled if no frame has been decoded
+static const int EXTRACTION_TIMEOUT = 10000;  // in ms
+static const int POSTER_QUALITY = 85;
+
+// the extractor which currently uses the shared player and the extractors waiting for it
+static VideoPosterExtractor *s_activeExtractor = 0;
+static QList<VideoPosterExtractor *> s_pendingExtractors;
+
+static inline uchar clampToByte(int value)
+{
+    return uchar(qBound(0, value, 255));
+}
+
+// Converts a pixel from YCbCr (BT.601, limited range) to RGB
+static inline QRgb yuvToRgb(int y, int u, int v)
+{
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+
+    return qRgb(clampToByte((c + 409 * e) >> 8),
+                clampToByte((c - 100 * d - 208 * e) >> 8),
+                clampToByte((c + 516 * d) >> 8));
+}
+
+// A copy of the planes of a mapped video frame, which stays valid after the frame has been unmapped
+struct PosterFrame {
+    int width;
+    int height;
+    QVideoFrame::PixelFormat pixelFormat;
+    QByteArray planes[3];
+    int bytesPerLine[3];
+};
+
+static bool isYuvFormat(QVideoFrame::PixelFormat pixelFormat)
+{
+    return (pixelFormat == QVideoFrame::Format_YUV420P || pixelFormat == QVideoFrame::Format_YV12 ||
+            pixelFormat == QVideoFrame::Format_NV12 || pixelFormat == QVideoFrame::Format_NV21);
+}
+
+// Copies the planes of the frame, returns false if the frame can't be converted to an image
+static bool copyFrame(const QVideoFrame &frame, PosterFrame *posterFrame)
+{
+    QVideoFrame mappedFrame(frame);
+    const QVideoFrame::PixelFormat pixelFormat = mappedFrame.pixelFormat();
+
+    if (!isYuvFormat(pixelFormat) && QVideoFrame::imageFormatFromPixelFormat(pixelFormat) == QImage::Format_Invalid)
+        return false;
+
+    if (!mappedFrame.map(QAbstractVideoBuffer::ReadOnly))
+        return false;
+
+    posterFrame->width = mappedFrame.width();
+    posterFrame->height = mappedFrame.height();
+    posterFrame->pixelFormat = pixelFormat;
+
+    const int planeCount = qMin(3, mappedFrame.planeCount());
+
+    for (int plane = 0; plane < planeCount; ++plane) {
+        // the chroma planes of the YUV 4:2:0 formats have half the height
+        const int planeHeight = (plane == 0) ? posterFrame->height : (posterFrame->height + 1) / 2;
+
+        posterFrame->bytesPerLine[plane] = mappedFrame.bytesPerLine(plane);
+        posterFrame->planes[plane] = QByteArray(reinterpret_cast<const char *>(mappedFrame.bits(plane)),
+                                                mappedFrame.bytesPerLine(plane) * planeHeight);
+    }
+
+    mappedFrame.unmap();
+
+    // the planar formats need all their planes
+    const int requiredPlanes = !isYuvFormat(pixelFormat) ? 1 : (pixelFormat == QVideoFrame::Format_NV12 ||
+                                                               pixelFormat == QVideoFrame::Format_NV21) ? 2 : 3;
+    return (planeCount >= requiredPlanes);
+}
+
+static QImage frameToImage(const PosterFrame &frame)
+{
+    const int width = frame.width;
+    const int height = frame.height;
+    const QVideoFrame::PixelFormat pixelFormat = frame.pixelFormat;
+    const QImage::Format imageFormat = QVideoFrame::imageFormatFromPixelFormat(pixelFormat);
+
+    if (imageFormat != QImage::Format_Invalid) {
+        // copy the image since it doesn't own the data of the frame
+        return QImage(reinterpret_cast<const uchar *>(frame.planes[0].constData()), width, height,
+                      frame.bytesPerLine[0], imageFormat).copy();
+    }
+
+    const bool isSemiPlanar = (pixelFormat == QVideoFrame::Format_NV12 || pixelFormat == QVideoFrame::Format_NV21);
+    const bool isVFirst = (pixelFormat == QVideoFrame::Format_YV12 || pixelFormat == QVideoFrame::Format_NV21);
+
+    QImage image(width, height, QImage::Format_RGB32);
+
+    const uchar *yPlane = reinterpret_cast<const uchar *>(frame.planes[0].constData());
+    const uchar *uvPlane = reinterpret_cast<const uchar *>(frame.planes[1].constData());
+    const uchar *secondPlane = isSemiPlanar ? 0 : reinterpret_cast<const uchar *>(frame.planes[2].constData());
+    const int yStride = frame.bytesPerLine[0];
+    const int uvStride = frame.bytesPerLine[1];
+
+    for (int y = 0; y < height; ++y) {
+        const uchar *yRow = yPlane + y * yStride;
+        const uchar *uvRow = uvPlane + (y / 2) * uvStride;
+        const uchar *secondRow = isSemiPlanar ? 0 : secondPlane + (y / 2) * frame.bytesPerLine[2];
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+
+        for (int x = 0; x < width; ++x) {
+            int u, v;
+
+            if (isSemiPlanar) {
+                u = uvRow[(x / 2) * 2];
+                v = uvRow[(x / 2) * 2 + 1];
+            } else {
+                u = uvRow[x / 2];
+                v = secondRow[x / 2];
+            }
+
+            if (isVFirst)
+                qSwap(u, v);
+
+            line[x] = yuvToRgb(yRow[x], u, v);
+        }
+    }
+
+    return image;
+}
+
+// Converts the copied frame and encodes it as JPEG in a thread of the pool
+class PosterEncodeTask : public QRunnable
+{
+public:
+    PosterEncodeTask(VideoPosterExtractor *extractor, const PosterFrame &frame)
+        : m_extractor(extractor), m_frame(frame)
+    {
+    }
+
+    void run()
+    {
+        const QImage poster = frameToImage(m_frame);
+        QByteArray posterData;
+
+        if (!poster.isNull()) {
+            QBuffer buffer(&posterData);
+            buffer.open(QIODevice::WriteOnly);
+            poster.save(&buffer, "JPG", POSTER_QUALITY);
+            buffer.close();
+        }
+
+        QMetaObject::invokeMethod(m_extractor, "onPosterEncoded", Qt::QueuedConnection,
+                                  Q_ARG(QByteArray, posterData), Q_ARG(QSize, poster.size()));
+    }
+
+private:
+    // the extractor waits for the result, so it is not deleted before
+    VideoPosterExtractor *m_extractor;
+    const PosterFrame m_frame;
+};
+
+// The video output of the shared player, passes the frames to the active extractor
+class PosterVideoSurface : public QAbstractVideoSurface
+{
+public:
+    explicit PosterVideoSurface(QObject *parent) : QAbstractVideoSurface(parent) {}
+
+    QList<QVideoFrame::PixelFormat> supportedPixelFormats(
+            QAbstractVideoBuffer::HandleType handleType = QAbstractVideoBuffer::NoHandle) const
+    {
+        // the frames have to be mapped to memory
+        if (handleType != QAbstractVideoBuffer::NoHandle)
+            return QList<QVideoFrame::PixelFormat>();
+
+        return QList<QVideoFrame::PixelFormat>()
+                << QVideoFrame::Format_RGB32 << QVideoFrame::Format_ARGB32
+                << QVideoFrame::Format_YUV420P << QVideoFrame::Format_YV12
+                << QVideoFrame::Format_NV12 << QVideoFrame::Format_NV21;
+    }
+
+    bool present(const QVideoFrame &frame)
+    {
+        if (s_activeExtractor != 0)
+            s_activeExtractor->present(frame);
+
+        return true;
+    }
+};
+
+/*!
+ * \brief VideoPosterExtractor::VideoPosterExtractor Constructs an extractor, call extract() to
+ *  extract the poster.
+ * \param videoPath The path of the local video file.
+ * \param posterPath The path of the poster image which should be written.
+ * \param parent Pointer to the parent object.
+ */
+VideoPosterExtractor::VideoPosterExtractor(const QString &videoPath, const QString &posterPath,
+                                           QObject *parent)
+    : QObject(parent), m_videoPath(videoPath), m_posterPath(posterPath), m_writeJobId(-1), m_done(false)
+{
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(EXTRACTION_TIMEOUT);
+    connect(&m_timeout, SIGNAL(timeout()), SLOT(onError()));
+}
+
+VideoPosterExtractor::~VideoPosterExtractor()
+{
+    s_pendingExtractors.removeAll(this);
+
+    if (s_activeExtractor == this)
+        releasePlayer();
+}
+
+void VideoPosterExtractor::extract()
+{
+    s_pendingExtractors.append(this);
+
+    if (s_activeExtractor == 0)
+        startNext();
+}
+
+// The player is created on the first extraction and lives as long as the application
+QMediaPlayer *VideoPosterExtractor::sharedPlayer()
+{
+    static QMediaPlayer *player = 0;
+
+    if (player == 0) {
+        player = new QMediaPlayer(QCoreApplication::instance(), QMediaPlayer::VideoSurface);
+        player->setMuted(true);
+        player->setVideoOutput(new PosterVideoSurface(player));
+    }
+
+    return player;
+}
+
+// Lets the next pending extractor use the player, or stops the player if there is none
+void VideoPosterExtractor::startNext()
+{
+    if (s_activeExtractor != 0)
+        return;
+
+    if (s_pendingExtractors.isEmpty()) {
+        sharedPlayer()->stop();
+        return;
+    }
+
+    s_activeExtractor = s_pendingExtractors.takeFirst();
+    s_activeExtractor->start();
+}
+
+void VideoPosterExtractor::start()
+{
+    QMediaPlayer *player = sharedPlayer();
+
+    connect(player, SIGNAL(mediaStatusChanged(QMediaPlayer::MediaStatus)),
+            this, SLOT(onMediaStatusChanged(QMediaPlayer::MediaStatus)));
+    connect(player, SIGNAL(error(QMediaPlayer::Error)), this, SLOT(onError()));
+
+    m_timeout.start();
+    player->setMedia(QUrl::fromLocalFile(m_videoPath));
+    player->play();
+}
+
+// Hands the player over to the next extractor
+void VideoPosterExtractor::releasePlayer()
+{
+    m_timeout.stop();
+    disconnect(sharedPlayer(), 0, this, 0);
+    s_activeExtractor = 0;
+
+    // the player must not be stopped or get new media while it delivers a frame
+    QTimer::singleShot(0, &VideoPosterExtractor::startNext);
+}
+
+// Called by the video surface on the GUI thread for every decoded frame
+void VideoPosterExtractor::present(const QVideoFrame &frame)
+{
+    JankMonitor::Task guiTask("VideoPosterExtractor::present");
+
+    if (m_done)
+        return;
+
+    PosterFrame posterFrame;
+
+    // not every (e.g. an empty) frame can be converted, wait for the next one
+    if (!copyFrame(frame, &posterFrame))
+        return;
+
+    m_done = true;
+    releasePlayer();
+
+    QThreadPool::globalInstance()->start(new PosterEncodeTask(this, posterFrame));
+}
+
+void VideoPosterExtractor::fail()
+{
+    qWarning("VideoPosterExtractor: Unable to extract the poster of [%s]", qPrintable(m_videoPath));
+    emit finished(QString(), QSize());
+    deleteLater();
+}
+
+void VideoPosterExtractor::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
+{
+    if (!m_done && (status == QMediaPlayer::InvalidMedia || status == QMediaPlayer::EndOfMedia))
+        onError();
+}
+
+void VideoPosterExtractor::onError()
+{
+    if (m_done)
+        return;
+
+    m_done = true;
+    releasePlayer();
+    fail();
+}
+
+void VideoPosterExtractor::onPosterEncoded(const QByteArray &posterData, const QSize &size)
+{
+    if (posterData.isEmpty()) {
+        fail();
+        return;
+    }
+
+    m_posterSize = size;
+
+    connect(FileIoWorker::instance(), SIGNAL(jobFinished(int,bool)), SLOT(onPosterWritten(int,bool)));
+    m_writeJobId = FileIoWorker::instance()->write(m_posterPath, posterData);
+}
+
+void VideoPosterExtractor::onPosterWritten(int jobId, bool success)
+{
+    if (jobId != m_writeJobId)
+        return;
+
+    // use QUrl to get the 'file://' scheme, like the other cached files
+    if (success)
+        emit finished(QUrl::fromLocalFile(m_posterPath).toString(), m_posterSize);
+    else
+        emit finished(QString(), QSize());
+
+    deleteLater();
+}
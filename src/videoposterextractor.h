@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef VIDEOPOSTEREXTRACTOR_H
+#define VIDEOPOSTEREXTRACTOR_H
+
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+#include <QtCore/QSize>
+#include <QtMultimedia/QMediaPlayer>
+
+class QVideoFrame;
+
+/*! Extract the first frame of a local video as poster image
+
+    Decodes the first frame of the video with a QMediaPlayer and writes it as JPEG file
+    with the FileIoWorker. Used for animated posts of which only the video is downloaded
+    (see AppSettings::extractVideoPosters), so that the separate preview image does not
+    have to be downloaded. The extractor deletes itself after finished() has been emitted.
+
+    All extractors share a single QMediaPlayer and decode their videos one after another.
+    Only the copy of the decoded frame is done on the GUI thread, the color conversion
+    and the JPEG encoding run in the global QThreadPool.
+ */
+class VideoPosterExtractor : public QObject
+{
+    Q_OBJECT
+public:
+    /*! Constructor. \p videoPath is the local video file and \p posterPath the path of
+        the poster image that is written. */
+    VideoPosterExtractor(const QString &videoPath, const QString &posterPath, QObject *parent = 0);
+    ~VideoPosterExtractor();
+
+    /*! Start decoding the video, as soon as the player is not used by another extractor. */
+    void extract();
+
+signals:
+    /*! Emit when the poster has been written. \p posterUrl is the 'file://' URL of the poster
+        image and \p size its size, or an empty string if the extraction failed. */
+    void finished(const QString &posterUrl, const QSize &size);
+
+private slots:
+    void onMediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void onError();
+    void onPosterEncoded(const QByteArray &posterData, const QSize &size);
+    void onPosterWritten(int jobId, bool success);
+
+private:
+    Q_DISABLE_COPY(VideoPosterExtractor)
+
+    friend class PosterVideoSurface;
+
+    static QMediaPlayer *sharedPlayer();
+    static void startNext();
+
+    void start();
+    void releasePlayer();
+    void present(const QVideoFrame &frame);
+    void fail();
+
+    const QString m_videoPath;
+    const QString m_posterPath;
+    QTimer m_timeout;
+    QSize m_posterSize;
+    int m_writeJobId;
+    bool m_done;
+};
+
+#endif // VIDEOPOSTEREXTRACTOR_H
@@ -0,0 +1,24 @@
+TARGET = tst_commentcache
+
+QT += core testlib
+
+CONFIG += testcase c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../..
+
+HEADERS += \
+    ../../../src/commentcache.h \
+    ../../../src/commentmediaobject.h \
+    ../../../src/commentobject.h \
+    ../../../src/fileioworker.h \
+    ../../../src/mappedfile.h \
+    ../../../src/userobject.h
+
+SOURCES += tst_commentcache.cpp \
+    ../../../src/commentcache.cpp \
+    ../../../src/commentmediaobject.cpp \
+    ../../../src/commentobject.cpp \
+    ../../../src/fileioworker.cpp \
+    ../../../src/mappedfile.cpp \
+    ../../../src/userobject.cpp
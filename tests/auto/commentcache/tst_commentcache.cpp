@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <QtTest/QtTest>
+
+#include "src/commentcache.h"
+#include "src/fileioworker.h"
+
+/*
+ * Tests the serialization of CommentCache (in memory and through the cache file), the expiry of
+ * the entries and the entries that exceed the memory budget. The entries are stored in the
+ * comment cache of the user under URLs that don't exist and are removed after each test.
+ */
+class TestCommentCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void cleanupTestCase();
+    void restoreFromMemory();
+    void restoreFromFile();
+    void timeToLive();
+    void oversizedEntry();
+
+private:
+    FileIoWorker *m_fileIoWorker;
+    QList<QUrl> m_storedUrls;
+};
+
+// A comment thread with text and media comments and two levels of replies
+static CommentObject *createThread(int commentCount, int textLength = 10)
+{
+    CommentObject *root = new CommentObject;
+    root->setTotalChildCount(commentCount * 3);
+    root->setHasMoreTopLvlComments(true);
+    root->setUser(UserObject("op"));
+
+    for (int i = 0; i < commentCount; ++i) {
+        CommentObject *comment = new CommentObject(root);
+        comment->setId(QString("c%1").arg(i));
+        comment->setTimestamp(QDateTime::fromMSecsSinceEpoch(1500000000000LL + i * 1000, Qt::UTC));
+        comment->setPermalink(QUrl(QString("http://tst-commentcache.invalid/c%1").arg(i)));
+        comment->setText(QString(textLength, QChar('a' + i % 26)));
+        comment->setOrderKey(QString("key%1").arg(i));
+        comment->setUpvotes(i * 2);
+        comment->setTotalChildCount(2);
+
+        if (i % 2 == 1) {
+            CommentMediaObject media;
+            media.setMediaType(CommentMediaObject::Animated);
+            media.setImageUrl(QUrl(QString("http://tst-commentcache.invalid/%1.jpg").arg(i)));
+            media.setImageSize(QSize(320, 240));
+            media.setVideoUrl(QUrl(QString("http://tst-commentcache.invalid/%1.mp4").arg(i)));
+            media.setVideoSize(QSize(320, 240));
+            comment->setTextType(ContentType::UserMedia);
+            comment->setMedia(media);
+        }
+
+        UserObject user;
+        user.setName(QString("user%1").arg(i));
+        user.setUserId(QString("u%1").arg(i));
+        user.setIsProUser(i % 3 == 0);
+        comment->setUser(user);
+
+        for (int j = 0; j < 2; ++j) {
+            CommentObject *reply = new CommentObject(comment);
+            reply->setId(QString("c%1r%2").arg(i).arg(j));
+            reply->setText("reply");
+            comment->appendChild(reply);
+        }
+
+        root->appendChild(comment);
+    }
+
+    return root;
+}
+
+// Compares the restored comment (and its replies) with the stored one
+static void compareComments(CommentObject *restored, CommentObject *stored)
+{
+    QCOMPARE(restored->id(), stored->id());
+    QCOMPARE(restored->timestamp(), stored->timestamp());
+    QCOMPARE(restored->permalink(), stored->permalink());
+    QCOMPARE(restored->text(), stored->text());
+    QCOMPARE(restored->textType(), stored->textType());
+    QCOMPARE(restored->orderKey(), stored->orderKey());
+    QCOMPARE(restored->upvotes(), stored->upvotes());
+    QCOMPARE(restored->totalChildCount(), stored->totalChildCount());
+    QCOMPARE(restored->user().name(), stored->user().name());
+    QCOMPARE(restored->user().userId(), stored->user().userId());
+    QCOMPARE(restored->user().isProUser(), stored->user().isProUser());
+
+    if (stored->textType() != ContentType::Text) {
+        CommentMediaObject restoredMedia = restored->media();
+        CommentMediaObject storedMedia = stored->media();
+        QCOMPARE(restoredMedia.mediaType(), storedMedia.mediaType());
+        QCOMPARE(restoredMedia.imageUrl(), storedMedia.imageUrl());
+        QCOMPARE(restoredMedia.imageSize(), storedMedia.imageSize());
+        QCOMPARE(restoredMedia.videoUrl(), storedMedia.videoUrl());
+        QCOMPARE(restoredMedia.videoSize(), storedMedia.videoSize());
+    }
+
+    QCOMPARE(restored->currentChildCount(), stored->currentChildCount());
+    for (int i = 0; i < stored->currentChildCount(); ++i) {
+        QCOMPARE(restored->child(i)->parentComment(), restored);
+        compareComments(restored->child(i), stored->child(i));
+    }
+}
+
+// Restores the entry of gagUrl and compares it with the stored thread
+static void compareRestored(CommentCache *cache, const QUrl &gagUrl, CommentObject *stored)
+{
+    CommentArena arena;
+    CommentObject *root = arena.create();
+    const QList<CommentObject *> comments = cache->restore(gagUrl, 0, root, &arena);
+
+    QCOMPARE(comments.count(), stored->currentChildCount());
+    QCOMPARE(root->totalChildCount(), stored->totalChildCount());
+    QCOMPARE(root->hasMoreTopLvlComments(), stored->hasMoreTopLvlComments());
+    QCOMPARE(root->user().userId(), stored->user().userId());
+
+    for (int i = 0; i < comments.count(); ++i) {
+        QCOMPARE(comments.at(i)->parentComment(), root);
+        compareComments(comments.at(i), stored->child(i));
+    }
+}
+
+static QUrl testUrl(const char *name)
+{
+    return QUrl(QString("http://tst-commentcache.invalid/gag/%1").arg(name));
+}
+
+void TestCommentCache::initTestCase()
+{
+    m_fileIoWorker = new FileIoWorker(this);
+}
+
+void TestCommentCache::cleanup()
+{
+    CommentCache cache;
+    foreach (const QUrl &url, m_storedUrls)
+        cache.remove(url, 0);
+
+    m_storedUrls.clear();
+    m_fileIoWorker->waitForDone();
+}
+
+void TestCommentCache::cleanupTestCase()
+{
+    delete m_fileIoWorker;
+}
+
+void TestCommentCache::restoreFromMemory()
+{
+    const QUrl url = testUrl("memory");
+    QScopedPointer<CommentObject> stored(createThread(10));
+
+    CommentCache cache;
+    QVERIFY(!cache.contains(url, 0));
+
+    cache.store(url, 0, stored.data());
+    m_storedUrls.append(url);
+
+    QVERIFY(cache.isLoaded(url, 0));
+    QVERIFY(!cache.isLoaded(url, 1));
+    compareRestored(&cache, url, stored.data());
+}
+
+void TestCommentCache::restoreFromFile()
+{
+    const QUrl url = testUrl("file");
+    QScopedPointer<CommentObject> stored(createThread(10));
+
+    {
+        CommentCache cache;
+        cache.store(url, 0, stored.data());
+        m_storedUrls.append(url);
+    }
+
+    // a new cache only knows the file
+    m_fileIoWorker->waitForDone();
+    CommentCache cache;
+    QVERIFY(cache.contains(url, 0));
+    QVERIFY(!cache.isLoaded(url, 0));
+
+    QSignalSpy loadedSpy(&cache, &CommentCache::loaded);
+    cache.load(url, 0);
+    QVERIFY(loadedSpy.wait(5000));
+    QCOMPARE(loadedSpy.first().at(2).toBool(), true);
+
+    QVERIFY(cache.isLoaded(url, 0));
+    compareRestored(&cache, url, stored.data());
+}
+
+void TestCommentCache::timeToLive()
+{
+    const QUrl url = testUrl("ttl");
+    QScopedPointer<CommentObject> stored(createThread(2));
+
+    CommentCache cache;
+    cache.setTimeToLive(0);
+    QCOMPARE(cache.timeToLive(), 0);
+
+    cache.store(url, 0, stored.data());
+    m_storedUrls.append(url);
+
+    // the entry expires once it is older than a second
+    QTRY_VERIFY_WITH_TIMEOUT(!cache.isLoaded(url, 0), 5000);
+    QVERIFY(!cache.contains(url, 0));
+
+    CommentObject root;
+    QVERIFY(cache.restore(url, 0, &root, 0).isEmpty());
+
+    // the file has been removed with the expired entry
+    m_fileIoWorker->waitForDone();
+    QSignalSpy loadedSpy(&cache, &CommentCache::loaded);
+    cache.load(url, 0);
+    QVERIFY(loadedSpy.wait(5000));
+    QCOMPARE(loadedSpy.first().at(2).toBool(), false);
+}
+
+void TestCommentCache::oversizedEntry()
+{
+    // more than the memory budget of 4 MB
+    const QUrl url = testUrl("oversized");
+    QScopedPointer<CommentObject> stored(createThread(50, 50000));
+
+    CommentCache cache;
+    cache.store(url, 0, stored.data());
+    m_storedUrls.append(url);
+
+    // only kept on disk
+    QVERIFY(cache.contains(url, 0));
+    QVERIFY(!cache.isLoaded(url, 0));
+
+    QSignalSpy loadedSpy(&cache, &CommentCache::loaded);
+    cache.load(url, 0);
+    QVERIFY(loadedSpy.wait(5000));
+    QCOMPARE(loadedSpy.first().at(2).toBool(), true);
+
+    // kept after loading until it has been restored once
+    QVERIFY(cache.isLoaded(url, 0));
+    compareRestored(&cache, url, stored.data());
+    QVERIFY(!cache.isLoaded(url, 0));
+    QVERIFY(cache.contains(url, 0));
+}
+
+QTEST_GUILESS_MAIN(TestCommentCache)
+
+#include "tst_commentcache.moc"
@@ -0,0 +1,18 @@
+TARGET = tst_commentobject
+
+QT += core testlib
+
+CONFIG += testcase c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../..
+
+HEADERS += \
+    ../../../src/commentmediaobject.h \
+    ../../../src/commentobject.h \
+    ../../../src/userobject.h
+
+SOURCES += tst_commentobject.cpp \
+    ../../../src/commentmediaobject.cpp \
+    ../../../src/commentobject.cpp \
+    ../../../src/userobject.cpp
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <QtTest/QtTest>
+
+#include "src/commentobject.h"
+
+/*
+ * Tests the row maintenance of CommentObject, the CommentArena and the ownership of the
+ * CommentObjects it creates.
+ */
+class TestCommentObject : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rowNotInParent();
+    void rowAfterInsertChild();
+    void rowAfterAppendChildren();
+    void rowAfterRemoveChild();
+    void arenaCreate();
+    void arenaClear();
+    void arenaCopyOutlivesArena();
+    void arenaAssignmentDetaches();
+    void arenaChildrenAreNotDeleted();
+};
+
+// Checks that row() and childIndex() of each child match its position in the list of \p parent
+static void verifyRows(CommentObject *parent, const QStringList &ids)
+{
+    QCOMPARE(parent->currentChildCount(), ids.count());
+
+    for (int i = 0; i < ids.count(); ++i) {
+        CommentObject *child = parent->child(i);
+        QCOMPARE(child->id(), ids.at(i));
+        QCOMPARE(child->row(), i);
+        QCOMPARE(parent->childIndex(child), i);
+    }
+}
+
+static CommentObject *createChild(CommentObject *parent, const QString &id)
+{
+    CommentObject *child = new CommentObject(parent);
+    child->setId(id);
+    return child;
+}
+
+void TestCommentObject::rowNotInParent()
+{
+    CommentObject root;
+    QCOMPARE(root.row(), 0);
+
+    // a comment with a parent which doesn't list it
+    CommentObject *child = createChild(&root, "a");
+    QCOMPARE(child->row(), -1);
+    delete child;
+}
+
+void TestCommentObject::rowAfterInsertChild()
+{
+    CommentObject root;
+    root.appendChild(createChild(&root, "b"));
+    root.appendChild(createChild(&root, "d"));
+
+    root.insertChild(0, createChild(&root, "a"));
+    root.insertChild(2, createChild(&root, "c"));
+    root.insertChild(4, createChild(&root, "e"));
+
+    verifyRows(&root, QStringList() << "a" << "b" << "c" << "d" << "e");
+}
+
+void TestCommentObject::rowAfterAppendChildren()
+{
+    CommentObject root;
+    root.appendChild(createChild(&root, "a"));
+    root.appendChildren(QList<CommentObject *>() << createChild(&root, "b") << createChild(&root, "c"));
+    root.insertChild(1, createChild(&root, "x"));
+
+    verifyRows(&root, QStringList() << "a" << "x" << "b" << "c");
+}
+
+void TestCommentObject::rowAfterRemoveChild()
+{
+    CommentArena arena;
+    CommentObject *root = arena.create();
+    QList<CommentObject *> children;
+
+    foreach (const QString &id, QStringList() << "a" << "b" << "c" << "d") {
+        CommentObject *child = arena.create(root);
+        child->setId(id);
+        children.append(child);
+    }
+
+    root->appendChildren(children);
+    root->removeChild(1);
+    verifyRows(root, QStringList() << "a" << "c" << "d");
+
+    // the removed comment is still allocated by the arena, but no longer in the list
+    QCOMPARE(children.at(1)->row(), -1);
+
+    root->removeChild(0);
+    root->removeChild(1);
+    verifyRows(root, QStringList() << "c");
+    QCOMPARE(children.at(0)->row(), -1);
+    QCOMPARE(children.at(3)->row(), -1);
+
+    root->removeAllChildren();
+    QCOMPARE(children.at(2)->row(), -1);
+}
+
+void TestCommentObject::arenaCreate()
+{
+    // more comments than fit into one block
+    CommentArena arena(2);
+    CommentObject root;
+    QList<CommentObject *> comments;
+
+    for (int i = 0; i < 5; ++i) {
+        CommentObject *comment = arena.create(&root);
+        comment->setId(QString::number(i));
+        comments.append(comment);
+    }
+
+    QCOMPARE(arena.count(), 5);
+
+    for (int i = 0; i < comments.count(); ++i) {
+        QCOMPARE(comments.at(i)->id(), QString::number(i));
+        QCOMPARE(comments.at(i)->parentComment(), &root);
+    }
+}
+
+void TestCommentObject::arenaClear()
+{
+    CommentArena arena(4);
+    for (int i = 0; i < 10; ++i)
+        arena.create()->setText("comment");
+
+    arena.clear();
+    QCOMPARE(arena.count(), 0);
+
+    // the arena can be filled again
+    CommentObject *comment = arena.create();
+    comment->setText("again");
+    QCOMPARE(arena.count(), 1);
+    QCOMPARE(comment->text(), QString("again"));
+}
+
+void TestCommentObject::arenaCopyOutlivesArena()
+{
+    CommentObject copy;
+
+    {
+        CommentArena arena;
+        CommentObject *comment = arena.create();
+        comment->setId("c1");
+        comment->setUpvotes(42);
+
+        copy = CommentObject(*comment);
+
+        // the copy doesn't share the data of the arena
+        comment->setUpvotes(7);
+        QCOMPARE(copy.upvotes(), 42);
+    }
+
+    QCOMPARE(copy.id(), QString("c1"));
+    QCOMPARE(copy.upvotes(), 42);
+}
+
+void TestCommentObject::arenaAssignmentDetaches()
+{
+    CommentArena arena;
+    CommentObject *comment = arena.create();
+    comment->setText("arena");
+
+    CommentObject assigned;
+    assigned = *comment;
+    comment->setText("changed");
+    QCOMPARE(assigned.text(), QString("arena"));
+
+    // an arena-allocated comment can take the data of a heap comment
+    CommentObject heap;
+    heap.setText("heap");
+    *comment = heap;
+    QCOMPARE(comment->text(), QString("heap"));
+
+    arena.clear();
+    QCOMPARE(heap.text(), QString("heap"));
+    QCOMPARE(assigned.text(), QString("arena"));
+}
+
+void TestCommentObject::arenaChildrenAreNotDeleted()
+{
+    CommentArena arena;
+    CommentObject *root = arena.create();
+    CommentObject *child = arena.create(root);
+    child->setId("child");
+    root->appendChild(child);
+
+    // removing an arena-allocated child leaves it to the arena
+    root->removeChild(0);
+    QCOMPARE(root->currentChildCount(), 0);
+    QCOMPARE(child->id(), QString("child"));
+    QCOMPARE(arena.count(), 2);
+}
+
+QTEST_GUILESS_MAIN(TestCommentObject)
+
+#include "tst_commentobject.moc"
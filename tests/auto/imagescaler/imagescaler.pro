@@ -0,0 +1,17 @@
+TARGET = tst_imagescaler
+
+QT += core gui testlib
+
+CONFIG += testcase c++11 console
+CONFIG -= app_bundle
+
+# qmake CONFIG+=nosimd tests the scalar fallback of ImageScaler instead of NEON/SSE2
+nosimd: DEFINES += IMAGESCALER_NO_SIMD
+
+INCLUDEPATH += ../../..
+
+HEADERS += \
+    ../../../src/imagescaler.h
+
+SOURCES += tst_imagescaler.cpp \
+    ../../../src/imagescaler.cpp
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <QtTest/QtTest>
+#include <QtGui/QImage>
+
+#include "src/imagescaler.h"
+
+/*
+ * Tests the box filter of ImageScaler, which is vectorized with NEON or SSE2, against a plain
+ * per-pixel reference. Build with CONFIG+=nosimd to test the scalar fallback in the same way.
+ */
+class TestImageScaler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void boxDownscaled_data();
+    void boxDownscaled();
+    void boxDownscaledInvalid();
+    void scaled_data();
+    void scaled();
+    void scaledKeepsEdges();
+    void boundedSize_data();
+    void boundedSize();
+};
+
+// An image with random pixels, the same seed gives the same image
+static QImage randomImage(const QSize &size, QImage::Format format, uint seed)
+{
+    QImage image(size, format);
+    qsrand(seed);
+
+    for (int y = 0; y < image.height(); ++y) {
+        uchar *line = image.scanLine(y);
+
+        for (int x = 0; x < image.bytesPerLine(); ++x)
+            line[x] = uchar(qrand() & 0xff);
+    }
+
+    // premultiplied channels must not exceed the alpha
+    return (format == QImage::Format_ARGB32) ? image.convertToFormat(QImage::Format_ARGB32_Premultiplied) : image;
+}
+
+// The reference of ImageScaler::boxDownscaled(), every pixel is averaged on its own and the remaining
+// rows and columns belong to the last square
+static QImage referenceBoxDownscaled(const QImage &image, int factor)
+{
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                          : QImage::Format_RGB32;
+    const QImage source = image.convertToFormat(format);
+    QImage target(source.width() / factor, source.height() / factor, format);
+
+    for (int y = 0; y < target.height(); ++y) {
+        const int rowCount = (y == target.height() - 1) ? source.height() - y * factor : factor;
+
+        for (int x = 0; x < target.width(); ++x) {
+            const int columnCount = (x == target.width() - 1) ? source.width() - x * factor : factor;
+            const quint32 area = quint32(rowCount) * columnCount;
+
+            for (int c = 0; c < 4; ++c) {
+                quint32 sum = 0;
+
+                for (int i = 0; i < rowCount; ++i) {
+                    const uchar *line = source.constScanLine(y * factor + i);
+
+                    for (int j = 0; j < columnCount; ++j)
+                        sum += line[(x * factor + j) * 4 + c];
+                }
+
+                target.scanLine(y)[x * 4 + c] = uchar((sum + area / 2) / area);
+            }
+        }
+    }
+
+    return target;
+}
+
+void TestImageScaler::boxDownscaled_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("factor");
+
+    // the widths cover whole vectors and remainders which are summed up by the scalar loop
+    QTest::newRow("rgb32 64x64 /2") << QSize(64, 64) << int(QImage::Format_RGB32) << 2;
+    QTest::newRow("rgb32 67x41 /3") << QSize(67, 41) << int(QImage::Format_RGB32) << 3;
+    QTest::newRow("rgb32 125x250 /5") << QSize(125, 250) << int(QImage::Format_RGB32) << 5;
+    QTest::newRow("rgb32 33x1000 /16") << QSize(33, 1000) << int(QImage::Format_RGB32) << 16;
+    QTest::newRow("argb32 97x97 /4") << QSize(97, 97) << int(QImage::Format_ARGB32) << 4;
+    QTest::newRow("argb32 301x77 /7") << QSize(301, 77) << int(QImage::Format_ARGB32) << 7;
+    QTest::newRow("rgb888 90x60 /3") << QSize(90, 60) << int(QImage::Format_RGB888) << 3;
+    QTest::newRow("identity") << QSize(19, 23) << int(QImage::Format_RGB32) << 1;
+
+    // the maximum factor must not overflow the 16 bit accumulators
+    QTest::newRow("rgb32 513x512 /256") << QSize(513, 512) << int(QImage::Format_RGB32) << 256;
+    // the last row of squares sums up 511 rows, more than the 16 bit accumulators can hold
+    QTest::newRow("argb32 767x767 /256") << QSize(767, 767) << int(QImage::Format_ARGB32) << 256;
+}
+
+void TestImageScaler::boxDownscaled()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, format);
+    QFETCH(int, factor);
+
+    const QImage image = randomImage(size, QImage::Format(format), uint(size.width() * size.height() + factor));
+    const QImage result = ImageScaler::boxDownscaled(image, factor);
+    const QImage expected = referenceBoxDownscaled(image, factor);
+
+    QCOMPARE(result.size(), QSize(size.width() / factor, size.height() / factor));
+    QCOMPARE(result.format(), expected.format());
+    QCOMPARE(result, expected);
+}
+
+void TestImageScaler::boxDownscaledInvalid()
+{
+    const QImage image = randomImage(QSize(16, 16), QImage::Format_RGB32, 1);
+
+    QVERIFY(ImageScaler::boxDownscaled(QImage(), 2).isNull());
+    QVERIFY(ImageScaler::boxDownscaled(image, 0).isNull());
+    QVERIFY(ImageScaler::boxDownscaled(image, 257).isNull());
+    QVERIFY(ImageScaler::boxDownscaled(image, 17).isNull());
+}
+
+void TestImageScaler::scaled_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QSize>("targetSize");
+
+    QTest::newRow("box only") << QSize(800, 600) << QSize(200, 150);
+    QTest::newRow("box and smooth") << QSize(1080, 8000) << QSize(540, 3999);
+    QTest::newRow("smooth only") << QSize(300, 300) << QSize(200, 200);
+    QTest::newRow("upscale") << QSize(50, 40) << QSize(100, 80);
+}
+
+void TestImageScaler::scaled()
+{
+    QFETCH(QSize, size);
+    QFETCH(QSize, targetSize);
+
+    const QImage image = randomImage(size, QImage::Format_RGB32, 2);
+
+    QCOMPARE(ImageScaler::scaled(image, targetSize).size(), targetSize);
+    QVERIFY(ImageScaler::scaled(image, QSize()).isNull());
+    QVERIFY(ImageScaler::scaled(QImage(), targetSize).isNull());
+}
+
+// The remaining rows and columns of the box filter must not be cropped from the scaled image
+void TestImageScaler::scaledKeepsEdges()
+{
+    // a black image with a white border of 9 pixels at the right and bottom, which is the remainder
+    // of the box factor 10
+    QImage image(1009, 1009, QImage::Format_RGB32);
+    image.fill(Qt::black);
+
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+
+        for (int x = 0; x < image.width(); ++x) {
+            if ((x >= 1000) || (y >= 1000))
+                line[x] = qRgb(255, 255, 255);
+        }
+    }
+
+    const QImage result = ImageScaler::scaled(image, QSize(100, 100));
+
+    QCOMPARE(result.size(), QSize(100, 100));
+    QCOMPARE(qRed(result.pixel(0, 0)), 0);
+    QVERIFY(qRed(result.pixel(99, 50)) > 64);
+    QVERIFY(qRed(result.pixel(50, 99)) > 64);
+    QVERIFY(qRed(result.pixel(99, 99)) > 64);
+}
+
+void TestImageScaler::boundedSize_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QSize>("maxSize");
+    QTest::addColumn<QSize>("expected");
+
+    QTest::newRow("fits") << QSize(500, 1000) << QSize(0, 2000) << QSize(500, 1000);
+    QTest::newRow("height") << QSize(500, 10000) << QSize(0, 2000) << QSize(100, 2000);
+    QTest::newRow("width") << QSize(4000, 3000) << QSize(1000, 0) << QSize(1000, 750);
+    QTest::newRow("both") << QSize(4000, 3000) << QSize(1000, 1000) << QSize(1000, 750);
+    QTest::newRow("minimum") << QSize(1, 100000) << QSize(0, 100) << QSize(1, 100);
+}
+
+void TestImageScaler::boundedSize()
+{
+    QFETCH(QSize, size);
+    QFETCH(QSize, maxSize);
+    QFETCH(QSize, expected);
+
+    QCOMPARE(ImageScaler::boundedSize(size, maxSize), expected);
+}
+
+QTEST_GUILESS_MAIN(TestImageScaler)
+
+#include "tst_imagescaler.moc"
@@ -0,0 +1,11 @@
+TEMPLATE = subdirs
+
+# the QtTest benchmarks (tst_bench_*) report the time per iteration, e.g.
+# "./tst_bench_imagescaler -tickcounter"; the harnesses (bench_*) run against the mock
+# server and print a JSON report
+SUBDIRS += \
+    imagescaler \
+    parser \
+    models \
+    downloads \
+    startup
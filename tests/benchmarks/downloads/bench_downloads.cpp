@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <functional>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+#include <QtGui/QGuiApplication>
+#include <QtNetwork/QNetworkReply>
+
+#include "src/fileioworker.h"
+#include "src/gagimagedownloader.h"
+#include "src/gagobject.h"
+#include "src/metricsregistry.h"
+#include "src/networkmanager.h"
+#include "tests/shared/benchmarkreport.h"
+#include "tests/shared/benchmarkserver.h"
+
+/*
+ * Runs GagImageDownloader::start() over synthetic GagObjects against the mock server and prints
+ * a JSON report with one entry per scenario, which is each combination of:
+ * - the concurrency: the number of posts per GagImageDownloader (9 is a page of the app),
+ *   the batches are downloaded one after the other,
+ * - the file: its size and type, images are downloaded like the list of posts does and
+ *   videos like a manual video download (streamed to the file),
+ * - the latency and the loss (responses cut off halfway) of the mock server.
+ *
+ * Each scenario reports the latency percentiles per file (from the request to the end of
+ * the reply), the aggregate throughput, the time the GUI thread was blocked (the delay of a
+ * 5 ms timer), the resident memory high-water mark, the download counter and throughput
+ * of the NetworkManager and the allocations per AllocScope (built with CONFIG+=allocprofile).
+ * Example:
+ *   XDG_CACHE_HOME=/tmp/bench ./bench_downloads -platform offscreen --concurrency 1,9 \
+ *       --files 51200:jpg,5242880:mp4 --latency 0,150 --loss 0,5
+ */
+
+static const int SCENARIO_TIMEOUT_MS = 600000;
+static const int STALL_TIMER_INTERVAL_MS = 5;
+
+struct Scenario {
+    int concurrency;
+    int fileBytes;
+    bool isVideo;
+    int latencyMs;
+    int lossPercent;
+};
+
+// Processes the events until \p condition is true. Returns false on a timeout.
+static bool waitUntil(const std::function<bool()> &condition, int timeoutMs)
+{
+    QTimer wakeUp;
+    wakeUp.start(50);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!condition()) {
+        if (timer.elapsed() > timeoutMs)
+            return false;
+
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+
+    return true;
+}
+
+static QList<int> intList(const QString &value)
+{
+    QList<int> list;
+    foreach (const QString &item, value.split(',', QString::SkipEmptyParts))
+        list.append(item.trimmed().toInt());
+    return list;
+}
+
+/*! Records the replies of a GagImageDownloader, which are its children. */
+class ReplyProbe : public QObject
+{
+public:
+    explicit ReplyProbe(QObject *parent = 0) : QObject(parent), failed(0), receivedBytes(0) {}
+
+    QVector<double> latencyMs;
+    int failed;
+    qint64 receivedBytes;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event);
+};
+
+bool ReplyProbe::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::ChildAdded) {
+        QNetworkReply *reply = qobject_cast<QNetworkReply *>(static_cast<QChildEvent *>(event)->child());
+
+        if (reply != 0) {
+            QSharedPointer<QElapsedTimer> timer(new QElapsedTimer);
+            timer->start();
+            QSharedPointer<qint64> bytes(new qint64(0));
+
+            connect(reply, &QNetworkReply::downloadProgress, this, [bytes](qint64 received, qint64) {
+                *bytes = received;
+            });
+            connect(reply, &QNetworkReply::finished, this, [this, reply, timer, bytes]() {
+                if (reply->error() == QNetworkReply::NoError) {
+                    latencyMs.append(timer->nsecsElapsed() / 1000000.0);
+                    receivedBytes += *bytes;
+                }
+                else {
+                    ++failed;
+                }
+            });
+        }
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
+/*! Measures how long the GUI thread doesn't process its events. */
+class StallProbe : public QObject
+{
+public:
+    StallProbe() : blockedMs(0), maxStallMs(0), peakRssKb(0), m_ticks(0)
+    {
+        m_timer.setTimerType(Qt::PreciseTimer);
+        m_timer.setInterval(STALL_TIMER_INTERVAL_MS);
+        connect(&m_timer, &QTimer::timeout, this, [this]() { onTimeout(); });
+        m_clock.start();
+        m_timer.start();
+    }
+
+    double blockedMs;
+    double maxStallMs;
+    qint64 peakRssKb;
+
+private:
+    void onTimeout()
+    {
+        const double elapsedMs = m_clock.nsecsElapsed() / 1000000.0;
+        m_clock.start();
+
+        const double stallMs = elapsedMs - STALL_TIMER_INTERVAL_MS;
+        if (stallMs > 1) {
+            blockedMs += stallMs;
+            maxStallMs = qMax(maxStallMs, stallMs);
+        }
+
+        // the memory is sampled as well in case the high-water mark can't be reset
+        if (++m_ticks % 10 == 0)
+            peakRssKb = qMax(peakRssKb, BenchmarkReport::residentMemoryKb());
+    }
+
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    int m_ticks;
+};
+
+static QJsonObject runScenario(const Scenario &scenario, int fileCount, int bandwidthKBps, int index)
+{
+    MockServer::Config config;
+    config.latencyMs = scenario.latencyMs;
+    config.dropRatePercent = scenario.lossPercent;
+    config.bandwidthKBps = bandwidthKBps;
+
+    BenchmarkServer server(config);
+    if (server.url().isEmpty())
+        return QJsonObject();
+
+    const QString mediaUrl = QString("%1/media/%2/s%3_").arg(server.url().toString()).arg(scenario.fileBytes).arg(index);
+
+    // a new NetworkManager per scenario, so that the throughput is measured for it alone
+    NetworkManager networkManager;
+    ReplyProbe replyProbe;
+    QList<GagObject> downloadedGags;
+
+    // the allocations are counted per scenario
+    MetricsRegistry::instance()->reset();
+    BenchmarkReport::resetPeakResidentMemory();
+    StallProbe stallProbe;
+
+    QElapsedTimer clock;
+    clock.start();
+
+    for (int first = 0; first < fileCount; first += scenario.concurrency) {
+        QList<GagObject> gags;
+
+        for (int i = first; i < qMin(first + scenario.concurrency, fileCount); ++i) {
+            GagObject gag;
+            gag.setId(QString::number(i));
+            gag.setImageUrl(QUrl(mediaUrl + QString::number(i) + ".jpg"));
+
+            if (scenario.isVideo) {
+                gag.setIsVideo(true);
+                gag.setVideoUrl(QUrl(mediaUrl + QString::number(i) + ".mp4"));
+            }
+
+            gags.append(gag);
+        }
+
+        GagImageDownloader downloader(&networkManager);
+        downloader.installEventFilter(&replyProbe);
+        downloader.setGagList(gags);
+        downloader.setDownloadVideo(scenario.isVideo);
+
+        bool finished = false;
+        QObject::connect(&downloader, &GagImageDownloader::finished, [&finished]() { finished = true; });
+        downloader.start();
+
+        if (!waitUntil([&finished]() { return finished; }, SCENARIO_TIMEOUT_MS)) {
+            qWarning("runScenario(): Timeout, aborting the downloads");
+            downloader.stop();
+            waitUntil([&finished]() { return finished; }, SCENARIO_TIMEOUT_MS);
+        }
+
+        downloadedGags.append(downloader.gagList());
+    }
+
+    const double totalMs = clock.nsecsElapsed() / 1000000.0;
+
+    QJsonObject object;
+    object.insert("concurrency", scenario.concurrency);
+    object.insert("fileBytes", scenario.fileBytes);
+    object.insert("type", QString(scenario.isVideo ? "mp4" : "jpg"));
+    object.insert("latencyMs", scenario.latencyMs);
+    object.insert("lossPercent", scenario.lossPercent);
+    object.insert("files", fileCount);
+    object.insert("completed", replyProbe.latencyMs.count());
+    object.insert("failed", replyProbe.failed);
+    object.insert("fileLatencyMs", BenchmarkReport::summary(replyProbe.latencyMs));
+    object.insert("totalMs", totalMs);
+    object.insert("receivedBytes", replyProbe.receivedBytes);
+    object.insert("throughputBytesPerSecond", totalMs > 0 ? replyProbe.receivedBytes * 1000.0 / totalMs : 0.0);
+    object.insert("guiBlockedMs", stallProbe.blockedMs);
+    object.insert("guiMaxStallMs", stallProbe.maxStallMs);
+    object.insert("peakRssKb", qMax(stallProbe.peakRssKb, BenchmarkReport::peakResidentMemoryKb()));
+    object.insert("networkManagerDownloadMb", networkManager.downloadCounter().toDouble());
+    object.insert("networkManagerThroughputBytesPerSecond", networkManager.throughput());
+    object.insert("allocations", BenchmarkReport::allocations(MetricsRegistry::instance()->snapshot()));
+
+    // the downloaded files are removed, so that the scenarios don't fill the cache
+    QThreadPool::globalInstance()->waitForDone();
+    foreach (const GagObject &gag, downloadedGags) {
+        foreach (const QUrl &url, QList<QUrl>() << gag.imageUrl() << gag.videoUrl() << gag.thumbnailUrl()) {
+            if (url.isLocalFile())
+                QFile::remove(url.toLocalFile());
+        }
+    }
+
+    return object;
+}
+
+int main(int argc, char *argv[])
+{
+    // the image downloads create thumbnails, which need QtGui
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("gagbook-bench");
+    app.setOrganizationName("gagbook-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark of the download pipeline against the mock server");
+    parser.addHelpOption();
+
+    const QCommandLineOption countOption("count", "The number of files per scenario.", "count", "50");
+    const QCommandLineOption concurrencyOption("concurrency", "The posts per downloader, comma separated.",
+                                               "list", "1,9,50");
+    const QCommandLineOption filesOption("files", "The files as <bytes>:<jpg|mp4>, comma separated.", "list",
+                                         "51200:jpg,512000:jpg,1048576:mp4,5242880:mp4");
+    const QCommandLineOption latencyOption("latency", "The latencies in ms, comma separated.", "list", "0,150");
+    const QCommandLineOption lossOption("loss", "The percentages of cut off responses, comma separated.",
+                                        "list", "0,5");
+    const QCommandLineOption bandwidthOption("bandwidth", "The bandwidth in KB/s (0 is unlimited).", "value", "0");
+    const QCommandLineOption outputOption("output", "Write the report to <file> instead of stdout.", "file");
+    parser.addOption(countOption);
+    parser.addOption(concurrencyOption);
+    parser.addOption(filesOption);
+    parser.addOption(latencyOption);
+    parser.addOption(lossOption);
+    parser.addOption(bandwidthOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    MetricsRegistry metricsRegistry;
+    FileIoWorker fileIoWorker;
+    GagImageDownloader::initializeCache();
+
+    QList<Scenario> scenarios;
+    foreach (int concurrency, intList(parser.value(concurrencyOption))) {
+        foreach (const QString &file, parser.value(filesOption).split(',', QString::SkipEmptyParts)) {
+            foreach (int latency, intList(parser.value(latencyOption))) {
+                foreach (int loss, intList(parser.value(lossOption))) {
+                    Scenario scenario;
+                    scenario.concurrency = qMax(1, concurrency);
+                    scenario.fileBytes = file.section(':', 0, 0).toInt();
+                    scenario.isVideo = file.section(':', 1, 1) == "mp4";
+                    scenario.latencyMs = latency;
+                    scenario.lossPercent = loss;
+                    scenarios.append(scenario);
+                }
+            }
+        }
+    }
+
+    QJsonArray results;
+    for (int i = 0; i < scenarios.count(); ++i) {
+        results.append(runScenario(scenarios.at(i), parser.value(countOption).toInt(),
+                                   parser.value(bandwidthOption).toInt(), i));
+    }
+
+    QJsonObject report;
+    report.insert("benchmark", QString("downloads"));
+    report.insert("scenarios", results);
+
+    return BenchmarkReport::write(report, parser.value(outputOption)) ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <QtTest/QtTest>
+#include <QtGui/QImage>
+
+#include "src/imagescaler.h"
+
+/*
+ * Compares ImageScaler with QImage::scaled(Qt::SmoothTransformation) on the image sizes which
+ * are scaled down by the app: long images saved to the gallery, photos and thumbnails.
+ * Build with CONFIG+=nosimd to measure the scalar fallback of ImageScaler.
+ */
+class BenchImageScaler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void imageScaler_data();
+    void imageScaler();
+    void qimageSmooth_data();
+    void qimageSmooth();
+
+private:
+    void addRows();
+};
+
+static QImage testImage(const QSize &size, bool hasAlpha)
+{
+    QImage image(size, hasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+    // a gradient with some noise, so that the image is neither uniform nor random
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+
+        for (int x = 0; x < image.width(); ++x) {
+            const int alpha = hasAlpha ? (x + y) % 256 : 255;
+            line[x] = qPremultiply(qRgba((x * 7) & 0xff, (y * 3) & 0xff, (x ^ y) & 0xff, alpha));
+        }
+    }
+
+    return image;
+}
+
+void BenchImageScaler::addRows()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QSize>("targetSize");
+    QTest::addColumn<bool>("hasAlpha");
+
+    QTest::newRow("long image 1080x12000 -> 1080x4096") << QSize(1080, 12000) << QSize(368, 4096) << false;
+    QTest::newRow("long image 1080x12000 -> 540x6000") << QSize(1080, 12000) << QSize(540, 6000) << false;
+    QTest::newRow("photo 4000x3000 -> 1000x750") << QSize(4000, 3000) << QSize(1000, 750) << false;
+    QTest::newRow("photo 4000x3000 -> 1333x1000") << QSize(4000, 3000) << QSize(1333, 1000) << false;
+    QTest::newRow("thumbnail 1080x1080 -> 135x135") << QSize(1080, 1080) << QSize(135, 135) << false;
+    QTest::newRow("alpha 2000x2000 -> 500x500") << QSize(2000, 2000) << QSize(500, 500) << true;
+}
+
+void BenchImageScaler::imageScaler_data()
+{
+    addRows();
+}
+
+void BenchImageScaler::imageScaler()
+{
+    QFETCH(QSize, size);
+    QFETCH(QSize, targetSize);
+    QFETCH(bool, hasAlpha);
+
+    const QImage image = testImage(size, hasAlpha);
+    QImage result;
+
+    QBENCHMARK {
+        result = ImageScaler::scaled(image, targetSize);
+    }
+
+    QCOMPARE(result.size(), targetSize);
+}
+
+void BenchImageScaler::qimageSmooth_data()
+{
+    addRows();
+}
+
+void BenchImageScaler::qimageSmooth()
+{
+    QFETCH(QSize, size);
+    QFETCH(QSize, targetSize);
+    QFETCH(bool, hasAlpha);
+
+    const QImage image = testImage(size, hasAlpha);
+    QImage result;
+
+    QBENCHMARK {
+        result = image.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QCOMPARE(result.size(), targetSize);
+}
+
+QTEST_GUILESS_MAIN(BenchImageScaler)
+
+#include "tst_bench_imagescaler.moc"
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <functional>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+#include <QtGui/QGuiApplication>
+
+#include "src/appsettings.h"
+#include "src/commentmodel.h"
+#include "src/fileioworker.h"
+#include "src/gagbookmanager.h"
+#include "src/gagmodel.h"
+#include "src/metricsregistry.h"
+#include "tests/shared/benchmarkreport.h"
+#include "tests/shared/benchmarkserver.h"
+
+/*
+ * Drives GagModel and CommentModel against the mock server as the list views of the app do
+ * and prints a JSON report:
+ * - the time from the refresh to the first row and the rows per second while the GagModel is
+ *   scrolled to --rows posts (a page is requested as soon as the previous one is appended),
+ * - the cost of the row insertion and of reading all roles of the new rows (the delegates),
+ * - the cost of data() per role,
+ * - the dataChanged() fan-out: the roles that are signalled, the data() reads of a view which
+ *   re-evaluates them and what the reads would cost if all roles were signalled,
+ * - the allocations per AllocScope of each model (built with CONFIG+=allocprofile),
+ * - the resident memory at the start and its high-water mark.
+ *
+ * The cache of the downloaded images is in the cache location of the user, run with a
+ * separate XDG_CACHE_HOME to keep it apart from the one of the app, e.g.
+ *   XDG_CACHE_HOME=/tmp/bench ./bench_models -platform offscreen --rows 1000 --latency 50
+ */
+
+static const int PAGE_TIMEOUT_MS = 120000;
+
+// Processes the events until \p condition is true. Returns false on a timeout.
+static bool waitUntil(const std::function<bool()> &condition, int timeoutMs)
+{
+    QTimer wakeUp;
+    wakeUp.start(50);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!condition()) {
+        if (timer.elapsed() > timeoutMs)
+            return false;
+
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+
+    return true;
+}
+
+static double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+/*! Records the signals of a model and reads the roles like a view with one binding per role. */
+class ModelProbe
+{
+public:
+    explicit ModelProbe(QAbstractItemModel *model);
+
+    /*! Start the clock of timeToFirstRowMs. */
+    void start();
+
+    /*! Get the report of the recorded signals. */
+    QJsonObject report() const;
+
+    /*! Get the cost of data() per role of the top-level rows in ns. */
+    QJsonObject dataCostPerRole() const;
+
+    /*! Get the context of the connections, which are removed with the probe. */
+    QObject *context();
+
+    int errors;
+
+private:
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+
+    QObject m_context;
+    QAbstractItemModel *m_model;
+    QVector<int> m_roles;
+    QElapsedTimer m_clock;
+    QElapsedTimer m_insertTimer;
+    double m_timeToFirstRowMs;
+
+    QVector<double> m_insertMs;         // from rowsAboutToBeInserted() to rowsInserted()
+    QVector<double> m_delegateMs;       // reading all roles of the inserted rows
+    qint64 m_insertedRows;
+
+    qint64 m_dataChangedSignals;
+    qint64 m_signalledRoles;
+    qint64 m_signalledRolesIfUnnarrowed;
+    double m_dataChangedReadMs;
+    double m_dataChangedReadMsIfUnnarrowed;
+};
+
+ModelProbe::ModelProbe(QAbstractItemModel *model)
+    : errors(0), m_model(model), m_roles(model->roleNames().keys().toVector()), m_timeToFirstRowMs(-1),
+      m_insertedRows(0), m_dataChangedSignals(0), m_signalledRoles(0), m_signalledRolesIfUnnarrowed(0),
+      m_dataChangedReadMs(0), m_dataChangedReadMsIfUnnarrowed(0)
+{
+    QObject::connect(model, &QAbstractItemModel::rowsAboutToBeInserted, &m_context, [this]() {
+        m_insertTimer.start();
+    });
+    QObject::connect(model, &QAbstractItemModel::rowsInserted, &m_context,
+                     [this](const QModelIndex &parent, int first, int last) { onRowsInserted(parent, first, last); });
+    QObject::connect(model, &QAbstractItemModel::dataChanged, &m_context,
+                     [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles) {
+        onDataChanged(topLeft, bottomRight, roles);
+    });
+}
+
+QObject *ModelProbe::context()
+{
+    return &m_context;
+}
+
+void ModelProbe::start()
+{
+    m_clock.start();
+    m_timeToFirstRowMs = -1;
+}
+
+void ModelProbe::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    m_insertMs.append(elapsedMs(m_insertTimer));
+
+    if (m_timeToFirstRowMs < 0 && !parent.isValid())
+        m_timeToFirstRowMs = elapsedMs(m_clock);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0, parent);
+        foreach (int role, m_roles)
+            m_model->data(index, role);
+    }
+
+    m_delegateMs.append(elapsedMs(timer));
+    m_insertedRows += last - first + 1;
+}
+
+void ModelProbe::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                               const QVector<int> &roles)
+{
+    const QVector<int> &changedRoles = roles.isEmpty() ? m_roles : roles;
+    const int rowCount = bottomRight.row() - topLeft.row() + 1;
+
+    ++m_dataChangedSignals;
+    m_signalledRoles += qint64(changedRoles.count()) * rowCount;
+    m_signalledRolesIfUnnarrowed += qint64(m_roles.count()) * rowCount;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = m_model->index(row, 0, topLeft.parent());
+        foreach (int role, changedRoles)
+            m_model->data(index, role);
+    }
+
+    m_dataChangedReadMs += elapsedMs(timer);
+    timer.start();
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = m_model->index(row, 0, topLeft.parent());
+        foreach (int role, m_roles)
+            m_model->data(index, role);
+    }
+
+    m_dataChangedReadMsIfUnnarrowed += elapsedMs(timer);
+}
+
+QJsonObject ModelProbe::report() const
+{
+    QJsonObject dataChanged;
+    dataChanged.insert("signals", m_dataChangedSignals);
+    dataChanged.insert("roleReads", m_signalledRoles);
+    dataChanged.insert("roleReadsIfUnnarrowed", m_signalledRolesIfUnnarrowed);
+    dataChanged.insert("readMs", m_dataChangedReadMs);
+    dataChanged.insert("readMsIfUnnarrowed", m_dataChangedReadMsIfUnnarrowed);
+
+    QJsonObject object;
+    object.insert("timeToFirstRowMs", m_timeToFirstRowMs);
+    object.insert("insertedRows", m_insertedRows);
+    object.insert("insertMs", BenchmarkReport::summary(m_insertMs));
+    object.insert("delegateReadMs", BenchmarkReport::summary(m_delegateMs));
+    object.insert("dataChanged", dataChanged);
+    object.insert("dataNsPerCall", dataCostPerRole());
+    object.insert("errors", errors);
+    return object;
+}
+
+QJsonObject ModelProbe::dataCostPerRole() const
+{
+    QJsonObject object;
+    const int rowCount = m_model->rowCount(QModelIndex());
+    if (rowCount == 0)
+        return object;
+
+    // at least 100000 calls per role, so that the clock resolution doesn't matter
+    const int passes = qMax(1, 100000 / rowCount);
+    const QHash<int, QByteArray> roleNames = m_model->roleNames();
+
+    foreach (int role, m_roles) {
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int pass = 0; pass < passes; ++pass) {
+            for (int row = 0; row < rowCount; ++row)
+                m_model->data(m_model->index(row, 0), role);
+        }
+
+        object.insert(QString::fromLatin1(roleNames.value(role)), double(timer.nsecsElapsed()) / (passes * rowCount));
+    }
+
+    return object;
+}
+
+// Scrolls the GagModel to \p targetRows posts
+static QJsonObject benchGagModel(GagBookManager *manager, int targetRows, bool dataSaver, QUrl *firstPostUrl)
+{
+    GagModel model;
+    model.setManager(manager);
+
+    ModelProbe probe(&model);
+    QObject::connect(&model, &GagModel::refreshFailure, probe.context(), [&probe]() { ++probe.errors; });
+
+    // the data saver downloads the media of the rows when they become visible
+    if (dataSaver) {
+        QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&model](const QModelIndex &, int first, int last) {
+            for (int row = first; row <= last; ++row)
+                model.requestMedia(row);
+        });
+    }
+
+    // the allocations are counted per model
+    MetricsRegistry::instance()->reset();
+
+    QElapsedTimer clock;
+    clock.start();
+    probe.start();
+    model.refresh(GagModel::RefreshAll);
+
+    int pages = 0;
+    int emptyPages = 0;
+    qint64 peakRssKb = BenchmarkReport::residentMemoryKb();
+
+    while (model.rowCount(QModelIndex()) < targetRows) {
+        const int rowCount = model.rowCount(QModelIndex());
+
+        if (!waitUntil([&model]() { return !model.isBusy(); }, PAGE_TIMEOUT_MS)) {
+            qWarning("benchGagModel(): Timeout after %d rows", rowCount);
+            break;
+        }
+
+        peakRssKb = qMax(peakRssKb, BenchmarkReport::residentMemoryKb());
+
+        // the end of the list or repeated failures
+        if (model.rowCount(QModelIndex()) > rowCount)
+            emptyPages = 0;
+        else if (++emptyPages > 3)
+            break;
+
+        ++pages;
+        model.refresh(GagModel::RefreshOlder);
+    }
+
+    waitUntil([&model]() { return !model.isBusy(); }, PAGE_TIMEOUT_MS);
+    const double totalMs = elapsedMs(clock);
+    const int rows = model.rowCount(QModelIndex());
+
+    if (dataSaver) {
+        waitUntil([&model, rows]() {
+            for (int row = 0; row < rows; ++row) {
+                if (model.data(model.index(row), GagModel::IsDownloadingRole).toBool())
+                    return false;
+            }
+            return true;
+        }, PAGE_TIMEOUT_MS);
+    }
+
+    // votes on every 10th post
+    for (int row = 0; row < rows; row += 10)
+        model.changeLikes(model.data(model.index(row), GagModel::IdRole).toString(), 1);
+
+    if (rows > 0)
+        *firstPostUrl = model.data(model.index(0), GagModel::UrlRole).toUrl();
+
+    QJsonObject object = probe.report();
+    object.insert("rows", rows);
+    object.insert("pages", pages);
+    object.insert("totalMs", totalMs);
+    object.insert("rowsPerSecond", totalMs > 0 ? rows * 1000.0 / totalMs : 0.0);
+    object.insert("peakRssKb", peakRssKb);
+    object.insert("allocations", BenchmarkReport::allocations(MetricsRegistry::instance()->snapshot()));
+    return object;
+}
+
+// Loads all top-level comments of the post \p gagUrl page by page
+static QJsonObject benchCommentModel(GagBookManager *manager, QUrl gagUrl)
+{
+    CommentModel model;
+    model.setManager(manager);
+    model.setGagUrl(gagUrl);
+
+    ModelProbe probe(&model);
+    QObject::connect(&model, &CommentModel::loadingFailure, probe.context(), [&probe]() { ++probe.errors; });
+
+    // fetchMore() is called through the base class like the views do
+    QAbstractItemModel *itemModel = &model;
+    const auto isIdle = [&model]() {
+        const CommentModel::LoadingStatus status = model.loadingStatus();
+        return status == CommentModel::Idle || status == CommentModel::FetchMoreFailure
+                || status == CommentModel::RefreshFailure;
+    };
+
+    MetricsRegistry::instance()->reset();
+
+    QElapsedTimer clock;
+    clock.start();
+    probe.start();
+    model.refresh();
+
+    int pages = 1;
+    while (waitUntil(isIdle, PAGE_TIMEOUT_MS) && probe.errors <= 10 && itemModel->canFetchMore(QModelIndex())) {
+        ++pages;
+        itemModel->fetchMore(QModelIndex());
+    }
+
+    const double totalMs = elapsedMs(clock);
+
+    QJsonObject object = probe.report();
+    object.insert("rows", model.rowCount(QModelIndex()));
+    object.insert("comments", model.currentCommentCount());
+    object.insert("pages", pages);
+    object.insert("totalMs", totalMs);
+    object.insert("rowsPerSecond", totalMs > 0 ? model.currentCommentCount() * 1000.0 / totalMs : 0.0);
+    object.insert("allocations", BenchmarkReport::allocations(MetricsRegistry::instance()->snapshot()));
+    return object;
+}
+
+int main(int argc, char *argv[])
+{
+    // the image downloads create thumbnails and video posters, which need QtGui
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("gagbook-bench");
+    app.setOrganizationName("gagbook-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark of GagModel and CommentModel against the mock server");
+    parser.addHelpOption();
+
+    const QCommandLineOption rowsOption("rows", "The number of posts to scroll through.", "count", "1000");
+    const QCommandLineOption dataSaverOption("data-saver", "Download the media of the rows lazily.");
+    const QCommandLineOption outputOption("output", "Write the report to <file> instead of stdout.", "file");
+    parser.addOption(rowsOption);
+    parser.addOption(dataSaverOption);
+    parser.addOption(outputOption);
+
+    // the settings of the mock server, see MockServer::Config
+    const QStringList serverSettings = QStringList() << "latency" << "jitter" << "bandwidth" << "error-rate"
+                                                     << "drop-rate" << "image-size" << "video-size"
+                                                     << "comment-count" << "comment-depth" << "comment-replies";
+    foreach (const QString &setting, serverSettings)
+        parser.addOption(QCommandLineOption(setting, "The " + setting + " of the mock server.", "value"));
+
+    parser.process(app);
+
+    MockServer::Config config;
+    config.postCount = parser.value(rowsOption).toInt();
+    config.commentDepth = 2;    // the app requests 2 levels
+    foreach (const QString &setting, serverSettings) {
+        if (parser.isSet(setting))
+            config.set(setting, parser.value(setting).toInt());
+    }
+
+    const qint64 startRssKb = BenchmarkReport::residentMemoryKb();
+
+    MetricsRegistry metricsRegistry;
+    FileIoWorker fileIoWorker;
+
+    BenchmarkServer server(config);
+    if (server.url().isEmpty())
+        return 1;
+    server.setEnvironment();
+
+    AppSettings settings;
+    settings.setDataSaver(parser.isSet(dataSaverOption));
+
+    GagBookManager manager;
+    manager.setSettings(&settings);
+
+    QUrl firstPostUrl;
+    const QJsonObject gagModel = benchGagModel(&manager, config.postCount, settings.dataSaver(), &firstPostUrl);
+    const QJsonObject commentModel = benchCommentModel(&manager, firstPostUrl);
+
+    QThreadPool::globalInstance()->waitForDone();
+
+    QJsonObject memory;
+    memory.insert("startRssKb", startRssKb);
+    memory.insert("peakRssKb", BenchmarkReport::peakResidentMemoryKb());
+
+    QJsonObject report;
+    report.insert("benchmark", QString("models"));
+    report.insert("server", config.toJson());
+    report.insert("dataSaver", settings.dataSaver());
+    report.insert("gagModel", gagModel);
+    report.insert("commentModel", commentModel);
+    report.insert("memory", memory);
+
+    return BenchmarkReport::write(report, parser.value(outputOption)) ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+TARGET = bench_models
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# the app sources without sailfishapp, run headless with "-platform offscreen"
+include(../../../src/src.pri)
+
+INCLUDEPATH += ../../..
+
+HEADERS += \
+    ../../mockserver/mockserver.h \
+    ../../shared/apifixtures.h \
+    ../../shared/benchmarkreport.h \
+    ../../shared/benchmarkserver.h
+
+SOURCES += bench_models.cpp \
+    ../../mockserver/mockserver.cpp \
+    ../../shared/apifixtures.cpp \
+    ../../shared/benchmarkreport.cpp \
+    ../../shared/benchmarkserver.cpp
@@ -0,0 +1,20 @@
+TARGET = tst_bench_parser
+
+QT += testlib
+
+CONFIG += testcase c++11 console
+CONFIG -= app_bundle
+
+# the app sources, QTextDocument of the parser needs a QGuiApplication, e.g. run with
+# "-platform offscreen"; qmake CONFIG+=allocprofile records the allocations per parse
+include(../../../src/src.pri)
+
+INCLUDEPATH += ../../..
+
+HEADERS += \
+    ../../shared/apifixtures.h \
+    ../../shared/benchmarkreport.h
+
+SOURCES += tst_bench_parser.cpp \
+    ../../shared/apifixtures.cpp \
+    ../../shared/benchmarkreport.cpp
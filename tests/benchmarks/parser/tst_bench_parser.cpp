@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <QtTest/QtTest>
+
+#include "src/allocprofiler.h"
+#include "src/commentobject.h"
+#include "src/metricsregistry.h"
+#include "src/networkmanager.h"
+#include "src/ninegagapirequest.h"
+#include "tests/shared/apifixtures.h"
+#include "tests/shared/benchmarkreport.h"
+
+/*
+ * Measures NineGagApiRequest::parseGags() and parseComments() on the responses of ApiFixtures:
+ * pages of 9 (the page size of the app), 50 and 500 posts and flat and nested comment lists.
+ * Built with CONFIG+=allocprofile, the allocations per parse are logged for each row and
+ * written as JSON to the file given by GAGBOOK_ALLOC_REPORT_FILE, e.g.
+ *   GAGBOOK_ALLOC_REPORT_FILE=allocations.json ./tst_bench_parser -platform offscreen
+ */
+class ParserHarness : public NineGagApiRequest
+{
+public:
+    explicit ParserHarness(NetworkManager *networkManager) : NineGagApiRequest(networkManager) {}
+
+    using NineGagApiRequest::parseGags;
+    using NineGagApiRequest::parseComments;
+};
+
+class BenchParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void parseGags_data();
+    void parseGags();
+    void parseComments_data();
+    void parseComments();
+
+private:
+    void recordAllocations(const QString &scope);
+
+    MetricsRegistry *m_metrics;
+    NetworkManager *m_networkManager;
+    ParserHarness *m_parser;
+    QJsonObject m_allocations;  // by test function and row
+};
+
+void BenchParser::initTestCase()
+{
+    // the login of the constructor must not reach the real API
+    qputenv("GAGBOOK_API_URL", "http://127.0.0.1:9");
+
+    m_metrics = new MetricsRegistry(this);
+    m_networkManager = new NetworkManager(this);
+    m_parser = new ParserHarness(m_networkManager);
+}
+
+void BenchParser::cleanupTestCase()
+{
+    const QString allocationFile = QFile::decodeName(qgetenv("GAGBOOK_ALLOC_REPORT_FILE"));
+    if (!allocationFile.isEmpty()) {
+        QJsonObject report;
+        report.insert("benchmark", QString("parser"));
+        report.insert("allocations", m_allocations);
+        QVERIFY(BenchmarkReport::write(report, allocationFile));
+    }
+
+    delete m_parser;
+    delete m_networkManager;
+    delete m_metrics;
+}
+
+void BenchParser::parseGags_data()
+{
+    QTest::addColumn<QByteArray>("response");
+
+    const QString mediaBaseUrl("http://127.0.0.1:8080");
+    QTest::newRow("9 posts") << ApiFixtures::postList(9, 0, mediaBaseUrl);
+    QTest::newRow("50 posts") << ApiFixtures::postList(50, 0, mediaBaseUrl);
+    QTest::newRow("500 posts") << ApiFixtures::postList(500, 0, mediaBaseUrl);
+}
+
+void BenchParser::parseGags()
+{
+    QFETCH(QByteArray, response);
+
+    m_metrics->reset();
+    QList<GagObject> gags;
+
+    QBENCHMARK {
+        gags = m_parser->parseGags(response);
+    }
+
+    QVERIFY(!gags.isEmpty());
+    recordAllocations("parseGags");
+}
+
+void BenchParser::parseComments_data()
+{
+    QTest::addColumn<QByteArray>("response");
+    QTest::addColumn<int>("expectedCount");
+
+    // the app fetches 10 top-level comments per page with the replies of 2 levels
+    const QString mediaBaseUrl("http://127.0.0.1:8080");
+    QTest::newRow("flat 10") << ApiFixtures::commentList(10, 0, 1, 0, 100, mediaBaseUrl) << 10;
+    QTest::newRow("flat 200") << ApiFixtures::commentList(200, 0, 1, 0, 1000, mediaBaseUrl) << 200;
+    QTest::newRow("nested 10x2x5") << ApiFixtures::commentList(10, 0, 2, 5, 100, mediaBaseUrl) << 10;
+    QTest::newRow("nested 10x5x3") << ApiFixtures::commentList(10, 0, 5, 3, 1210, mediaBaseUrl) << 10;
+}
+
+void BenchParser::parseComments()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(int, expectedCount);
+
+    m_metrics->reset();
+    CommentObject rootComment;
+    CommentArena arena;
+    int count = 0;
+
+    // including the release of the comments, as when the CommentModel is reset
+    QBENCHMARK {
+        count = m_parser->parseComments(response, &rootComment, &arena).count();
+        arena.clear();
+    }
+
+    QCOMPARE(count, expectedCount);
+    recordAllocations("parseComments");
+}
+
+void BenchParser::recordAllocations(const QString &scope)
+{
+#ifdef GAGBOOK_ALLOC_PROFILE
+    const QJsonObject allocations = BenchmarkReport::allocations(m_metrics->snapshot()).value(scope).toObject();
+    if (allocations.value("calls").toDouble() > 0) {
+        qDebug("%s: %.0f allocations, %.0f bytes per parse", qPrintable(scope),
+               allocations.value("countPerCall").toDouble(), allocations.value("bytesPerCall").toDouble());
+        m_allocations.insert(QString("%1/%2").arg(QTest::currentTestFunction(), QTest::currentDataTag()),
+                             allocations);
+    }
+#else
+    Q_UNUSED(scope)
+#endif
+}
+
+QTEST_MAIN(BenchParser)
+
+#include "tst_bench_parser.moc"
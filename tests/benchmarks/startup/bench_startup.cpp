@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QProcess>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTemporaryDir>
+#include <QtGui/QGuiApplication>
+
+#include "tests/shared/benchmarkreport.h"
+#include "tests/shared/benchmarkserver.h"
+
+/*
+ * Launches the app --runs times headless against the mock server and prints a JSON report
+ * of its startup timeline (see StartupProfiler): the percentiles of each milestone in ms
+ * since the start of the process and of the wall time until the app has quit.
+ *
+ * The app is started with GAGBOOK_EXIT_AFTER_STARTUP, so that it quits as soon as the
+ * timeline is complete, and with the offscreen platform. A run which doesn't complete the
+ * timeline within --timeout is killed and counted as failed. Each run gets empty XDG
+ * directories (a cold start without settings and cached images) unless --warm is given,
+ * in which case the runs share them after a first run which is not measured. The app must
+ * be installed, as SailfishApp loads the QML files from its install location, e.g.
+ *   ./bench_startup -platform offscreen --app /usr/bin/harbour-gagbook --runs 20 --latency 50
+ */
+
+static const char TIMELINE_HEADER[] = "StartupProfiler: Startup timeline";
+
+/*! The XDG directories of the app for one or more runs. */
+class AppDirectories
+{
+public:
+    bool isValid() const { return m_root.isValid(); }
+
+    void insertInto(QProcessEnvironment *environment) const
+    {
+        foreach (const QString &name, QStringList() << "XDG_CACHE_HOME" << "XDG_CONFIG_HOME" << "XDG_DATA_HOME") {
+            const QString path = m_root.path() + '/' + name.toLower();
+            QDir().mkpath(path);
+            environment->insert(name, path);
+        }
+    }
+
+private:
+    QTemporaryDir m_root;
+};
+
+/*! One launch of the app. */
+struct Run {
+    bool completed;
+    double wallMs;
+    QList<QPair<QString, double> > timeline;
+};
+
+// Parses the timeline logged by StartupProfiler::logTimeline() from the output of the app
+static QList<QPair<QString, double> > parseTimeline(const QByteArray &output)
+{
+    static const QRegularExpression milestoneLine("^(\\d+)  (.+)$");
+
+    QList<QPair<QString, double> > timeline;
+    bool inTimeline = false;
+
+    foreach (const QByteArray &rawLine, output.split('\n')) {
+        const QString line = QString::fromLocal8Bit(rawLine).trimmed();
+
+        if (line.startsWith(TIMELINE_HEADER)) {
+            inTimeline = true;
+            timeline.clear();
+            continue;
+        }
+
+        if (!inTimeline)
+            continue;
+
+        const QRegularExpressionMatch match = milestoneLine.match(line);
+        if (!match.hasMatch()) {
+            inTimeline = false;
+            continue;
+        }
+
+        if (match.captured(2) != "process start")
+            timeline.append(qMakePair(match.captured(2), match.captured(1).toDouble()));
+    }
+
+    return timeline;
+}
+
+static Run launch(const QString &app, const QProcessEnvironment &environment, int timeoutMs)
+{
+    Run run;
+    run.completed = false;
+
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.setProcessEnvironment(environment);
+
+    // the server runs on its own thread, so that the process can be waited for here
+    QElapsedTimer clock;
+    clock.start();
+    process.start(app, QStringList());
+
+    if (!process.waitForStarted(timeoutMs)) {
+        qWarning("launch(): Unable to start %s: %s", qPrintable(app), qPrintable(process.errorString()));
+        run.wallMs = 0;
+        return run;
+    }
+
+    if (!process.waitForFinished(timeoutMs)) {
+        qWarning("launch(): The startup has not been completed within %d ms, killing the app", timeoutMs);
+        process.kill();
+        process.waitForFinished();
+    }
+
+    run.wallMs = clock.nsecsElapsed() / 1000000.0;
+
+    const QByteArray output = process.readAll();
+    run.timeline = parseTimeline(output);
+    run.completed = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0
+            && output.contains(TIMELINE_HEADER) && !output.contains("has not been completed");
+
+    return run;
+}
+
+int main(int argc, char *argv[])
+{
+    // QGuiApplication for the JPEG encoder of the mock server
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("gagbook-bench");
+    app.setOrganizationName("gagbook-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark of the startup of the app against the mock server");
+    parser.addHelpOption();
+
+    const QCommandLineOption appOption("app", "The executable of the app.", "file", "harbour-gagbook");
+    const QCommandLineOption runsOption("runs", "The number of launches.", "count", "10");
+    const QCommandLineOption timeoutOption("timeout", "The time in ms after which a launch is killed.",
+                                           "ms", "60000");
+    const QCommandLineOption warmOption("warm", "Keep the settings and the cache between the launches.");
+    const QCommandLineOption outputOption("output", "Write the report to <file> instead of stdout.", "file");
+    parser.addOption(appOption);
+    parser.addOption(runsOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(warmOption);
+    parser.addOption(outputOption);
+
+    // the settings of the mock server, see MockServer::Config
+    const QStringList serverSettings = QStringList() << "latency" << "jitter" << "bandwidth" << "error-rate"
+                                                     << "drop-rate" << "image-size" << "video-size";
+    foreach (const QString &setting, serverSettings)
+        parser.addOption(QCommandLineOption(setting, "The " + setting + " of the mock server.", "value"));
+
+    parser.process(app);
+
+    MockServer::Config config;
+    foreach (const QString &setting, serverSettings) {
+        if (parser.isSet(setting))
+            config.set(setting, parser.value(setting).toInt());
+    }
+
+    BenchmarkServer server(config);
+    if (server.url().isEmpty())
+        return 1;
+
+    server.setEnvironment();
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("GAGBOOK_EXIT_AFTER_STARTUP", "1");
+    environment.insert("QT_QPA_PLATFORM", "offscreen");
+    // the timeline is logged with qDebug(), which must not be filtered or decorated
+    environment.insert("QT_LOGGING_RULES", "default.debug=true");
+    environment.insert("QT_MESSAGE_PATTERN", "%{message}");
+
+    const QString appPath = parser.value(appOption);
+    const int timeoutMs = parser.value(timeoutOption).toInt();
+    const bool warm = parser.isSet(warmOption);
+
+    QSharedPointer<AppDirectories> directories;
+    if (warm) {
+        directories.reset(new AppDirectories);
+        if (!directories->isValid()) {
+            qWarning("main(): Unable to create the directories of the app");
+            return 1;
+        }
+        directories->insertInto(&environment);
+
+        // the first launch fills the cache and the settings
+        if (!launch(appPath, environment, timeoutMs).completed)
+            qWarning("main(): The warm-up launch has not been completed");
+    }
+
+    QStringList milestones;
+    QHash<QString, QVector<double> > milestoneMs;
+    QVector<double> wallMs;
+    int failed = 0;
+
+    for (int i = 0; i < parser.value(runsOption).toInt(); ++i) {
+        QProcessEnvironment runEnvironment = environment;
+        if (!warm) {
+            directories.reset(new AppDirectories);
+            if (!directories->isValid()) {
+                qWarning("main(): Unable to create the directories of the app");
+                return 1;
+            }
+            directories->insertInto(&runEnvironment);
+        }
+
+        const Run run = launch(appPath, runEnvironment, timeoutMs);
+        if (!run.completed) {
+            ++failed;
+            continue;
+        }
+
+        wallMs.append(run.wallMs);
+
+        QList<QPair<QString, double> >::const_iterator j = run.timeline.constBegin();
+        for (; j != run.timeline.constEnd(); ++j) {
+            if (!milestones.contains(j->first))
+                milestones.append(j->first);
+            milestoneMs[j->first].append(j->second);
+        }
+    }
+
+    // the milestones in the order of the first run
+    QJsonArray timeline;
+    foreach (const QString &milestone, milestones) {
+        QJsonObject object;
+        object.insert("milestone", milestone);
+        object.insert("ms", BenchmarkReport::summary(milestoneMs.value(milestone)));
+        timeline.append(object);
+    }
+
+    QJsonObject report;
+    report.insert("benchmark", QString("startup"));
+    report.insert("server", config.toJson());
+    report.insert("warm", warm);
+    report.insert("runs", parser.value(runsOption).toInt());
+    report.insert("failed", failed);
+    report.insert("timeline", timeline);
+    report.insert("wallMs", BenchmarkReport::summary(wallMs));
+
+    return BenchmarkReport::write(report, parser.value(outputOption)) ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+TARGET = bench_startup
+
+# launches the installed app (see --app), so only the mock server is built in
+QT += core gui network
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../..
+
+HEADERS += \
+    ../../mockserver/mockserver.h \
+    ../../shared/apifixtures.h \
+    ../../shared/benchmarkreport.h \
+    ../../shared/benchmarkserver.h
+
+SOURCES += bench_startup.cpp \
+    ../../mockserver/mockserver.cpp \
+    ../../shared/apifixtures.cpp \
+    ../../shared/benchmarkreport.cpp \
+    ../../shared/benchmarkserver.cpp
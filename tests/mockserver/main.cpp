@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+
+#include <QtCore/QCommandLineParser>
+#include <QtNetwork/QHostAddress>
+#include <QtGui/QGuiApplication>
+
+#include "mockserver.h"
+
+// Serves the API and the media of the app on localhost, e.g.
+//   gagbook-mockserver --port 8080 --latency 150 --bandwidth 512 --drop-rate 2
+//   GAGBOOK_API_URL=http://127.0.0.1:8080 GAGBOOK_COMMENT_CDN_URL=http://127.0.0.1:8080 harbour-gagbook
+int main(int argc, char *argv[])
+{
+    // QGuiApplication for the JPEG encoder of the generated images
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("gagbook-mockserver");
+
+    const MockServer::Config defaults;
+    const QJsonObject defaultValues = defaults.toJson();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("HTTP stand-in for the 9GAG API and its media CDN");
+    parser.addHelpOption();
+
+    const QCommandLineOption portOption("port", "The port to listen on (0 picks a free one).", "port", "8080");
+    const QCommandLineOption fixturesOption("fixtures", "Serve the files of <dir> for the paths they match.", "dir");
+    const QCommandLineOption seedOption("seed", "The seed of the random errors, drops and jitter.", "seed", "1");
+    const QCommandLineOption verboseOption("verbose", "Print the requests.");
+    parser.addOption(portOption);
+    parser.addOption(fixturesOption);
+    parser.addOption(seedOption);
+    parser.addOption(verboseOption);
+
+    const QList<QPair<QString, QString> > settings = QList<QPair<QString, QString> >()
+            << qMakePair(QString("latency"), QString("The delay of each response in ms."))
+            << qMakePair(QString("jitter"), QString("The maximum random delay added to the latency in ms."))
+            << qMakePair(QString("bandwidth"), QString("The bandwidth of all responses in KB/s (0 is unlimited)."))
+            << qMakePair(QString("error-rate"), QString("The percentage of responses with the error status."))
+            << qMakePair(QString("error-status"), QString("The HTTP status of the error responses."))
+            << qMakePair(QString("drop-rate"), QString("The percentage of responses cut off halfway through the body."))
+            << qMakePair(QString("post-count"), QString("The number of posts in the post lists."))
+            << qMakePair(QString("image-size"), QString("The size of the images in bytes."))
+            << qMakePair(QString("video-size"), QString("The size of the videos in bytes."))
+            << qMakePair(QString("comment-count"), QString("The number of top-level comments of a post."))
+            << qMakePair(QString("comment-depth"), QString("The levels of comments (1 is a flat list)."))
+            << qMakePair(QString("comment-replies"), QString("The replies of a comment on each level."));
+
+    typedef QPair<QString, QString> Setting;
+    foreach (const Setting &setting, settings) {
+        parser.addOption(QCommandLineOption(setting.first, setting.second, "value",
+                                            QString::number(defaultValues.value(setting.first).toInt())));
+    }
+
+    parser.process(app);
+
+    MockServer::Config config;
+    foreach (const Setting &setting, settings) {
+        bool ok = false;
+        const int value = parser.value(setting.first).toInt(&ok);
+        if (!ok)
+            parser.showHelp(1);
+
+        config.set(setting.first, value);
+    }
+
+    qsrand(parser.value(seedOption).toUInt());
+
+    MockServer server;
+    server.setConfig(config);
+    server.setFixturesDir(parser.value(fixturesOption));
+    server.setVerbose(parser.isSet(verboseOption));
+
+    if (!server.listen(QHostAddress::LocalHost, parser.value(portOption).toUShort())) {
+        qCritical("Unable to listen: %s", qPrintable(server.errorString()));
+        return 1;
+    }
+
+    // the first line is read by the benchmarks which start the server with port 0
+    printf("http://127.0.0.1:%d\n", server.serverPort());
+    fflush(stdout);
+
+    return app.exec();
+}
@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mockserver.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QUrl>
+#include <QtCore/QUrlQuery>
+#include <QtNetwork/QTcpSocket>
+
+#include "../shared/apifixtures.h"
+
+static const int TICK_INTERVAL_MS = 10;
+
+static QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Unknown";
+    }
+}
+
+static QByteArray contentType(const QString &path)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "jpg" || suffix == "jpeg")
+        return "image/jpeg";
+    if (suffix == "png")
+        return "image/png";
+    if (suffix == "gif")
+        return "image/gif";
+    if (suffix == "mp4")
+        return "video/mp4";
+    if (suffix == "webm")
+        return "video/webm";
+    return "application/json";
+}
+
+/*! One client connection, which receives its requests one after the other (keep-alive).
+    The response is written with the delay and the bandwidth of the server. */
+class MockConnection : public QObject
+{
+public:
+    MockConnection(MockServer *server, qintptr socketDescriptor);
+
+    /*! Write up to \p maxBytes of the current response. */
+    void send(qint64 maxBytes);
+
+private:
+    void processNext();
+    void startResponse(const MockServer::Response &response, bool close);
+    void finishResponse();
+
+    MockServer *m_server;
+    QTcpSocket *m_socket;
+    QByteArray m_input;
+    QByteArray m_output;
+    qint64 m_written;
+    qint64 m_end;       // where the response is cut off, the size of m_output otherwise
+    bool m_isBusy;
+    bool m_isDropped;
+    bool m_close;
+};
+
+MockConnection::MockConnection(MockServer *server, qintptr socketDescriptor)
+    : QObject(server), m_server(server), m_socket(new QTcpSocket(this)), m_written(0), m_end(0),
+      m_isBusy(false), m_isDropped(false), m_close(false)
+{
+    m_socket->setSocketDescriptor(socketDescriptor);
+
+    connect(m_socket, &QTcpSocket::readyRead, this, [this]() {
+        m_input.append(m_socket->readAll());
+        processNext();
+    });
+    connect(m_socket, &QTcpSocket::disconnected, this, [this]() {
+        m_server->stopSending(this);
+        deleteLater();
+    });
+}
+
+void MockConnection::send(qint64 maxBytes)
+{
+    const qint64 count = qMin(maxBytes, m_end - m_written);
+    if (count > 0) {
+        m_socket->write(m_output.constData() + m_written, count);
+        m_written += count;
+        m_server->m_bytesSent += count;
+    }
+
+    if (m_written >= m_end)
+        finishResponse();
+}
+
+void MockConnection::processNext()
+{
+    if (m_isBusy)
+        return;
+
+    const int headerEnd = m_input.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return;
+
+    QList<QByteArray> lines = m_input.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+    if (requestLine.count() != 3) {
+        m_socket->abort();
+        return;
+    }
+
+    QByteArray host;
+    QByteArray connection;
+    int contentLength = 0;
+    foreach (const QByteArray &line, lines) {
+        const int colon = line.indexOf(':');
+        if (colon < 0)
+            continue;
+
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed();
+        if (name == "host")
+            host = value;
+        else if (name == "connection")
+            connection = value.toLower();
+        else if (name == "content-length")
+            contentLength = value.toInt();
+    }
+
+    // the body of POST requests is not used
+    const int requestSize = headerEnd + 4 + contentLength;
+    if (m_input.size() < requestSize)
+        return;
+    m_input.remove(0, requestSize);
+
+    m_isBusy = true;
+    const bool close = connection == "close" || (requestLine.at(2) == "HTTP/1.0" && connection != "keep-alive");
+    const MockServer::Response response = m_server->respond(requestLine.at(0), requestLine.at(1), host);
+    const int delay = response.isControl ? 0 : m_server->responseDelay();
+
+    if (delay > 0)
+        QTimer::singleShot(delay, this, [this, response, close]() { startResponse(response, close); });
+    else
+        startResponse(response, close);
+}
+
+void MockConnection::startResponse(const MockServer::Response &response, bool close)
+{
+    m_close = close;
+    m_output = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n"
+            "Content-Type: " + response.contentType + "\r\n"
+            "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n"
+            "Connection: " + (close ? "close" : "keep-alive") + "\r\n\r\n";
+    const int headerSize = m_output.size();
+    m_output.append(response.body);
+    m_written = 0;
+
+    m_isDropped = !response.isControl && response.status == 200 && m_server->shouldDrop();
+    m_end = m_isDropped ? headerSize + response.body.size() / 2 : m_output.size();
+
+    if (response.isControl)
+        send(m_end);
+    else
+        m_server->startSending(this);
+}
+
+void MockConnection::finishResponse()
+{
+    m_server->stopSending(this);
+    m_output.clear();
+    m_isBusy = false;
+
+    // a dropped response ends with the connection after the written part is sent,
+    // which the client sees as a closed connection before the end of the body
+    if (m_isDropped || m_close) {
+        m_socket->disconnectFromHost();
+        return;
+    }
+
+    processNext();
+}
+
+MockServer::Config::Config()
+    : latencyMs(0), jitterMs(0), bandwidthKBps(0), errorRatePercent(0), errorStatus(503),
+      dropRatePercent(0), postCount(1000), imageBytes(50 * 1024), videoBytes(1024 * 1024),
+      commentCount(200), commentDepth(1), commentReplies(2)
+{
+}
+
+bool MockServer::Config::set(const QString &name, int value)
+{
+    if (name == "latency")
+        latencyMs = value;
+    else if (name == "jitter")
+        jitterMs = value;
+    else if (name == "bandwidth")
+        bandwidthKBps = value;
+    else if (name == "error-rate")
+        errorRatePercent = value;
+    else if (name == "error-status")
+        errorStatus = value;
+    else if (name == "drop-rate")
+        dropRatePercent = value;
+    else if (name == "post-count")
+        postCount = value;
+    else if (name == "image-size")
+        imageBytes = value;
+    else if (name == "video-size")
+        videoBytes = value;
+    else if (name == "comment-count")
+        commentCount = value;
+    else if (name == "comment-depth")
+        commentDepth = value;
+    else if (name == "comment-replies")
+        commentReplies = value;
+    else
+        return false;
+
+    return true;
+}
+
+QJsonObject MockServer::Config::toJson() const
+{
+    QJsonObject object;
+    object.insert("latency", latencyMs);
+    object.insert("jitter", jitterMs);
+    object.insert("bandwidth", bandwidthKBps);
+    object.insert("error-rate", errorRatePercent);
+    object.insert("error-status", errorStatus);
+    object.insert("drop-rate", dropRatePercent);
+    object.insert("post-count", postCount);
+    object.insert("image-size", imageBytes);
+    object.insert("video-size", videoBytes);
+    object.insert("comment-count", commentCount);
+    object.insert("comment-depth", commentDepth);
+    object.insert("comment-replies", commentReplies);
+    return object;
+}
+
+MockServer::Response::Response()
+    : status(200), contentType("application/json"), isControl(false)
+{
+}
+
+MockServer::MockServer(QObject *parent)
+    : QTcpServer(parent), m_verbose(false), m_requestCount(0), m_errorCount(0), m_dropCount(0),
+      m_bytesSent(0)
+{
+    m_tick.setInterval(TICK_INTERVAL_MS);
+    connect(&m_tick, &QTimer::timeout, this, &MockServer::onTick);
+}
+
+MockServer::Config MockServer::config() const
+{
+    return m_config;
+}
+
+void MockServer::setConfig(const Config &config)
+{
+    m_config = config;
+}
+
+void MockServer::setFixturesDir(const QString &dir)
+{
+    m_fixturesDir = dir;
+}
+
+void MockServer::setVerbose(bool verbose)
+{
+    m_verbose = verbose;
+}
+
+void MockServer::incomingConnection(qintptr socketDescriptor)
+{
+    new MockConnection(this, socketDescriptor);
+}
+
+MockServer::Response MockServer::respond(const QByteArray &method, const QByteArray &target,
+                                         const QByteArray &host)
+{
+    const QUrl url = QUrl::fromEncoded(target);
+    const QString path = url.path();
+    const QUrlQuery query(url);
+    const QString baseUrl = "http://" + QString::fromLatin1(host);
+
+    if (m_verbose)
+        qDebug() << method << target;
+
+    if (path.startsWith("/_mock/"))
+        return control(path, query);
+
+    ++m_requestCount;
+
+    Response response;
+    if (m_config.errorRatePercent > 0 && qrand() % 100 < m_config.errorRatePercent) {
+        ++m_errorCount;
+        response.status = m_config.errorStatus;
+        response.body = "{}";
+        return response;
+    }
+
+    response.body = fixture(path, baseUrl);
+    if (!response.body.isNull()) {
+        response.contentType = contentType(path);
+        return response;
+    }
+
+    return generate(path, query, baseUrl);
+}
+
+MockServer::Response MockServer::generate(const QString &path, const QUrlQuery &query, const QString &baseUrl)
+{
+    Response response;
+
+    if (path == "/v2/guest-token" || path == "/v2/user-token") {
+        response.body = ApiFixtures::loginResponse();
+    }
+    else if (path == "/v2/post-list") {
+        const int itemCount = qMax(1, query.queryItemValue("itemCount").toInt());
+        const QString olderThan = query.queryItemValue("olderThan");
+        const int first = olderThan.isEmpty() ? 0 : ApiFixtures::postIndex(olderThan) + 1;
+        const int count = qBound(0, qMin(itemCount, m_config.postCount - first), itemCount);
+        response.body = ApiFixtures::postList(count, first, baseUrl, m_config.imageBytes,
+                                              m_config.videoBytes, first + count >= m_config.postCount);
+    }
+    else if (path == "/v1/cacheable/comment-list.json") {
+        const int count = qMax(1, query.queryItemValue("count").toInt());
+        const QString ref = query.queryItemValue("ref");
+
+        // the replies of a comment ("c_" references) are all part of its page
+        if (ref.startsWith("c_")) {
+            response.body = ApiFixtures::commentList(0, 0, 1, 0, 0, baseUrl);
+        }
+        else {
+            const int first = ref.isEmpty() ? 0 : ApiFixtures::commentIndex(ref) + 1;
+            const int pageCount = qBound(0, m_config.commentCount - first, count);
+            response.body = ApiFixtures::commentList(pageCount, first, qMax(1, m_config.commentDepth),
+                                                     m_config.commentReplies, m_config.commentCount, baseUrl);
+        }
+    }
+    else if (path == "/v2/group-list") {
+        response.body = "{\"meta\":{\"status\":\"Success\"},\"data\":{\"groups\":[]}}";
+    }
+    else if (path.startsWith("/media/")) {
+        // "/media/<bytes>/<name>"
+        const int bytes = path.section('/', 2, 2).toInt();
+        const QString name = path.section('/', 3);
+        const QString key = QFileInfo(name).suffix() + QString::number(bytes);
+
+        if (!m_mediaFiles.contains(key))
+            m_mediaFiles.insert(key, ApiFixtures::mediaFile(name, bytes));
+
+        response.contentType = contentType(name);
+        response.body = m_mediaFiles.value(key);
+    }
+    else {
+        response.status = 404;
+        response.body = "{}";
+    }
+
+    return response;
+}
+
+MockServer::Response MockServer::control(const QString &path, const QUrlQuery &query)
+{
+    Response response;
+    response.isControl = true;
+
+    if (path == "/_mock/config") {
+        typedef QPair<QString, QString> QueryItem;
+        foreach (const QueryItem &item, query.queryItems()) {
+            if (!m_config.set(item.first, item.second.toInt())) {
+                response.status = 400;
+                response.body = "{}";
+                return response;
+            }
+        }
+    }
+    else if (path == "/_mock/reset") {
+        m_requestCount = 0;
+        m_errorCount = 0;
+        m_dropCount = 0;
+        m_bytesSent = 0;
+    }
+    else {
+        response.status = 404;
+        response.body = "{}";
+        return response;
+    }
+
+    QJsonObject stats;
+    stats.insert("requests", m_requestCount);
+    stats.insert("errors", m_errorCount);
+    stats.insert("drops", m_dropCount);
+    stats.insert("bytesSent", m_bytesSent);
+
+    QJsonObject object;
+    object.insert("config", m_config.toJson());
+    object.insert("stats", stats);
+    response.body = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+QByteArray MockServer::fixture(const QString &path, const QString &baseUrl) const
+{
+    if (m_fixturesDir.isEmpty() || path.contains(".."))
+        return QByteArray();
+
+    QFileInfo fileInfo(m_fixturesDir + path);
+    if (!fileInfo.isFile())
+        fileInfo.setFile(m_fixturesDir + path + ".json");
+    if (!fileInfo.isFile())
+        return QByteArray();
+
+    QFile file(fileInfo.filePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("MockServer::fixture(): Unable to open %s", qPrintable(fileInfo.filePath()));
+        return QByteArray();
+    }
+
+    QByteArray content = file.readAll();
+    if (fileInfo.suffix() == "json")
+        content.replace("@BASE_URL@", baseUrl.toUtf8());
+    return content;
+}
+
+int MockServer::responseDelay()
+{
+    return m_config.latencyMs + (m_config.jitterMs > 0 ? qrand() % (m_config.jitterMs + 1) : 0);
+}
+
+bool MockServer::shouldDrop()
+{
+    if (m_config.dropRatePercent <= 0 || qrand() % 100 >= m_config.dropRatePercent)
+        return false;
+
+    ++m_dropCount;
+    return true;
+}
+
+void MockServer::startSending(MockConnection *connection)
+{
+    if (m_config.bandwidthKBps <= 0) {
+        connection->send(Q_INT64_C(1) << 62);
+        return;
+    }
+
+    m_sending.append(connection);
+    if (!m_tick.isActive())
+        m_tick.start();
+}
+
+void MockServer::stopSending(MockConnection *connection)
+{
+    m_sending.removeAll(connection);
+    if (m_sending.isEmpty())
+        m_tick.stop();
+}
+
+void MockServer::onTick()
+{
+    if (m_sending.isEmpty())
+        return;
+
+    // the bandwidth was made unlimited by "/_mock/config" while responses were sent
+    if (m_config.bandwidthKBps <= 0) {
+        const QList<MockConnection *> sending = m_sending;
+        foreach (MockConnection *connection, sending)
+            connection->send(Q_INT64_C(1) << 62);
+        return;
+    }
+
+    // the bandwidth is shared equally by the responses which are being sent
+    const qint64 budget = qint64(m_config.bandwidthKBps) * 1024 * TICK_INTERVAL_MS / 1000;
+    const qint64 share = qMax(Q_INT64_C(1), budget / m_sending.count());
+
+    const QList<MockConnection *> sending = m_sending;
+    foreach (MockConnection *connection, sending)
+        connection->send(share);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+
+class QUrlQuery;
+class MockConnection;
+
+/*! HTTP stand-in for the 9GAG API and its media CDN
+
+    Answers the requests of NineGagApiClient (run the app with GAGBOOK_API_URL and
+    GAGBOOK_COMMENT_CDN_URL pointing to the server) and the downloads of the media
+    URLs in its responses:
+
+    - A file below the fixtures directory whose path is the request path (with or without
+      a '.json' suffix) is served as is, e.g. recorded JSON responses. "@BASE_URL@" in
+      JSON files is replaced by the URL of the server, so that media URLs point to it.
+    - Otherwise logins, post lists and comment lists are generated (see ApiFixtures),
+      and "/media/<bytes>/<name>" is answered with a file of that size.
+
+    The network conditions are simulated: the latency to the first byte (plus a random
+    jitter), a bandwidth which is shared by all responses, responses with an error
+    status and responses whose connection is closed halfway through the body. The
+    settings can be changed while the server runs with "/_mock/config?<name>=<value>",
+    which returns the settings and the statistics as JSON.
+ */
+class MockServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct Config {
+        Config();
+
+        /*! Set the setting \p name (e.g. "latency", as in toJson()) to \p value. Returns
+            false for an unknown name. */
+        bool set(const QString &name, int value);
+        QJsonObject toJson() const;
+
+        int latencyMs;
+        int jitterMs;
+        int bandwidthKBps;      // shared by all responses, 0 is unlimited
+        int errorRatePercent;   // responses with errorStatus instead of the content
+        int errorStatus;
+        int dropRatePercent;    // responses which are cut off halfway through the body
+        int postCount;          // the total number of generated posts
+        int imageBytes;
+        int videoBytes;
+        int commentCount;       // the total number of generated top-level comments
+        int commentDepth;       // 1 generates flat comment lists
+        int commentReplies;     // the replies of a comment on each level
+    };
+
+    explicit MockServer(QObject *parent = 0);
+
+    Config config() const;
+    void setConfig(const Config &config);
+
+    void setFixturesDir(const QString &dir);
+    void setVerbose(bool verbose);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor);
+
+private:
+    friend class MockConnection;
+
+    struct Response {
+        Response();
+
+        int status;
+        QByteArray contentType;
+        QByteArray body;
+        bool isControl;         // responses of "/_mock/" are not delayed, throttled or dropped
+    };
+
+    Response respond(const QByteArray &method, const QByteArray &target, const QByteArray &host);
+    Response generate(const QString &path, const QUrlQuery &query, const QString &baseUrl);
+    Response control(const QString &path, const QUrlQuery &query);
+    QByteArray fixture(const QString &path, const QString &baseUrl) const;
+    int responseDelay();
+    bool shouldDrop();
+    void startSending(MockConnection *connection);
+    void stopSending(MockConnection *connection);
+    void onTick();
+
+    Config m_config;
+    QString m_fixturesDir;
+    bool m_verbose;
+    QHash<QString, QByteArray> m_mediaFiles;    // by suffix and size
+
+    // the responses which are sent with the limited bandwidth
+    QList<MockConnection *> m_sending;
+    QTimer m_tick;
+
+    qint64 m_requestCount;
+    qint64 m_errorCount;
+    qint64 m_dropCount;
+    qint64 m_bytesSent;
+};
+
+#endif // MOCKSERVER_H
@@ -0,0 +1,17 @@
+TARGET = gagbook-mockserver
+
+# QtGui encodes the generated JPEG images
+QT += core gui network
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+HEADERS += \
+    mockserver.h \
+    ../shared/apifixtures.h
+
+SOURCES += main.cpp \
+    mockserver.cpp \
+    ../shared/apifixtures.cpp
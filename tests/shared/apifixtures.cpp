@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "apifixtures.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtGui/QImage>
+
+// the posts and comments are dated relative to this time, so that the responses don't change
+static const qint64 BASE_TIMESTAMP = 1546300800;   // 2019-01-01 in seconds since the epoch
+
+static const int JPEG_MAX_SEGMENT = 65533;  // the maximum data of a comment segment
+
+static QJsonObject rendition(const QString &url, int width, int height)
+{
+    QJsonObject object;
+    object.insert("url", url);
+    object.insert("width", width);
+    object.insert("height", height);
+    return object;
+}
+
+static QJsonObject user(int index)
+{
+    QJsonObject object;
+    object.insert("displayName", QString("user%1").arg(index % 97));
+    object.insert("userId", QString("u_%1").arg(index % 97));
+    object.insert("avatarUrl", QString("https://accounts-cdn.9gag.com/media/avatar/%1.jpg").arg(index % 97));
+    object.insert("emojiStatus", (index % 11 == 0) ? QString("&#x1F600;") : QString());
+
+    QJsonObject permissions;
+    if (index % 13 == 0)
+        permissions.insert("9GAG_Pro", true);
+    object.insert("permissions", permissions);
+
+    return object;
+}
+
+// A comment with its replies, the replies of the replies etc. down to the given depth
+static QJsonObject comment(const QString &id, int index, int depth, int repliesPerComment,
+                           const QString &mediaBaseUrl)
+{
+    QJsonObject object;
+    object.insert("commentId", id);
+    object.insert("timestamp", BASE_TIMESTAMP - index * 60);
+    object.insert("permalink", QString("https://9gag.com/gag/p000000#%1").arg(id));
+    object.insert("orderKey", QString("score_%1").arg(index));
+    object.insert("user", user(index));
+    object.insert("likeCount", 1000 - index % 1000);
+
+    // most comments are plain text, some contain entities or an image
+    if (index % 7 == 6) {
+        QJsonObject image;
+        image.insert("type", QString("STATIC"));
+        image.insert("image", rendition(QString("%1/media/%2/%3.jpg").arg(mediaBaseUrl).arg(20 * 1024).arg(id),
+                                        300, 300));
+
+        QJsonObject media;
+        media.insert("imageMetaByType", image);
+
+        object.insert("type", QString("userMedia"));
+        object.insert("mediaText", QString());
+        object.insert("media", QJsonArray() << media);
+    }
+    else {
+        object.insert("type", QString("text"));
+        object.insert("mediaText", (index % 5 == 4) ? QString("Comment %1 &amp; a reply &gt; all").arg(index)
+                                                    : QString("Comment %1 with some more words in it").arg(index));
+    }
+
+    QJsonArray children;
+
+    if (depth > 1) {
+        for (int i = 0; i < repliesPerComment; ++i)
+            children.append(comment(QString("%1_%2").arg(id).arg(i), index, depth - 1, repliesPerComment, mediaBaseUrl));
+    }
+
+    object.insert("childrenTotal", children.count());
+    object.insert("children", children);
+    return object;
+}
+
+// A valid JPEG which is padded to the given size by comment segments after the start of image marker
+static QByteArray paddedJpeg(int bytes)
+{
+    static QByteArray baseJpeg;
+
+    if (baseJpeg.isEmpty()) {
+        QImage image(460, 460, QImage::Format_RGB32);
+
+        for (int y = 0; y < image.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+
+            for (int x = 0; x < image.width(); ++x)
+                line[x] = qRgb(x / 2, y / 2, (x + y) / 4);
+        }
+
+        QBuffer buffer(&baseJpeg);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "JPG", 90);
+    }
+
+    QByteArray jpeg = baseJpeg.left(2);     // SOI
+    int padding = bytes - baseJpeg.size();
+
+    while (padding >= 4) {
+        const int segmentData = qMin(padding - 4, JPEG_MAX_SEGMENT);
+        const int length = segmentData + 2;
+
+        jpeg.append(char(0xff)).append(char(0xfe));
+        jpeg.append(char(length >> 8)).append(char(length & 0xff));
+        jpeg.append(QByteArray(segmentData, 'x'));
+        padding -= segmentData + 4;
+    }
+
+    return jpeg.append(baseJpeg.mid(2));
+}
+
+QByteArray ApiFixtures::loginResponse()
+{
+    QJsonObject data;
+    data.insert("userToken", QString("0123456789abcdef0123456789abcdef01234567"));
+    data.insert("tokenExpiry", int(QDateTime::currentMSecsSinceEpoch() / 1000 + 72 * 3600));
+
+    QJsonObject meta;
+    meta.insert("status", QString("Success"));
+
+    QJsonObject root;
+    root.insert("meta", meta);
+    root.insert("data", data);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QByteArray ApiFixtures::postList(int count, int firstIndex, const QString &mediaBaseUrl, int imageBytes,
+                                 int videoBytes, bool endOfList)
+{
+    QJsonArray posts;
+
+    for (int index = firstIndex; index < firstIndex + count; ++index) {
+        const QString id = postId(index);
+        const QString imagePath = QString("%1/media/%2/%3").arg(mediaBaseUrl).arg(imageBytes).arg(id);
+        const bool isAnimated = (index % 3 == 2);
+
+        QJsonObject images;
+        images.insert("image460", rendition(imagePath + "_460.jpg", 460, 460 + index % 300));
+        images.insert("image700", rendition(imagePath + "_700.jpg", 700, 700 + index % 450));
+
+        if (isAnimated) {
+            QJsonObject video = rendition(QString("%1/media/%2/%3_460sv.mp4").arg(mediaBaseUrl).arg(videoBytes).arg(id),
+                                          460, 460 + index % 300);
+            video.insert("duration", 5 + index % 20);
+            images.insert("image460sv", video);
+        }
+
+        QJsonObject post;
+        post.insert("id", id);
+        post.insert("url", QString("https://9gag.com/gag/%1").arg(id));
+        post.insert("title", (index % 4 == 3) ? QString("Post %1 &amp; its &quot;title&quot;").arg(index)
+                                              : QString("Post %1 has a plain title").arg(index));
+        post.insert("type", isAnimated ? QString("Animated") : QString("Photo"));
+        post.insert("nsfw", 0);
+        post.insert("hasLongPostCover", 0);
+        post.insert("totalVoteCount", 10000 - index % 10000);
+        post.insert("commentsCount", 100 + index % 400);
+        post.insert("creationTs", BASE_TIMESTAMP - index * 600);
+        post.insert("images", images);
+        posts.append(post);
+    }
+
+    QJsonObject data;
+    data.insert("posts", posts);
+    data.insert("didEndOfList", endOfList ? 1 : 0);
+    data.insert("nextCursor", QString("after=%1").arg(postId(firstIndex + count - 1)));
+
+    QJsonObject root;
+    root.insert("data", data);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QString ApiFixtures::postId(int index)
+{
+    return QString("p%1").arg(index, 6, 10, QChar('0'));
+}
+
+int ApiFixtures::postIndex(const QString &postId)
+{
+    bool ok = false;
+    const int index = postId.mid(1).toInt(&ok);
+
+    return (postId.startsWith('p') && ok) ? index : -1;
+}
+
+QByteArray ApiFixtures::commentList(int count, int firstIndex, int depth, int repliesPerComment, int total,
+                                    const QString &mediaBaseUrl)
+{
+    const int lastIndex = qMin(firstIndex + count, total);
+    QJsonArray comments;
+
+    for (int index = firstIndex; index < lastIndex; ++index)
+        comments.append(comment(QString("c_%1").arg(index), index, depth, repliesPerComment, mediaBaseUrl));
+
+    QJsonObject payload;
+    payload.insert("total", total);
+    payload.insert("hasNext", lastIndex < total);
+    payload.insert("opUserId", QString("u_0"));
+    payload.insert("comments", comments);
+
+    QJsonObject root;
+    root.insert("status", QString("OK"));
+    root.insert("payload", payload);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+int ApiFixtures::commentIndex(const QString &ref)
+{
+    bool ok = false;
+    const int index = ref.mid(6).toInt(&ok);
+
+    return (ref.startsWith("score_") && ok) ? index : -1;
+}
+
+QByteArray ApiFixtures::mediaFile(const QString &fileName, int bytes)
+{
+    if (fileName.endsWith(".jpg") || fileName.endsWith(".jpeg"))
+        return paddedJpeg(bytes);
+
+    QByteArray data;
+    data.reserve(bytes);
+
+    // the 'ftyp' box of an MP4 file
+    if (fileName.endsWith(".mp4"))
+        data.append(QByteArray::fromHex("0000001866747970697336360000000169736f6d61766331"));
+
+    // a simple pattern instead of zeros, so that the file can't be compressed by accident
+    for (int i = data.size(); i < bytes; ++i)
+        data.append(char(i * 31 % 251));
+
+    return data;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef APIFIXTURES_H
+#define APIFIXTURES_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+/*! Synthetic responses of the 9GAG API
+
+    Generates the JSON responses which are parsed by NineGagApiClient and NineGagApiRequest,
+    so that the parsers, the models and the download pipeline can be measured without the
+    real API. The same arguments always give the same response. The media URLs point to
+    "<mediaBaseUrl>/media/<bytes>/<name>", which the mock server answers with a file of
+    the given size (see MockServer).
+ */
+class ApiFixtures
+{
+public:
+    /*! Get the response of a guest or user login. */
+    static QByteArray loginResponse();
+
+    /*! Get a page of \p count posts starting with the post number \p firstIndex. Every
+        third post is animated (an image and a video of \p videoBytes), the others are
+        photos of \p imageBytes. \p endOfList marks the last page. */
+    static QByteArray postList(int count, int firstIndex, const QString &mediaBaseUrl,
+                               int imageBytes = 50 * 1024, int videoBytes = 1024 * 1024,
+                               bool endOfList = false);
+
+    /*! Get the id of the post number \p index and the other way round, e.g. for the
+        'olderThan' parameter of the next page. Returns -1 for an unknown id. */
+    static QString postId(int index);
+    static int postIndex(const QString &postId);
+
+    /*! Get a page of \p count top-level comments starting with the comment number
+        \p firstIndex. Each comment has \p repliesPerComment replies on each of the
+        \p depth - 1 levels below it, so depth 1 gives a flat list. \p total is the
+        total number of comments, which determines 'hasNext'. */
+    static QByteArray commentList(int count, int firstIndex, int depth, int repliesPerComment,
+                                  int total, const QString &mediaBaseUrl);
+
+    /*! Get the number of the comment of the orderKey \p ref (the 'ref' parameter of the
+        next page), or -1 for an unknown key. */
+    static int commentIndex(const QString &ref);
+
+    /*! Get the content of a media file of about \p bytes. A '.jpg' file is a valid
+        460x460 JPEG which is padded with comment segments, so that it can be decoded. An
+        '.mp4' file starts with the 'ftyp' box, the rest is filler like any other file. */
+    static QByteArray mediaFile(const QString &fileName, int bytes);
+
+private:
+    ApiFixtures();
+};
+
+#endif // APIFIXTURES_H
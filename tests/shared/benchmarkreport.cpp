@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "benchmarkreport.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMap>
+
+// Returns the value in KB of the field \p name of /proc/self/status, e.g. "VmRSS"
+static qint64 procStatusKb(const QByteArray &name)
+{
+#ifdef Q_OS_LINUX
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly))
+        return -1;
+
+    // e.g. "VmHWM:     12345 kB"
+    foreach (const QByteArray &line, status.readAll().split('\n')) {
+        if (line.startsWith(name + ':'))
+            return line.mid(name.size() + 1).trimmed().split(' ').first().toLongLong();
+    }
+#else
+    Q_UNUSED(name)
+#endif
+    return -1;
+}
+
+QJsonObject BenchmarkReport::summary(QVector<double> samples)
+{
+    QJsonObject object;
+    object.insert("count", samples.count());
+
+    if (samples.isEmpty())
+        return object;
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    foreach (double sample, samples)
+        sum += sample;
+
+    // nearest-rank percentiles
+    const int last = samples.count() - 1;
+    object.insert("mean", sum / samples.count());
+    object.insert("p50", samples.at(qRound(last * 0.50)));
+    object.insert("p95", samples.at(qRound(last * 0.95)));
+    object.insert("p99", samples.at(qRound(last * 0.99)));
+    object.insert("max", samples.at(last));
+    return object;
+}
+
+qint64 BenchmarkReport::residentMemoryKb()
+{
+    return procStatusKb("VmRSS");
+}
+
+qint64 BenchmarkReport::peakResidentMemoryKb()
+{
+    return procStatusKb("VmHWM");
+}
+
+void BenchmarkReport::resetPeakResidentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly))
+        clearRefs.write("5");
+#endif
+}
+
+QJsonObject BenchmarkReport::allocations(const QVariantList &metrics)
+{
+    static const QString PREFIX("alloc.");
+
+    // the counters "alloc.<scope>.calls", "alloc.<scope>.count" and "alloc.<scope>.bytes"
+    QMap<QString, QJsonObject> scopes;
+    foreach (const QVariant &metric, metrics) {
+        const QVariantMap metricMap = metric.toMap();
+        const QString name = metricMap.value("name").toString();
+        const int fieldStart = name.lastIndexOf('.');
+
+        if (!name.startsWith(PREFIX) || fieldStart <= PREFIX.size())
+            continue;
+
+        scopes[name.mid(PREFIX.size(), fieldStart - PREFIX.size())].insert(name.mid(fieldStart + 1),
+                                                                           metricMap.value("value").toDouble());
+    }
+
+    QJsonObject object;
+    QMap<QString, QJsonObject>::iterator i = scopes.begin();
+    for (; i != scopes.end(); ++i) {
+        const double calls = i->value("calls").toDouble();
+        if (calls > 0) {
+            i->insert("countPerCall", i->value("count").toDouble() / calls);
+            i->insert("bytesPerCall", i->value("bytes").toDouble() / calls);
+        }
+
+        object.insert(i.key(), *i);
+    }
+
+    return object;
+}
+
+bool BenchmarkReport::write(const QJsonObject &report, const QString &fileName)
+{
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (fileName.isEmpty()) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+        fflush(stdout);
+        return true;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        qWarning("BenchmarkReport::write(): Unable to write %s", qPrintable(fileName));
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCHMARKREPORT_H
+#define BENCHMARKREPORT_H
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+/*! Helpers for the JSON reports of the benchmark harnesses
+
+    The harnesses (tests/benchmarks) print one JSON object, so that the runs before and
+    after a change can be compared by scripts.
+ */
+class BenchmarkReport
+{
+public:
+    /*! Get the "count", "mean", "p50", "p95", "p99" and "max" of \p samples. */
+    static QJsonObject summary(QVector<double> samples);
+
+    /*! Get the current resident memory of the process in KB, or -1 if unknown. */
+    static qint64 residentMemoryKb();
+
+    /*! Get the high-water mark of the resident memory of the process in KB, or -1 if
+        unknown. */
+    static qint64 peakResidentMemoryKb();
+
+    /*! Reset the high-water mark to the current resident memory (Linux 4.0 and later), so
+        that it can be measured per scenario. */
+    static void resetPeakResidentMemory();
+
+    /*! Get the totals of the AllocScopes per scope ("calls", "count", "bytes",
+        "countPerCall" and "bytesPerCall") from \p metrics, a MetricsRegistry::snapshot().
+        Empty unless the app sources are built with CONFIG+=allocprofile. */
+    static QJsonObject allocations(const QVariantList &metrics);
+
+    /*! Write \p report to the file \p fileName, or to stdout if it is empty. Returns false
+        if the file can not be written. */
+    static bool write(const QJsonObject &report, const QString &fileName);
+
+private:
+    BenchmarkReport();
+};
+
+#endif // BENCHMARKREPORT_H
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "benchmarkserver.h"
+
+#include <QtNetwork/QHostAddress>
+
+BenchmarkServer::BenchmarkServer(const MockServer::Config &config, QObject *parent)
+    : QThread(parent), m_config(config)
+{
+    start();
+    m_listening.acquire();
+}
+
+BenchmarkServer::~BenchmarkServer()
+{
+    quit();
+    wait();
+}
+
+QUrl BenchmarkServer::url() const
+{
+    return m_url;
+}
+
+void BenchmarkServer::setEnvironment() const
+{
+    qputenv("GAGBOOK_API_URL", m_url.toEncoded());
+    qputenv("GAGBOOK_COMMENT_CDN_URL", m_url.toEncoded());
+}
+
+void BenchmarkServer::run()
+{
+    // the server and its connections live in this thread
+    MockServer server;
+    server.setConfig(m_config);
+
+    if (server.listen(QHostAddress::LocalHost, 0))
+        m_url = QUrl(QString("http://127.0.0.1:%1").arg(server.serverPort()));
+    else
+        qWarning("BenchmarkServer::run(): Unable to listen: %s", qPrintable(server.errorString()));
+
+    m_listening.release();
+
+    if (!m_url.isEmpty())
+        exec();
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2019 Alexander Seibel.
+ * All rights reserved.
+ *
+ * This file is part of GagBook.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCHMARKSERVER_H
+#define BENCHMARKSERVER_H
+
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QUrl>
+
+#include "tests/mockserver/mockserver.h"
+
+/*! MockServer on its own thread
+
+    Runs a MockServer with the given settings on a free port of localhost for the benchmark
+    harnesses, so that the serving of the responses doesn't add to the measured time of the
+    GUI thread. setEnvironment() points the API of the app to the server; it must be called
+    before the GagBookManager is created.
+ */
+class BenchmarkServer : public QThread
+{
+    Q_OBJECT
+public:
+    /*! Start the server and wait until it listens. */
+    explicit BenchmarkServer(const MockServer::Config &config, QObject *parent = 0);
+
+    /*! Stop the server. */
+    ~BenchmarkServer();
+
+    /*! Get the URL of the server, which is empty if it failed to listen. */
+    QUrl url() const;
+
+    /*! Set GAGBOOK_API_URL and GAGBOOK_COMMENT_CDN_URL to the URL of the server. */
+    void setEnvironment() const;
+
+protected:
+    void run();
+
+private:
+    MockServer::Config m_config;
+    QSemaphore m_listening;
+    QUrl m_url;
+};
+
+#endif // BENCHMARKSERVER_H
@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+
+# the unit tests and benchmarks of the app sources (src/), run with "make check";
+# the benchmarks of the models and downloads use the mock server of the API
+SUBDIRS += \
+    auto \
+    benchmarks \
+    mockserver